@@ -0,0 +1,59 @@
+#include <primitiv/config.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <primitiv/arena.h>
+#include <primitiv/error.h>
+
+namespace primitiv {
+
+Arena::Arena(std::size_t chunk_size)
+: chunk_size_(chunk_size)
+, current_(0)
+, offset_(0)
+, used_(0)
+, capacity_(0) {
+  if (chunk_size == 0) {
+    PRIMITIV_THROW_ERROR("Invalid chunk size: " << chunk_size);
+  }
+}
+
+void *Arena::allocate(std::size_t size, std::size_t align) {
+  if (align == 0 || (align & (align - 1)) != 0) {
+    PRIMITIV_THROW_ERROR("Invalid alignment: " << align);
+  }
+
+  while (true) {
+    if (current_ == chunks_.size()) {
+      // Obtains a new chunk which is large enough for the requested block.
+      const std::size_t chunk_size = std::max(chunk_size_, size + align);
+      chunks_.emplace_back(Chunk { std::unique_ptr<char[]>(
+            new char[chunk_size]), chunk_size });
+      capacity_ += chunk_size;
+    }
+
+    Chunk &chunk = chunks_[current_];
+    const std::uintptr_t base =
+      reinterpret_cast<std::uintptr_t>(chunk.data.get());
+    const std::uintptr_t head = (base + offset_ + align - 1) & ~(align - 1);
+    const std::size_t begin = head - base;
+    if (begin + size <= chunk.size) {
+      used_ += begin + size - offset_;
+      offset_ = begin + size;
+      return chunk.data.get() + begin;
+    }
+
+    // Moves to the next chunk. The rest of the current chunk is wasted until
+    // the next `reset()`.
+    ++current_;
+    offset_ = 0;
+  }
+}
+
+void Arena::reset() {
+  current_ = 0;
+  offset_ = 0;
+  used_ = 0;
+}
+
+}  // namespace primitiv
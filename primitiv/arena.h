@@ -0,0 +1,113 @@
+#ifndef PRIMITIV_ARENA_H_
+#define PRIMITIV_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <primitiv/mixins.h>
+
+namespace primitiv {
+
+/**
+ * Memory arena which provides small memory blocks by bumping a pointer.
+ * @remarks Memory blocks are never released individually. `reset()` makes
+ *          all memory available for new allocations at once, and chunks
+ *          obtained from the system are kept until the arena is destroyed.
+ */
+class Arena : mixins::Nonmovable<Arena> {
+public:
+  /**
+   * Creates a new arena.
+   * @param chunk_size Number of bytes of each chunk obtained from the system.
+   * @throw primitiv::Error `chunk_size` is 0.
+   */
+  explicit Arena(std::size_t chunk_size = 65536);
+
+  ~Arena() = default;
+
+  /**
+   * Allocates a memory block.
+   * @param size Number of bytes of the block.
+   * @param align Alignment of the block in bytes.
+   * @return Pointer to the allocated block.
+   * @throw primitiv::Error `align` is not a power of 2.
+   * @remarks The block is valid until `reset()` is called or the arena is
+   *          destroyed.
+   */
+  void *allocate(std::size_t size, std::size_t align);
+
+  /**
+   * Makes all memory of the arena available for new allocations.
+   * @remarks This function does not call any destructors, and does not
+   *          release any chunks.
+   */
+  void reset();
+
+  /**
+   * Returns the number of bytes allocated since the last `reset()`.
+   * @return Number of bytes including paddings for alignments.
+   */
+  std::size_t used() const { return used_; }
+
+  /**
+   * Returns the total number of bytes of chunks held by the arena.
+   * @return Number of bytes.
+   */
+  std::size_t capacity() const { return capacity_; }
+
+private:
+  /**
+   * Memory block obtained from the system.
+   */
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    std::size_t size;
+  };
+
+  std::size_t chunk_size_;
+  std::vector<Chunk> chunks_;
+  std::size_t current_;
+  std::size_t offset_;
+  std::size_t used_;
+  std::size_t capacity_;
+};
+
+/**
+ * Allocator of standard containers which obtains memory from an Arena.
+ * @remarks `deallocate()` does nothing. Memory is reclaimed by `Arena::reset()`.
+ */
+template<typename T>
+class ArenaAllocator {
+  template<typename U> friend class ArenaAllocator;
+
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(Arena &arena) : arena_(&arena) {}
+
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U> &src) : arena_(src.arena_) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *, std::size_t) {}
+
+  template<typename U>
+  bool operator==(const ArenaAllocator<U> &other) const {
+    return arena_ == other.arena_;
+  }
+
+  template<typename U>
+  bool operator!=(const ArenaAllocator<U> &other) const {
+    return arena_ != other.arena_;
+  }
+
+private:
+  Arena *arena_;
+};
+
+}  // namespace primitiv
+
+#endif  // PRIMITIV_ARENA_H_
@@ -3,6 +3,7 @@
 
 #include <cmath>
 #include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <vector>
 
@@ -829,6 +830,28 @@ type_traits::Identity<Var> softmax_cross_entropy(
 template<typename Var>
 type_traits::Identity<Var> stop_gradient(const Var &x);
 
+/**
+ * Applies a step function to each slice of a sequence as one operator.
+ * @param step Step function which receives current states and a slice of
+ *             ``xs``, and returns next states with the same shapes.
+ * @param init Nodes representing initial states.
+ * @param xs A node representing the sequence.
+ * @param dim Axis of steps. Each step receives ``slice(xs, dim, t, t + 1)``.
+ * @return A list of nodes: final states, followed by results of the first
+ *         state at all steps concatenated along ``dim``.
+ * @throw primitiv::Error ``init`` is empty, or ``step`` returns invalid states.
+ * @remarks ``step`` is called only once to build the subgraph of one step,
+ *          which is then evaluated at each step inside the operator. The
+ *          number of operators in the graph does not depend on the length of
+ *          the sequence. Leaf nodes created in ``step`` (e.g., parameters)
+ *          belong to the subgraph, and gradients of parameters are updated by
+ *          the backward operation of the operator.
+ */
+std::vector<Node> scan(
+    const std::function<
+      std::vector<Node>(const std::vector<Node> &, const Node &)> &step,
+    const std::vector<Node> &init, const Node &xs, std::uint32_t dim);
+
 /**
  * Applies a 2D convolution between two variables.
  * @param x A variable with Shape \f$ [d_0, d_1, c_1] \f$.
@@ -148,6 +148,17 @@ PRIMITIV_C_STATUS primitivSetDefaultGraph(primitivGraph_t *graph) try {
   return PRIMITIV_C_OK;
 } PRIMITIV_C_HANDLE_EXCEPTIONS
 
+PRIMITIV_C_STATUS primitivSetThreadDefaultGraph(primitivGraph_t *graph) try {
+  PRIMITIV_C_CHECK_NOT_NULL(graph);
+  Graph::set_thread_default(*to_cpp_ptr(graph));
+  return PRIMITIV_C_OK;
+} PRIMITIV_C_HANDLE_EXCEPTIONS
+
+PRIMITIV_C_STATUS primitivResetThreadDefaultGraph() try {
+  Graph::reset_thread_default();
+  return PRIMITIV_C_OK;
+} PRIMITIV_C_HANDLE_EXCEPTIONS
+
 PRIMITIV_C_STATUS primitivClearGraph(primitivGraph_t *graph) try {
   PRIMITIV_C_CHECK_NOT_NULL(graph);
   to_cpp_ptr(graph)->clear();
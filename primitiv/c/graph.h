@@ -183,6 +183,23 @@ PRIMITIV_C_API PRIMITIV_C_STATUS primitivGetDefaultGraph(
 PRIMITIV_C_API PRIMITIV_C_STATUS primitivSetDefaultGraph(
     primitivGraph_t *graph);
 
+/**
+ * Specifies a new default graph of the current thread.
+ * @param graph Pointer of the new default graph.
+ * @return Status code.
+ * @remarks The graph is used instead of the process-wide default graph only on
+ *          the current thread.
+ */
+PRIMITIV_C_API PRIMITIV_C_STATUS primitivSetThreadDefaultGraph(
+    primitivGraph_t *graph);
+
+/**
+ * Unregisters the default graph of the current thread, and falls back to the
+ * process-wide default graph.
+ * @return Status code.
+ */
+PRIMITIV_C_API PRIMITIV_C_STATUS primitivResetThreadDefaultGraph();
+
 /**
  * Clear all operators in the graph.
  * @param graph Pointer of a handler.
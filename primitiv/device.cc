@@ -1,5 +1,8 @@
 #include <primitiv/config.h>
 
+#include <cstddef>
+#include <memory>
+#include <utility>
 #include <primitiv/device.h>
 #include <primitiv/error.h>
 #include <primitiv/shape_ops.h>
@@ -15,27 +18,73 @@ using std::vector;
         << " != this: " << this); \
   }
 
+namespace {
+
+// Number of memory allocations requested by each thread.
+thread_local std::uint64_t num_allocations = 0;
+
+// Tracker of memory allocations requested by each thread.
+thread_local std::shared_ptr<primitiv::Device::AllocationTracker> tracker;
+thread_local std::uint64_t tracker_tag = 0;
+
+}  // namespace
+
 namespace primitiv {
 
+std::uint64_t Device::num_thread_allocations() {
+  return ::num_allocations;
+}
+
+void Device::set_thread_allocation_tracker(
+    std::shared_ptr<AllocationTracker> tracker, std::uint64_t tag) {
+  ::tracker = std::move(tracker);
+  ::tracker_tag = tag;
+}
+
+const std::shared_ptr<Device::AllocationTracker>
+&Device::thread_allocation_tracker() {
+  return ::tracker;
+}
+
+std::uint64_t Device::thread_allocation_tag() {
+  return ::tracker_tag;
+}
+
+std::shared_ptr<void> Device::new_tracked_handle(const Shape &shape) {
+  ++::num_allocations;
+  std::shared_ptr<void> handle = new_handle(shape);
+  if (!::tracker) return handle;
+
+  // The original handle is held by the deleter of the new handle, and is
+  // released after notifying the tracker.
+  const std::size_t bytes = shape.size() * sizeof(float);
+  const std::uint64_t tag = ::tracker_tag;
+  std::shared_ptr<AllocationTracker> tr = ::tracker;
+  tr->allocated(tag, bytes);
+  void *ptr = handle.get();
+  return std::shared_ptr<void>(
+      ptr, [handle, tr, tag, bytes](void *) { tr->released(tag, bytes); });
+}
+
 Tensor Device::new_raw_tensor(const Shape &shape) {
-  return Tensor(shape, *this, new_handle(shape));
+  return Tensor(shape, *this, new_tracked_handle(shape));
 }
 
 Tensor Device::new_tensor_by_constant(const Shape &shape, float k) {
-  Tensor ret(shape, *this, new_handle(shape));
+  Tensor ret(shape, *this, new_tracked_handle(shape));
   reset_tensor(k, ret);
   return ret;
 }
 
 Tensor Device::new_tensor_by_array(const Shape &shape, const float values[]) {
-  Tensor ret(shape, *this, new_handle(shape));
+  Tensor ret(shape, *this, new_tracked_handle(shape));
   reset_tensor_by_array(values, ret);
   return ret;
 }
 
 Tensor Device::new_tensor_by_vector(
     const Shape &shape, const vector<float> &values) {
-  Tensor ret(shape, *this, new_handle(shape));
+  Tensor ret(shape, *this, new_tracked_handle(shape));
   reset_tensor_by_vector(values, ret);
   return ret;
 }
@@ -87,6 +136,26 @@ Tensor Device::copy_tensor(const Tensor &x) {
   return y;
 }
 
+Tensor Device::new_tensor_view(
+    Tensor &x, std::uint32_t offset, const Shape &shape) {
+  CHECK_DEVICE(x);
+  const auto group = static_cast<std::uint32_t>(type()) &
+    static_cast<std::uint32_t>(DeviceType::GROUP_FILTER);
+  if (group != static_cast<std::uint32_t>(DeviceType::GROUP_CPU)) {
+    PRIMITIV_THROW_ERROR(
+        "Tensor views are not supported on the device: " << this);
+  }
+  if (offset + shape.size() > x.shape().size()) {
+    PRIMITIV_THROW_ERROR(
+        "Invalid range of the tensor view. offset: " << offset
+        << ", shape: " << shape.to_string()
+        << ", x.shape: " << x.shape().to_string());
+  }
+  // The view does not take the ownership of the memory.
+  float *data = static_cast<float *>(get_mutable_handle(x)) + offset;
+  return Tensor(shape, *this, std::shared_ptr<void>(data, [](void *) {}));
+}
+
 Tensor Device::identity(std::uint32_t size) {
   if (size == 0) {
     PRIMITIV_THROW_ERROR("Invalid size of the identity matrix: " << size);
@@ -171,6 +240,53 @@ Tensor Device::concat_fw(const vector<const Tensor *> &xs, std::uint32_t dim) {
   return y;
 }
 
+// Minibatches are sliced/concatenated as an additional dimension after the
+// last dimension, which has the same memory layout as the minibatch.
+
+Tensor Device::batch_slice_fw(
+    const Tensor &x, std::uint32_t lower, std::uint32_t upper) {
+  CHECK_DEVICE(x);
+  const Shape sy = shape_ops::batch_slice(x.shape(), lower, upper);
+  const std::uint32_t dim = sy.depth();
+  if (dim >= Shape::MAX_DEPTH) {
+    PRIMITIV_THROW_NOT_IMPLEMENTED_WITH_MESSAGE(
+        "Too many dimensions to slice the minibatch: " << sy.to_string());
+  }
+  const Shape sx = x.shape();
+  const Tensor fx(sx.resize_batch(1).resize_dim(dim, sx.batch()), *this, x.handle_);
+  Tensor fy = new_raw_tensor(sy.resize_batch(1).resize_dim(dim, upper - lower));
+  slice_fw_impl(fx, dim, lower, fy);
+  return Tensor(sy, *this, std::move(fy.handle_));
+}
+
+Tensor Device::batch_concat_fw(const vector<const Tensor *> &xs) {
+  vector<Shape> shapes;
+  shapes.reserve(xs.size());
+  for (const Tensor *x : xs) {
+    CHECK_DEVICE(*x);
+    shapes.emplace_back(x->shape());
+  }
+  const Shape sy = shape_ops::batch_concat(shapes);
+  const std::uint32_t dim = sy.depth();
+  if (dim >= Shape::MAX_DEPTH) {
+    PRIMITIV_THROW_NOT_IMPLEMENTED_WITH_MESSAGE(
+        "Too many dimensions to concatenate the minibatch: " << sy.to_string());
+  }
+  vector<Tensor> fxs;
+  vector<const Tensor *> ptrs;
+  fxs.reserve(xs.size());
+  ptrs.reserve(xs.size());
+  for (const Tensor *x : xs) {
+    const Shape &sx = x->shape();
+    fxs.emplace_back(
+        Tensor(sx.resize_batch(1).resize_dim(dim, sx.batch()), *this, x->handle_));
+    ptrs.emplace_back(&fxs.back());
+  }
+  Tensor fy = new_raw_tensor(sy.resize_batch(1).resize_dim(dim, sy.batch()));
+  concat_fw_impl(ptrs, dim, fy);
+  return Tensor(sy, *this, std::move(fy.handle_));
+}
+
 void Device::pick_bw(
     const Tensor &gy, const std::vector<std::uint32_t> &ids, std::uint32_t dim,
     Tensor &gx) {
@@ -202,12 +318,26 @@ void Device::slice_bw(
   else slice_bw_impl(gy, dim, offset, gx);
 }
 
+#define CHECK_RETURN_SHAPE(name, y, required) \
+  if ((y).shape() != (required)) { \
+    PRIMITIV_THROW_ERROR( \
+        "Shape mismatched at " #name "_fw" \
+        << ". required: " << (required).to_string() \
+        << ", y.shape: " << (y).shape().to_string()); \
+  }
+
 #define DEV_FW_X(name, sop) \
 Tensor Device::name##_fw(const Tensor &x) { \
   CHECK_DEVICE(x); \
   Tensor y = new_raw_tensor(sop(x.shape())); \
   name##_fw_impl(x, y); \
   return y; \
+} \
+void Device::name##_fw(const Tensor &x, Tensor &y) { \
+  CHECK_DEVICE(x); \
+  CHECK_DEVICE(y); \
+  CHECK_RETURN_SHAPE(name, y, sop(x.shape())); \
+  name##_fw_impl(x, y); \
 }
 
 #define DEV_BW_X(name, sop) \
@@ -236,6 +366,12 @@ Tensor Device::name##_fw(const Tensor &x, float k) { \
   Tensor y = new_raw_tensor(x.shape()); \
   name##_fw_impl(x, k, y); \
   return y; \
+} \
+void Device::name##_fw(const Tensor &x, float k, Tensor &y) { \
+  CHECK_DEVICE(x); \
+  CHECK_DEVICE(y); \
+  CHECK_RETURN_SHAPE(name, y, x.shape()); \
+  name##_fw_impl(x, k, y); \
 }
 
 #define DEV_BW_X_CONST(name) \
@@ -264,6 +400,13 @@ Tensor Device::name##_fw(const Tensor &a, const Tensor &b) { \
   Tensor y = new_raw_tensor(sop(a.shape(), b.shape())); \
   name##_fw_impl(a, b, y); \
   return y; \
+} \
+void Device::name##_fw(const Tensor &a, const Tensor &b, Tensor &y) { \
+  CHECK_DEVICE(a); \
+  CHECK_DEVICE(b); \
+  CHECK_DEVICE(y); \
+  CHECK_RETURN_SHAPE(name, y, sop(a.shape(), b.shape())); \
+  name##_fw_impl(a, b, y); \
 }
 
 #define DEV_BW_AB(name, sop) \
@@ -333,6 +476,13 @@ Tensor Device::pown_fw(const Tensor &x, std::int32_t k) {
   return y;
 }
 
+void Device::pown_fw(const Tensor &x, std::int32_t k, Tensor &y) {
+  CHECK_DEVICE(x);
+  CHECK_DEVICE(y);
+  CHECK_RETURN_SHAPE(pown, y, x.shape());
+  pown_fw_impl(x, k, y);
+}
+
 DEV_BW_X_CONST(add_const);
 DEV_BW_X_CONST(subtract_const_r);
 DEV_BW_X_CONST(subtract_const_l);
@@ -489,6 +639,7 @@ void Device::max_pool2d_bw(
 #undef DEV_BW_X_CONST
 #undef DEV_FW_AB
 #undef DEV_BW_AB
+#undef CHECK_RETURN_SHAPE
 
 Tensor Device::sum_fw(const Tensor &x, std::uint32_t dim) {
   CHECK_DEVICE(x);
@@ -512,6 +663,51 @@ Tensor Device::broadcast_fw(
   return y;
 }
 
+Tensor Device::fused_elementwise_fw(
+    const vector<const Tensor *> &xs,
+    const vector<ElementwiseInstruction> &program, const Shape &shape) {
+  Tensor y = new_raw_tensor(shape);
+  fused_elementwise_fw(xs, program, y);
+  return y;
+}
+
+void Device::fused_elementwise_fw(
+    const vector<const Tensor *> &xs,
+    const vector<ElementwiseInstruction> &program, Tensor &y) {
+  CHECK_DEVICE(y);
+  if (program.empty()) PRIMITIV_THROW_ERROR("No instructions to evaluate.");
+  const Shape &sy = y.shape();
+  for (const Tensor *x : xs) {
+    CHECK_DEVICE(*x);
+    const Shape &sx = x->shape();
+    if ((sx.volume() != sy.volume() && sx.volume() != 1) ||
+        (sx.has_batch() && sx.batch() != sy.batch())) {
+      PRIMITIV_THROW_ERROR(
+          "Shape mismatched at fused_elementwise_fw"
+          << ". x.shape: " << sx.to_string()
+          << ", y.shape: " << sy.to_string());
+    }
+  }
+  const std::uint32_t num_args = xs.size();
+  for (std::uint32_t i = 0; i < program.size(); ++i) {
+    // Each instruction can refer only arguments and preceding results.
+    const bool binary = program[i].opcode >= ElementwiseOpcode::ADD;
+    if (program[i].a >= num_args + i ||
+        (binary && program[i].b >= num_args + i)) {
+      PRIMITIV_THROW_ERROR(
+          "Invalid register at the instruction " << i
+          << ". a: " << program[i].a << ", b: " << program[i].b);
+    }
+  }
+  fused_elementwise_fw_impl(xs, program, y);
+}
+
+void Device::fused_elementwise_fw_impl(
+    const vector<const Tensor *> &, const vector<ElementwiseInstruction> &,
+    Tensor &) {
+  PRIMITIV_THROW_NOT_IMPLEMENTED;
+}
+
 Tensor Device::batch_sum_fw(const Tensor &x) {
   CHECK_DEVICE(x);
   Tensor y = new_raw_tensor(x.shape().resize_batch(1));
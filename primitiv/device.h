@@ -1,8 +1,10 @@
 #ifndef PRIMITIV_DEVICE_H_
 #define PRIMITIV_DEVICE_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <primitiv/elementwise.h>
 #include <primitiv/mixins.h>
 #include <primitiv/shape.h>
 #include <primitiv/tensor.h>
@@ -11,6 +13,9 @@ namespace primitiv {
 
 /**
  * Interface of the Tensor provider.
+ * @remarks Whether kernels can be called concurrently depends on each device.
+ *          CPU devices are thread-safe, so multiple graphs running on
+ *          different threads can share one device and one set of parameters.
  */
 class Device
     : public mixins::DefaultSettable<Device>
@@ -41,6 +46,29 @@ public:
     OPENCL = 0x00020000,
   };
 
+  /**
+   * Interface to observe memory allocations of tensors.
+   */
+  class AllocationTracker {
+  public:
+    virtual ~AllocationTracker() = default;
+
+    /**
+     * Called when a new tensor is allocated.
+     * @param tag Tag given to `set_thread_allocation_tracker()`.
+     * @param bytes Number of bytes of the tensor.
+     */
+    virtual void allocated(std::uint64_t tag, std::size_t bytes) = 0;
+
+    /**
+     * Called when the memory of a tracked tensor is released.
+     * @param tag Tag given when the tensor was allocated.
+     * @param bytes Number of bytes of the tensor.
+     * @remarks This function may be called from any thread.
+     */
+    virtual void released(std::uint64_t tag, std::size_t bytes) = 0;
+  };
+
   Device() = default;
   virtual ~Device() = default;
 
@@ -55,6 +83,35 @@ public:
    */
   virtual DeviceType type() const = 0;
 
+  /**
+   * Returns the number of memory allocations requested by the current thread.
+   * @return Total number of new tensors created by all devices on the current
+   *         thread.
+   */
+  static std::uint64_t num_thread_allocations();
+
+  /**
+   * Sets the tracker of memory allocations requested by the current thread.
+   * @param tracker Tracker object, or nullptr to stop tracking.
+   * @param tag Value passed to the tracker with each allocation.
+   * @remarks Each tracked tensor holds a reference to the tracker, and calls
+   *          `tracker->released()` when its memory is released.
+   */
+  static void set_thread_allocation_tracker(
+      std::shared_ptr<AllocationTracker> tracker, std::uint64_t tag);
+
+  /**
+   * Returns the tracker of memory allocations of the current thread.
+   * @return Tracker object, or nullptr if no tracker is set.
+   */
+  static const std::shared_ptr<AllocationTracker> &thread_allocation_tracker();
+
+  /**
+   * Returns the tag of memory allocations of the current thread.
+   * @return Tag given to `set_thread_allocation_tracker()`.
+   */
+  static std::uint64_t thread_allocation_tag();
+
 private:
   /**
    * Provides a new Tensor object on the device.
@@ -99,6 +156,22 @@ public:
    */
   Tensor copy_tensor(const Tensor &x);
 
+  /**
+   * Creates a new Tensor object which refers a part of the memory of another
+   * tensor.
+   * @param x A tensor which holds the memory.
+   * @param offset Offset of the first element in `x`.
+   * @param shape Shape of the new tensor.
+   * @return A new Tensor object.
+   * @throw primitiv::Error The device does not support views, or the range
+   *                        exceeds the size of `x`.
+   * @remarks The resulting tensor does not own the memory, and should not be
+   *          used after `x` is released. Unlike copies of `x`, writing values
+   *          into the resulting tensor does not duplicate the memory.
+   *          Currently only devices in the CPU group support this function.
+   */
+  Tensor new_tensor_view(Tensor &x, std::uint32_t offset, const Shape &shape);
+
   // Provides an identity matrix.
   Tensor identity(std::uint32_t size);
 
@@ -112,6 +185,8 @@ public:
   Tensor pick_fw(const Tensor &x, const std::vector<std::uint32_t> &ids, std::uint32_t dim);
   Tensor slice_fw(const Tensor &x, std::uint32_t dim, std::uint32_t lower, std::uint32_t upper);
   Tensor concat_fw(const std::vector<const Tensor *> &xs, std::uint32_t dim);
+  Tensor batch_slice_fw(const Tensor &x, std::uint32_t lower, std::uint32_t upper);
+  Tensor batch_concat_fw(const std::vector<const Tensor *> &xs);
 
   void pick_bw(const Tensor &gy, const std::vector<std::uint32_t> &ids, std::uint32_t dim, Tensor &gx);
   void slice_bw(const Tensor &gy, std::uint32_t dim, std::uint32_t offset, Tensor &gx);
@@ -129,6 +204,18 @@ public:
   Tensor tan_fw(const Tensor &x);
   Tensor transpose_fw(const Tensor &x);
 
+  void negate_fw(const Tensor &x, Tensor &y);
+  void sqrt_fw(const Tensor &x, Tensor &y);
+  void exp_fw(const Tensor &x, Tensor &y);
+  void log_fw(const Tensor &x, Tensor &y);
+  void tanh_fw(const Tensor &x, Tensor &y);
+  void sigmoid_fw(const Tensor &x, Tensor &y);
+  void softplus_fw(const Tensor &x, Tensor &y);
+  void sin_fw(const Tensor &x, Tensor &y);
+  void cos_fw(const Tensor &x, Tensor &y);
+  void tan_fw(const Tensor &x, Tensor &y);
+  void transpose_fw(const Tensor &x, Tensor &y);
+
   void sqrt_bw(const Tensor &x, const Tensor &y, const Tensor &gy, Tensor &gx);
   void exp_bw(const Tensor &x, const Tensor &y, const Tensor &gy, Tensor &gx);
   void log_bw(const Tensor &x, const Tensor &y, const Tensor &gy, Tensor &gx);
@@ -154,6 +241,19 @@ public:
 
   Tensor pown_fw(const Tensor &x, std::int32_t k);
 
+  void add_const_fw(const Tensor &x, float k, Tensor &y);
+  void subtract_const_r_fw(const Tensor &x, float k, Tensor &y);
+  void subtract_const_l_fw(const Tensor &x, float k, Tensor &y);
+  void multiply_const_fw(const Tensor &x, float k, Tensor &y);
+  void divide_const_r_fw(const Tensor &x, float k, Tensor &y);
+  void divide_const_l_fw(const Tensor &x, float k, Tensor &y);
+  void pow_const_r_fw(const Tensor &x, float k, Tensor &y);
+  void pow_const_l_fw(const Tensor &x, float k, Tensor &y);
+  void prelu_fw(const Tensor &x, float k, Tensor &y);
+  void elu_fw(const Tensor &x, float k, Tensor &y);
+
+  void pown_fw(const Tensor &x, std::int32_t k, Tensor &y);
+
   void add_const_bw(const Tensor &x, const Tensor &y, const Tensor &gy, float k, Tensor &gx);
   void subtract_const_r_bw(const Tensor &x, const Tensor &y, const Tensor &gy, float k, Tensor &gx);
   void subtract_const_l_bw(const Tensor &x, const Tensor &y, const Tensor &gy, float k, Tensor &gx);
@@ -177,6 +277,15 @@ public:
   Tensor pow_scalar_r_fw(const Tensor &x, const Tensor &k);
   Tensor pow_scalar_l_fw(const Tensor &x, const Tensor &k);
 
+  void add_scalar_fw(const Tensor &x, const Tensor &k, Tensor &y);
+  void subtract_scalar_r_fw(const Tensor &x, const Tensor &k, Tensor &y);
+  void subtract_scalar_l_fw(const Tensor &x, const Tensor &k, Tensor &y);
+  void multiply_scalar_fw(const Tensor &x, const Tensor &k, Tensor &y);
+  void divide_scalar_r_fw(const Tensor &x, const Tensor &k, Tensor &y);
+  void divide_scalar_l_fw(const Tensor &x, const Tensor &k, Tensor &y);
+  void pow_scalar_r_fw(const Tensor &x, const Tensor &k, Tensor &y);
+  void pow_scalar_l_fw(const Tensor &x, const Tensor &k, Tensor &y);
+
   // Binary operations.
   Tensor add_fw(const Tensor &a, const Tensor &b);
   Tensor subtract_fw(const Tensor &a, const Tensor &b);
@@ -185,6 +294,13 @@ public:
   Tensor pow_fw(const Tensor &a, const Tensor &b);
   Tensor matmul_fw(const Tensor &a, const Tensor &b);
 
+  void add_fw(const Tensor &a, const Tensor &b, Tensor &y);
+  void subtract_fw(const Tensor &a, const Tensor &b, Tensor &y);
+  void multiply_fw(const Tensor &a, const Tensor &b, Tensor &y);
+  void divide_fw(const Tensor &a, const Tensor &b, Tensor &y);
+  void pow_fw(const Tensor &a, const Tensor &b, Tensor &y);
+  void matmul_fw(const Tensor &a, const Tensor &b, Tensor &y);
+
   void add_bw(
       const Tensor &a, const Tensor &b, const Tensor &y, const Tensor &gy,
       Tensor &ga, Tensor &gb);
@@ -204,6 +320,17 @@ public:
       const Tensor &a, const Tensor &b, const Tensor &y, const Tensor &gy,
       Tensor &ga, Tensor &gb);
 
+  // Fused elementwise operations.
+  // Each argument should have the same volume as the result or only one
+  // element, and its minibatch should be broadcastable to the result.
+  // Currently only Naive and Eigen devices support these functions.
+  Tensor fused_elementwise_fw(
+      const std::vector<const Tensor *> &xs,
+      const std::vector<ElementwiseInstruction> &program, const Shape &shape);
+  void fused_elementwise_fw(
+      const std::vector<const Tensor *> &xs,
+      const std::vector<ElementwiseInstruction> &program, Tensor &y);
+
   // Dimension operations.
   Tensor sum_fw(const Tensor &x, std::uint32_t dim);
   Tensor logsumexp_fw(const Tensor &x, std::uint32_t dim);
@@ -340,6 +467,14 @@ protected:
   void reset_tensor_by_vector(const std::vector<float> &values, Tensor &x);
 
 private:
+  /**
+   * Allocates the memory of a new tensor and notifies the allocation to the
+   * tracker of the current thread.
+   * @param shape Shape of the tensor.
+   * @return Handle of the memory.
+   */
+  std::shared_ptr<void> new_tracked_handle(const Shape &shape);
+
   // device-specific implementations.
 
   virtual std::shared_ptr<void> new_handle(const Shape &shape) = 0;
@@ -451,6 +586,10 @@ private:
       const Tensor &a, const Tensor &b, const Tensor &y, const Tensor &gy,
       Tensor &ga, Tensor &gb) = 0;
 
+  virtual void fused_elementwise_fw_impl(
+      const std::vector<const Tensor *> &xs,
+      const std::vector<ElementwiseInstruction> &program, Tensor &y);
+
   virtual void sum_fw_impl(const Tensor &x, std::uint32_t dim, Tensor &y) = 0;
   virtual void logsumexp_fw_impl(const Tensor &x, std::uint32_t dim, Tensor &y) = 0;
   virtual void broadcast_fw_impl(const Tensor &x, std::uint32_t dim, std::uint32_t size, Tensor &y) = 0;
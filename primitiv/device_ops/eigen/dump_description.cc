@@ -11,6 +11,16 @@ namespace devices {
 void Eigen::dump_description() const {
   std::cerr << "Device " << this << std::endl;
   std::cerr << "  Type: Eigen" << std::endl;
+  std::cerr << "  Memory pool: " << (pool_ ? "enabled" : "disabled")
+    << std::endl;
+  if (pool_) {
+    const MemoryPool::Statistics stats = pool_->get_statistics();
+    std::cerr << "    In use: " << stats.in_use_bytes << " bytes" << std::endl;
+    std::cerr << "    Reserved: " << stats.reserved_bytes << " bytes"
+      << std::endl;
+    std::cerr << "    Peak allocated: " << stats.peak_allocated_bytes
+      << " bytes" << std::endl;
+  }
 }
 
 }  // namespace devices
@@ -0,0 +1,117 @@
+#include <primitiv/config.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include <primitiv/eigen_device.h>
+#include <primitiv/device_ops/eigen/common.h>
+
+namespace primitiv {
+namespace devices {
+
+void Eigen::fused_elementwise_fw_impl(
+    const std::vector<const Tensor *> &xs,
+    const std::vector<ElementwiseInstruction> &program, Tensor &y_) {
+  // Instructions are applied to each block of elements, so that intermediate
+  // results are kept in the cache.
+  const std::uint32_t block_size = 1024;
+  const std::uint32_t size = y_.shape().volume();
+  const std::uint32_t bs = y_.shape().batch();
+  const std::uint32_t num_args = xs.size();
+  const std::uint32_t num_insts = program.size();
+  std::vector<const float *> src(num_args);
+  std::vector<std::uint32_t> skip(num_args);
+  for (std::uint32_t j = 0; j < num_args; ++j) {
+    src[j] = CDATA(*xs[j]);
+    skip[j] = xs[j]->shape().has_batch() * xs[j]->shape().volume();
+  }
+  std::vector<EArrayXf> regs(
+      num_args + num_insts, EArrayXf(std::min(block_size, size)));
+  float *dest = MDATA(y_);
+
+  for (std::uint32_t batch = 0; batch < bs; ++batch) {
+    for (std::uint32_t begin = 0; begin < size; begin += block_size) {
+      const std::uint32_t n = std::min(block_size, size - begin);
+      for (std::uint32_t j = 0; j < num_args; ++j) {
+        if (xs[j]->shape().volume() == size) {
+          regs[j].head(n) = EMap<const EArrayXf>(src[j] + begin, n);
+        } else {
+          regs[j].head(n).setConstant(*src[j]);
+        }
+      }
+
+      for (std::uint32_t j = 0; j < num_insts; ++j) {
+        const ElementwiseInstruction &inst = program[j];
+        const auto x = regs[inst.a].head(n);
+        const float k = inst.k;
+        auto y = regs[num_args + j].head(n);
+        switch (inst.opcode) {
+          case ElementwiseOpcode::NEGATE: y = -x; break;
+          case ElementwiseOpcode::SQRT: y = x.sqrt(); break;
+          case ElementwiseOpcode::EXP: y = x.exp(); break;
+          case ElementwiseOpcode::LOG: y = x.log(); break;
+          case ElementwiseOpcode::TANH: y = x.tanh(); break;
+          case ElementwiseOpcode::SIGMOID: y = .5 + .5 * (.5 * x).tanh(); break;
+          case ElementwiseOpcode::SOFTPLUS:
+            y = (x > 0.).select(
+                x + (1. + (-x).exp()).log(),
+                (1. + x.exp()).log());
+            break;
+          case ElementwiseOpcode::SIN: y = x.sin(); break;
+          case ElementwiseOpcode::COS: y = x.cos(); break;
+          case ElementwiseOpcode::TAN: y = x.tan(); break;
+          case ElementwiseOpcode::ADD_CONST: y = x + k; break;
+          case ElementwiseOpcode::SUBTRACT_CONST_R: y = x - k; break;
+          case ElementwiseOpcode::SUBTRACT_CONST_L: y = k - x; break;
+          case ElementwiseOpcode::MULTIPLY_CONST: y = x * k; break;
+          case ElementwiseOpcode::DIVIDE_CONST_R: y = x / k; break;
+          case ElementwiseOpcode::DIVIDE_CONST_L: y = k / x; break;
+          case ElementwiseOpcode::POW_CONST_R: y = x.pow(k); break;
+          case ElementwiseOpcode::POW_CONST_L: y = ::Eigen::pow(k, x); break;
+          case ElementwiseOpcode::PRELU: y = (x > 0.).select(x, k * x); break;
+          case ElementwiseOpcode::ELU:
+            y = (x > 0.).select(x, k * (x.exp() - 1.));
+            break;
+          case ElementwiseOpcode::POWN:
+            {
+              // Performs the exponentation-by-squaring method.
+              const std::int32_t p = static_cast<std::int32_t>(k);
+              const std::int32_t min_p =
+                std::numeric_limits<std::int32_t>::min();
+              std::uint32_t remain = (p == min_p) ? min_p : std::abs(p);
+              EArrayXf factor = x;
+              y.setConstant(1.);
+              while (remain) {
+                if (remain & 1) y *= factor;
+                factor *= factor;
+                remain >>= 1;
+              }
+              if (p < 0) y = 1. / y;
+            }
+            break;
+          case ElementwiseOpcode::ADD: y = x + regs[inst.b].head(n); break;
+          case ElementwiseOpcode::SUBTRACT:
+            y = x - regs[inst.b].head(n);
+            break;
+          case ElementwiseOpcode::MULTIPLY:
+            y = x * regs[inst.b].head(n);
+            break;
+          case ElementwiseOpcode::DIVIDE: y = x / regs[inst.b].head(n); break;
+          case ElementwiseOpcode::POW: y = x.pow(regs[inst.b].head(n)); break;
+        }
+      }
+
+      EMap<EArrayXf>(dest + begin, n) = regs.back().head(n);
+    }
+    dest += size;
+    for (std::uint32_t j = 0; j < num_args; ++j) {
+      src[j] += skip[j];
+    }
+  }
+}
+
+}  // namespace devices
+}  // namespace primitiv
@@ -10,6 +10,7 @@ namespace devices {
 
 std::shared_ptr<void> Eigen::new_handle(const Shape &shape) {
   const std::uint32_t mem_size = sizeof(float) * shape.size();
+  if (pool_) return pool_->allocate(mem_size);
   void *data = std::malloc(mem_size);
   if (!data) {
     PRIMITIV_THROW_ERROR("Memory allocation failed. Requested size: " << mem_size);
@@ -0,0 +1,113 @@
+#include <primitiv/config.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include <primitiv/naive_device.h>
+#include <primitiv/device_ops/naive/common.h>
+
+namespace {
+
+using primitiv::ElementwiseInstruction;
+using primitiv::ElementwiseOpcode;
+
+// Calculates one instruction using given registers.
+inline float evaluate(const ElementwiseInstruction &inst, const float *regs) {
+  const float a = regs[inst.a];
+  const float k = inst.k;
+  switch (inst.opcode) {
+    case ElementwiseOpcode::NEGATE: return -a;
+    case ElementwiseOpcode::SQRT: return std::sqrt(a);
+    case ElementwiseOpcode::EXP: return std::exp(a);
+    case ElementwiseOpcode::LOG: return std::log(a);
+    case ElementwiseOpcode::TANH: return std::tanh(a);
+    case ElementwiseOpcode::SIGMOID: return .5 + .5 * std::tanh(.5 * a);
+    case ElementwiseOpcode::SOFTPLUS:
+      return a > 0
+        ? a + std::log(1 + std::exp(-a))
+        : std::log(1 + std::exp(a));
+    case ElementwiseOpcode::SIN: return std::sin(a);
+    case ElementwiseOpcode::COS: return std::cos(a);
+    case ElementwiseOpcode::TAN: return std::tan(a);
+    case ElementwiseOpcode::ADD_CONST: return a + k;
+    case ElementwiseOpcode::SUBTRACT_CONST_R: return a - k;
+    case ElementwiseOpcode::SUBTRACT_CONST_L: return k - a;
+    case ElementwiseOpcode::MULTIPLY_CONST: return a * k;
+    case ElementwiseOpcode::DIVIDE_CONST_R: return a / k;
+    case ElementwiseOpcode::DIVIDE_CONST_L: return k / a;
+    case ElementwiseOpcode::POW_CONST_R: return std::pow(a, k);
+    case ElementwiseOpcode::POW_CONST_L: return std::pow(k, a);
+    case ElementwiseOpcode::PRELU: return a * ((a > 0) + k * (a <= 0));
+    case ElementwiseOpcode::ELU:
+      return a * (a > 0) + k * (std::exp(a * (a <= 0)) - 1);
+    case ElementwiseOpcode::POWN:
+      {
+        // Performs the exponentation-by-squaring method.
+        const std::int32_t n = static_cast<std::int32_t>(k);
+        const std::int32_t min_n = std::numeric_limits<std::int32_t>::min();
+        std::uint32_t remain = (n == min_n) ? min_n : std::abs(n);
+        float ret = 1.;
+        float factor = a;
+        while (remain) {
+          if (remain & 1) ret *= factor;
+          factor *= factor;
+          remain >>= 1;
+        }
+        return n >= 0 ? ret : 1. / ret;
+      }
+    case ElementwiseOpcode::ADD: return a + regs[inst.b];
+    case ElementwiseOpcode::SUBTRACT: return a - regs[inst.b];
+    case ElementwiseOpcode::MULTIPLY: return a * regs[inst.b];
+    case ElementwiseOpcode::DIVIDE: return a / regs[inst.b];
+    case ElementwiseOpcode::POW: return std::pow(a, regs[inst.b]);
+  }
+  return 0;  // Not reached.
+}
+
+}  // namespace
+
+namespace primitiv {
+namespace devices {
+
+void Naive::fused_elementwise_fw_impl(
+    const std::vector<const Tensor *> &xs,
+    const std::vector<ElementwiseInstruction> &program, Tensor &y) {
+  const std::uint32_t size = y.shape().volume();
+  const std::uint32_t bs = y.shape().batch();
+  const std::uint32_t num_args = xs.size();
+  const std::uint32_t num_insts = program.size();
+  std::vector<const float *> src(num_args);
+  std::vector<std::uint32_t> stride(num_args);
+  std::vector<std::uint32_t> skip(num_args);
+  for (std::uint32_t j = 0; j < num_args; ++j) {
+    const Shape &s = xs[j]->shape();
+    src[j] = CDATA(*xs[j]);
+    stride[j] = s.volume() == size;
+    skip[j] = s.has_batch() * s.volume();
+  }
+
+  // All results of instructions are calculated element by element, so that
+  // each argument is read only once and only the last result is written.
+  std::vector<float> regs(num_args + num_insts);
+  float *dest = MDATA(y);
+  for (std::uint32_t batch = 0; batch < bs; ++batch) {
+    for (std::uint32_t i = 0; i < size; ++i) {
+      for (std::uint32_t j = 0; j < num_args; ++j) {
+        regs[j] = src[j][i * stride[j]];
+      }
+      for (std::uint32_t j = 0; j < num_insts; ++j) {
+        regs[num_args + j] = ::evaluate(program[j], regs.data());
+      }
+      dest[i] = regs.back();
+    }
+    dest += size;
+    for (std::uint32_t j = 0; j < num_args; ++j) {
+      src[j] += skip[j];
+    }
+  }
+}
+
+}  // namespace devices
+}  // namespace primitiv
@@ -0,0 +1,63 @@
+#ifndef PRIMITIV_ELEMENTWISE_H_
+#define PRIMITIV_ELEMENTWISE_H_
+
+#include <cstdint>
+
+namespace primitiv {
+
+/**
+ * Kinds of elementwise operations which can be fused into one operation.
+ */
+enum class ElementwiseOpcode : std::uint32_t {
+  // Unary operations: y = f(a)
+  NEGATE,
+  SQRT,
+  EXP,
+  LOG,
+  TANH,
+  SIGMOID,
+  SOFTPLUS,
+  SIN,
+  COS,
+  TAN,
+
+  // Unary operations with a constant: y = f(a, k)
+  ADD_CONST,
+  SUBTRACT_CONST_R,
+  SUBTRACT_CONST_L,
+  MULTIPLY_CONST,
+  DIVIDE_CONST_R,
+  DIVIDE_CONST_L,
+  POW_CONST_R,
+  POW_CONST_L,
+  PRELU,
+  ELU,
+  POWN,
+
+  // Binary operations: y = f(a, b)
+  ADD,
+  SUBTRACT,
+  MULTIPLY,
+  DIVIDE,
+  POW,
+};
+
+/**
+ * An instruction of fused elementwise operations.
+ * @remarks Each operand is an index of registers. When the fused operation
+ *          takes `n` arguments, registers `0` to `n - 1` hold elements of the
+ *          arguments, and register `n + i` holds the result of the `i`-th
+ *          instruction. The result of the last instruction is the result of
+ *          the fused operation. `b` is used only by binary operations, and
+ *          `k` is used only by operations with a constant.
+ */
+struct ElementwiseInstruction {
+  ElementwiseOpcode opcode;
+  std::uint32_t a;
+  std::uint32_t b;
+  float k;
+};
+
+}  // namespace primitiv
+
+#endif  // PRIMITIV_ELEMENTWISE_H_
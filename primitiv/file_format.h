@@ -20,6 +20,7 @@ public:
     PARAMETER = 0x200,
     MODEL     = 0x300,
     OPTIMIZER = 0x400,
+    GRAPH     = 0x500,
   };
 
   static void assert_version(std::uint32_t major, std::uint32_t minor) {
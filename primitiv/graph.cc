@@ -1,14 +1,32 @@
 #include <primitiv/config.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <exception>
+#include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include <utility>
+#include <primitiv/device.h>
 #include <primitiv/error.h>
+#include <primitiv/file_format.h>
 #include <primitiv/functions.h>
 #include <primitiv/graph.h>
+#include <primitiv/model.h>
+#include <primitiv/msgpack/reader.h>
+#include <primitiv/msgpack/writer.h>
+#include <primitiv/operator_impl.h>
+#include <primitiv/parameter.h>
 #include <primitiv/string_utils.h>
+#include <primitiv/thread_pool.h>
 
 using std::cerr;
 using std::cout;
@@ -16,10 +34,184 @@ using std::endl;
 using std::move;
 using std::vector;
 
+namespace {
+
+/**
+ * Executes tasks with dependencies using the thread pool.
+ * @param pool ThreadPool object to execute tasks.
+ * @param num_deps Number of unfinished predecessors of each task.
+ * @param succs List of successors of each task.
+ * @param fn Function to execute a task, which takes the task ID.
+ * @remarks This function blocks until all tasks are finished. If some tasks
+ *          threw exceptions, remaining tasks are skipped and the first
+ *          exception is rethrown.
+ */
+void run_dag(
+    primitiv::ThreadPool &pool,
+    vector<std::uint32_t> &num_deps,
+    const vector<vector<std::uint32_t>> &succs,
+    const std::function<void(std::uint32_t)> &fn) {
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::uint32_t num_running = 0;
+  std::exception_ptr error;
+
+  // `submit` is always called with the lock.
+  std::function<void(std::uint32_t)> submit = [&](std::uint32_t task) {
+    ++num_running;
+    pool.submit([&, task] {
+      bool skip;
+      {
+        const std::lock_guard<std::mutex> lock(mutex);
+        skip = !!error;
+      }
+      std::exception_ptr cur_error;
+      if (!skip) {
+        try {
+          fn(task);
+        } catch (...) {
+          cur_error = std::current_exception();
+        }
+      }
+      const std::lock_guard<std::mutex> lock(mutex);
+      if (cur_error) {
+        if (!error) error = cur_error;
+      } else if (!error) {
+        for (const std::uint32_t succ : succs[task]) {
+          if (--num_deps[succ] == 0) submit(succ);
+        }
+      }
+      if (--num_running == 0) cond.notify_all();
+    });
+  };
+
+  std::unique_lock<std::mutex> lock(mutex);
+  for (std::uint32_t i = 0; i < num_deps.size(); ++i) {
+    if (num_deps[i] == 0) submit(i);
+  }
+  cond.wait(lock, [&] { return num_running == 0; });
+  if (error) std::rethrow_exception(error);
+}
+
+/**
+ * Attributes memory allocations on the current thread to an operation while
+ * the object is alive.
+ */
+class AllocationScope {
+public:
+  /**
+   * @param tracker Tracker object, or nullptr to do nothing.
+   * @param oid Operator ID.
+   * @param backward `true` if the operation is the backward operation.
+   */
+  AllocationScope(
+      std::shared_ptr<primitiv::Device::AllocationTracker> tracker,
+      std::uint32_t oid, bool backward)
+  : enabled_(!!tracker), prev_tag_(0) {
+    using primitiv::Device;
+    if (!enabled_) return;
+    prev_tracker_ = Device::thread_allocation_tracker();
+    prev_tag_ = Device::thread_allocation_tag();
+    Device::set_thread_allocation_tracker(
+        move(tracker), static_cast<std::uint64_t>(oid) << 1 | backward);
+  }
+
+  ~AllocationScope() {
+    if (!enabled_) return;
+    primitiv::Device::set_thread_allocation_tracker(
+        move(prev_tracker_), prev_tag_);
+  }
+
+private:
+  bool enabled_;
+  std::shared_ptr<primitiv::Device::AllocationTracker> prev_tracker_;
+  std::uint64_t prev_tag_;
+};
+
+}  // namespace
+
 namespace primitiv {
 
+/**
+ * Records the memory usage of each operation.
+ * @remarks Tags of allocations consist of the operator ID and the direction
+ *          of the operation: `oid << 1 | backward`.
+ */
+class Graph::MemoryTracker : public Device::AllocationTracker {
+public:
+  struct Usage {
+    std::size_t live;
+    std::size_t peak;
+    std::size_t total;
+  };
+
+  MemoryTracker() : usage_(), summary_ { 0, 0, 0, 0 } {}
+
+  void allocated(std::uint64_t tag, std::size_t bytes) override {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    Usage &u = usage_[tag];
+    u.live += bytes;
+    u.total += bytes;
+    u.peak = std::max(u.peak, u.live);
+    summary_.live_bytes += bytes;
+    summary_.peak_bytes = std::max(summary_.peak_bytes, summary_.live_bytes);
+    (tag & 1 ? summary_.backward_bytes : summary_.forward_bytes) += bytes;
+  }
+
+  void released(std::uint64_t tag, std::size_t bytes) override {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    usage_[tag].live -= bytes;
+    summary_.live_bytes -= bytes;
+  }
+
+  MemoryUsage summary() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return summary_;
+  }
+
+  std::unordered_map<std::uint64_t, Usage> usage() const {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return usage_;
+  }
+
+private:
+  std::unordered_map<std::uint64_t, Usage> usage_;
+  MemoryUsage summary_;
+  mutable std::mutex mutex_;
+};
+
+Graph::Graph()
+: inference_mode_(false)
+, deterministic_(false)
+, checkpointing_(false)
+, subexpression_sharing_(false)
+, constant_folding_(false)
+, operator_fusion_(false)
+, memory_planning_(false)
+, profiling_(false)
+, autobatching_(false)
+, visit_count_(0) {}
+
+Graph::~Graph() = default;
+
+void Graph::set_num_threads(std::uint32_t num_threads) {
+  pool_.reset(num_threads > 0 ? new ThreadPool(num_threads) : nullptr);
+}
+
+std::uint32_t Graph::num_threads() const {
+  return pool_ ? pool_->num_threads() : 0;
+}
+
 void Graph::clear() {
   ops_.clear();
+  // Tensors released above notify the previous tracker.
+  if (memory_tracker_) memory_tracker_.reset(new MemoryTracker());
+  plan_.clear();
+  plan_targets_.clear();
+  arenas_.clear();
+  shared_ops_.clear();
+  // All objects in the arena were destroyed above.
+  arena_.reset();
 }
 
 #define CHECK_NODE(n) { \
@@ -40,11 +232,76 @@ void Graph::clear() {
   } \
 }
 
+vector<Node> Graph::detach(const vector<Node> &nodes) {
+  // Retrieves values of unique nodes before discarding operators.
+  std::unordered_map<std::uint64_t, std::uint32_t> ids;
+  vector<Tensor> values;
+  vector<std::uint32_t> positions;
+  positions.reserve(nodes.size());
+  for (const Node &node : nodes) {
+    CHECK_NODE(node);
+    const std::uint64_t key =
+      static_cast<std::uint64_t>(node.oid_) << 32 | node.vid_;
+    const auto it = ids.find(key);
+    if (it != ids.end()) {
+      positions.emplace_back(it->second);
+    } else {
+      positions.emplace_back(values.size());
+      ids.emplace(key, values.size());
+      values.emplace_back(forward(node));
+    }
+  }
+
+  clear();
+
+  vector<Node> detached;
+  detached.reserve(values.size());
+  for (const Tensor &value : values) {
+    Operator *op = new_operator<operators::Detached>(value);
+    const std::uint32_t oid = add_operator_impl(
+        OperatorPtr(op, OperatorDeleter { true }), nullptr, 0);
+    detached.emplace_back(Node { *this, oid, 0 });
+  }
+
+  vector<Node> results;
+  results.reserve(nodes.size());
+  for (const std::uint32_t pos : positions) {
+    results.emplace_back(detached[pos]);
+  }
+  return results;
+}
+
 vector<Node> Graph::add_operator(
     std::unique_ptr<Operator> &&op, const std::vector<Node> &args) {
+  const std::uint32_t oid = add_operator_impl(
+      OperatorPtr(op.release(), OperatorDeleter { false }),
+      args.data(), args.size());
+  const std::uint32_t retn = ops_[oid].rets.size();
+  vector<Node> nodes;
+  nodes.reserve(retn);
+  for (std::uint32_t i = 0; i < retn; ++i) {
+    nodes.emplace_back(Node { *this, oid, i });
+  }
+  return nodes;
+}
+
+Node Graph::add_arena_operator(
+    Operator *op, std::initializer_list<Node> args) {
+  const std::uint32_t oid = add_operator_impl(
+      OperatorPtr(op, OperatorDeleter { true }), args.begin(), args.size());
+  return Node { *this, oid, 0 };
+}
+
+Node Graph::add_arena_operator(Operator *op, const std::vector<Node> &args) {
+  const std::uint32_t oid = add_operator_impl(
+      OperatorPtr(op, OperatorDeleter { true }), args.data(), args.size());
+  return Node { *this, oid, 0 };
+}
+
+std::uint32_t Graph::add_operator_impl(
+    OperatorPtr &&op, const Node *args, std::uint32_t argn) {
   const std::uint32_t argn_req = op->num_arguments();
   const std::uint32_t retn = op->num_returns();
-  const std::uint32_t argn = args.size();
 
   // Checks the number of arguments.
   if (argn_req == Operator::NONZERO) {
@@ -75,150 +332,1277 @@ vector<Node> Graph::add_operator(
   }
 
   // Gathers information of arguments.
-  vector<Address> arg_addrs(argn);
-  vector<const Shape *> arg_shapes(argn);
+  ArgumentList arg_addrs(argn, arena_);
+  arg_shapes_.resize(argn);
   for (std::uint32_t i = 0; i < argn; ++i) {
     const Node &arg = args[i];
     CHECK_NODE(arg);
     arg_addrs[i] = { arg.oid_, arg.vid_ };
-    arg_shapes[i] = &ops_[arg.oid_].rets[arg.vid_].shape;
+    arg_shapes_[i] = &ops_[arg.oid_].rets[arg.vid_].shape;
+  }
+
+  // Looks up the identical operator if available.
+  std::string key;
+  bool constant = false;
+  if (subexpression_sharing_ || constant_folding_) {
+    std::string sig = op->signature();
+    if (!sig.empty()) {
+      constant = constant_folding_ && !op->has_trainable_values();
+      for (const Address &arg_addr : arg_addrs) {
+        constant = constant && ops_[arg_addr.oid].constant;
+      }
+      if (subexpression_sharing_) {
+        key = move(sig);
+        key.append(
+            reinterpret_cast<const char *>(&ret_device), sizeof(ret_device));
+        for (const Address &arg_addr : arg_addrs) {
+          key.append(
+              reinterpret_cast<const char *>(&arg_addr), sizeof(arg_addr));
+        }
+        const auto it = shared_ops_.find(key);
+        if (it != shared_ops_.end()) return it->second;
+      }
+    }
   }
 
   // Makes nodes of return values.
-  vector<NodeInfo> rets(retn);
-  vector<Shape *> ret_shapes(retn);
+  // NodeInfo objects are allocated in the arena and never reallocated.
+  NodeInfoList rets(retn, NodeInfo(), ArenaAllocator<NodeInfo>(arena_));
+  ret_shapes_.resize(retn);
   for (std::uint32_t i = 0; i < retn; ++i) {
     rets[i].device = ret_device;
-    ret_shapes[i] = &rets[i].shape;
+    rets[i].num_pending_sinks = 0;
+    ret_shapes_[i] = &rets[i].shape;
   }
 
   // Calculates the shape of the resulting value.
   // This may throw an exception when trying an invalid operation.
-  op->forward_shape(arg_shapes, ret_shapes);
+  op->forward_shape(arg_shapes_, ret_shapes_);
 
   // Updates the graph.
   const std::uint32_t ret_oid = ops_.size();
-  //for (const Address &arg_addr : arg_addrs) {
-  //  ops_[arg_addr.oid].rets[arg_addr.vid].sinks.emplace_back(ret_oid);
-  //}
-  ops_.emplace_back(OperatorInfo { move(op), move(arg_addrs), move(rets) });
+  bool requires_grad = op->has_trainable_values();
+  for (const Address &arg_addr : arg_addrs) {
+    OperatorInfo &arg_f = ops_[arg_addr.oid];
+    ++arg_f.rets[arg_addr.vid].num_pending_sinks;
+    requires_grad = requires_grad || arg_f.requires_grad;
+  }
+  ops_.emplace_back(
+      OperatorInfo {
+        move(op), move(arg_addrs), move(rets), 0, requires_grad,
+        checkpointing_ && argn > 0, constant });
+  if (!key.empty()) {
+    shared_ops_.emplace(move(key), ret_oid);
+  }
 
-  // Creates Node objects.
-  vector<Node> nodes;
-  nodes.reserve(retn);
+  // Folds constants by calculating the new operator immediately.
+  if (constant && argn > 0) {
+    targets_.clear();
+    for (std::uint32_t i = 0; i < retn; ++i) {
+      targets_.emplace_back(Address { ret_oid, i });
+    }
+    make_schedule(targets_, false, schedule_);
+    for (const std::uint32_t oid : schedule_) {
+      forward_operator(oid, ws_);
+      release_arguments(oid);
+    }
+  }
+
+  return ret_oid;
+}
+
+void Graph::make_schedule(
+    const vector<Address> &targets, bool force,
+    vector<std::uint32_t> &schedule) {
+  schedule.clear();
+  const std::uint64_t visit_id = ++visit_count_;
+  const auto required = [&](const Address addr) {
+    return force
+      ? !ops_[addr.oid].op->has_inner_values()
+      : !is_calculated(addr);
+  };
+
+  // Performs the depth-first search with an explicit stack to obtain the
+  // post-order of required operators, which is also a topological order.
+  // Each stack entry holds the operator ID and the index of the next argument
+  // to be visited.
+  for (const Address target : targets) {
+    if (!required(target) || ops_[target.oid].visited == visit_id) {
+      continue;
+    }
+    ops_[target.oid].visited = visit_id;
+    stack_.emplace_back(target.oid, 0);
+
+    while (!stack_.empty()) {
+      auto &top = stack_.back();
+      const OperatorInfo &cur_f = ops_[top.first];
+      if (top.second < cur_f.args.size()) {
+        const Address arg = cur_f.args[top.second++];
+        OperatorInfo &arg_f = ops_[arg.oid];
+        if (required(arg) && arg_f.visited != visit_id) {
+          arg_f.visited = visit_id;
+          stack_.emplace_back(arg.oid, 0);
+        }
+      } else {
+        schedule.emplace_back(top.first);
+        stack_.pop_back();
+      }
+    }
+  }
+}
+
+bool Graph::is_parallelizable(const vector<std::uint32_t> &oids) const {
+  if (!pool_) return false;
+  const auto cpu = static_cast<std::uint32_t>(Device::DeviceType::GROUP_CPU);
+  const auto filter =
+    static_cast<std::uint32_t>(Device::DeviceType::GROUP_FILTER);
+  for (const std::uint32_t oid : oids) {
+    for (const NodeInfo &ret : ops_[oid].rets) {
+      if ((static_cast<std::uint32_t>(ret.device->type()) & filter) != cpu) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void Graph::forward_operator(std::uint32_t oid, WorkSpace &ws) {
+  OperatorInfo &cur_f = ops_[oid];
+  const std::uint32_t argn = cur_f.args.size();
+  const std::uint32_t retn = cur_f.rets.size();
+
+  // Gathers arguments and return values.
+  ws.args_v.resize(argn);
+  ws.rets.resize(retn);
+  for (std::uint32_t i = 0; i < argn; ++i) {
+    ws.args_v[i] = get_value(cur_f.args[i]);
+  }
   for (std::uint32_t i = 0; i < retn; ++i) {
-    nodes.emplace_back(Node { *this, ret_oid, i });
+    ws.rets[i] = &cur_f.rets[i].value;
   }
-  return nodes;
+
+  // Calculates the value.
+  invoke_forward(oid, *cur_f.op, ws.args_v, ws.rets);
+}
+
+void Graph::invoke_forward(
+    std::uint32_t oid, const Operator &op,
+    const vector<const Tensor *> &args, const vector<Tensor *> &rets) {
+  const AllocationScope scope(memory_tracker_, oid, false);
+  if (!profiling_) {
+    op.forward(args, rets);
+    return;
+  }
+  const auto begin = std::chrono::steady_clock::now();
+  const std::uint64_t num_allocations = Device::num_thread_allocations();
+  op.forward(args, rets);
+  record_profile(oid, op, false, begin, num_allocations, rets);
+}
+
+void Graph::release_arguments(std::uint32_t oid) {
+  for (const Address arg : ops_[oid].args) {
+    OperatorInfo &arg_f = ops_[arg.oid];
+    NodeInfo &arg_n = arg_f.rets[arg.vid];
+    if (arg_n.num_pending_sinks > 0) {
+      --arg_n.num_pending_sinks;
+    }
+    if ((inference_mode_ || arg_f.recomputable || arg_f.constant) &&
+        arg_n.num_pending_sinks == 0) {
+      // This value is no longer required by any operators.
+      arg_n.value.invalidate();
+    }
+  }
+}
+
+void Graph::forward_parallel() {
+  // Operators without arguments are calculated on this thread in the
+  // scheduled order, because some of them use the shared random number
+  // generator of the device.
+  vector<std::uint32_t> oids;
+  for (const std::uint32_t oid : schedule_) {
+    if (ops_[oid].args.empty()) {
+      forward_operator(oid, ws_);
+    } else {
+      oids.emplace_back(oid);
+    }
+  }
+
+  // Makes the dependency graph between remaining operators. Scheduled
+  // operators are marked by `visited` in `make_schedule()`.
+  const std::uint32_t num_tasks = oids.size();
+  if (task_ids_.size() < ops_.size()) task_ids_.resize(ops_.size());
+  for (std::uint32_t i = 0; i < num_tasks; ++i) {
+    task_ids_[oids[i]] = i;
+  }
+  vector<std::uint32_t> num_deps(num_tasks, 0);
+  vector<vector<std::uint32_t>> succs(num_tasks);
+  for (std::uint32_t i = 0; i < num_tasks; ++i) {
+    for (const Address arg : ops_[oids[i]].args) {
+      const OperatorInfo &arg_f = ops_[arg.oid];
+      if (arg_f.visited == visit_count_ && !arg_f.args.empty()) {
+        succs[task_ids_[arg.oid]].emplace_back(i);
+        ++num_deps[i];
+      }
+    }
+  }
+
+  std::mutex mutex;
+  run_dag(*pool_, num_deps, succs, [&](std::uint32_t task) {
+    thread_local WorkSpace ws;
+    forward_operator(oids[task], ws);
+    const std::lock_guard<std::mutex> lock(mutex);
+    release_arguments(oids[task]);
+  });
 }
 
 const Tensor &Graph::forward(const Node &node) {
   CHECK_NODE(node);
+  const Address addr { node.oid_, node.vid_ };
+  if (!is_calculated(addr)) forward_targets({ addr });
+  return *get_value(addr);
+}
+
+vector<const Tensor *> Graph::forward(const vector<Node> &nodes) {
+  vector<Address> targets;
+  targets.reserve(nodes.size());
+  for (const Node &node : nodes) {
+    CHECK_NODE(node);
+    targets.emplace_back(Address { node.oid_, node.vid_ });
+  }
+  forward_targets(targets);
+
+  vector<const Tensor *> values;
+  values.reserve(targets.size());
+  for (const Address addr : targets) {
+    values.emplace_back(get_value(addr));
+  }
+  return values;
+}
 
-  std::function<const Tensor *(const Address)> forward_recursive = [&](
-      const Address addr) -> const Tensor * {
-    OperatorInfo &cur_f = ops_[addr.oid];
+vector<vector<float>> Graph::fetch(const vector<Node> &nodes) {
+  const vector<const Tensor *> values = forward(nodes);
+  vector<vector<float>> results;
+  results.reserve(values.size());
+  for (const Tensor *value : values) {
+    results.emplace_back(value->to_vector());
+  }
+  return results;
+}
 
-    if (cur_f.op->has_inner_values()) {
-      return cur_f.op->get_inner_values()[addr.vid];
+void Graph::forward_targets(const vector<Address> &targets) {
+  make_schedule(targets, false, schedule_);
+  if (schedule_.empty()) return;
+
+  // Target values are pinned during the calculation to prevent them from
+  // being released in the inference mode.
+  for (const Address addr : targets) {
+    ++ops_[addr.oid].rets[addr.vid].num_pending_sinks;
+  }
+  if (autobatching_) {
+    forward_batched();
+  } else if (is_parallelizable(schedule_)) {
+    forward_parallel();
+  } else {
+    for (const std::uint32_t oid : schedule_) {
+      forward_operator(oid, ws_);
+      release_arguments(oid);
     }
+  }
+  for (const Address addr : targets) {
+    --ops_[addr.oid].rets[addr.vid].num_pending_sinks;
+  }
+}
 
-    NodeInfo &cur_n = cur_f.rets[addr.vid];
-    if (cur_n.value.valid()) {
-      return &cur_n.value;
+void Graph::capture(const vector<Node> &nodes) {
+  vector<Address> targets;
+  targets.reserve(nodes.size());
+  for (const Node &node : nodes) {
+    CHECK_NODE(node);
+    targets.emplace_back(Address { node.oid_, node.vid_ });
+  }
+  make_schedule(targets, true, schedule_);
+
+  plan_.clear();
+  plan_targets_ = targets;
+  arenas_.clear();
+  plan_.reserve(schedule_.size());
+  for (const std::uint32_t oid : schedule_) {
+    OperatorInfo &cur_f = ops_[oid];
+    vector<Tensor *> rets;
+    rets.reserve(cur_f.rets.size());
+    for (NodeInfo &ret : cur_f.rets) {
+      rets.emplace_back(&ret.value);
     }
+    plan_.emplace_back(
+        Step {
+          oid, nullptr,
+          vector<Address>(cur_f.args.begin(), cur_f.args.end()),
+          vector<const Tensor *>(cur_f.args.size()),
+          move(rets), {}, {} });
+  }
+  if (operator_fusion_) fuse_operators(targets);
+  update_plan_arguments();
+  if (memory_planning_) plan_memory(targets);
+}
 
-    // Gathers arguments and return values.
-    vector<const Tensor *> args_v;
-    vector<Tensor *> rets_v;
-    args_v.reserve(cur_f.args.size());
-    rets_v.reserve(cur_f.rets.size());
-    for (const Address arg : cur_f.args) {
-      args_v.emplace_back(forward_recursive(arg));
+void Graph::update_plan_arguments() {
+  // Each pointer is stable while the graph is not cleared, because
+  // NodeInfo objects are never reallocated after `add_operator()`.
+  for (Step &step : plan_) {
+    for (std::uint32_t i = 0; i < step.inputs.size(); ++i) {
+      step.args[i] = get_value(step.inputs[i]);
     }
-    for (NodeInfo &ret : cur_f.rets) {
-      rets_v.emplace_back(&ret.value);
+  }
+}
+
+void Graph::fuse_operators(const vector<Address> &targets) {
+  const std::uint32_t num_steps = plan_.size();
+  if (task_ids_.size() < ops_.size()) task_ids_.resize(ops_.size());
+  for (std::uint32_t s = 0; s < num_steps; ++s) {
+    task_ids_[plan_[s].oid] = s;
+  }
+  const auto in_plan = [&](const Address addr) {
+    return ops_[addr.oid].visited == visit_count_ &&
+      !ops_[addr.oid].op->has_inner_values();
+  };
+
+  // Obtains instructions of elementwise operators on supported devices.
+  const auto naive = Device::DeviceType::NAIVE;
+  const auto eigen = Device::DeviceType::EIGEN;
+  vector<ElementwiseInstruction> insts(num_steps);
+  vector<bool> fusable(num_steps);
+  for (std::uint32_t s = 0; s < num_steps; ++s) {
+    const OperatorInfo &cur_f = ops_[plan_[s].oid];
+    const auto type = cur_f.rets[0].device->type();
+    fusable[s] =
+      cur_f.rets.size() == 1 && (type == naive || type == eigen) &&
+      cur_f.op->get_elementwise_instruction(insts[s]);
+  }
+
+  // Finds the only user of each value in the plan. Values used by multiple
+  // operators or kept as targets are not fused.
+  const std::uint32_t none = num_steps;
+  const std::uint32_t many = num_steps + 1;
+  vector<std::uint32_t> users(num_steps, none);
+  for (std::uint32_t s = 0; s < num_steps; ++s) {
+    for (const Address arg : plan_[s].inputs) {
+      if (!in_plan(arg)) continue;
+      std::uint32_t &user = users[task_ids_[arg.oid]];
+      user = (user == none || user == s) ? s : many;
+    }
+  }
+  for (const Address target : targets) {
+    if (in_plan(target)) users[task_ids_[target.oid]] = many;
+  }
+
+  // Each operator joins the group of its user if both of them can be fused
+  // and they have the same number of elements. The reverse scan visits each
+  // operator after its user.
+  vector<std::uint32_t> roots(num_steps);
+  for (std::uint32_t s = num_steps; s-- > 0; ) {
+    roots[s] = s;
+    const std::uint32_t user = users[s];
+    if (!fusable[s] || user >= num_steps || !fusable[user]) continue;
+    const NodeInfo &cur_n = ops_[plan_[s].oid].rets[0];
+    const NodeInfo &root_n = ops_[plan_[roots[user]].oid].rets[0];
+    if (cur_n.device == root_n.device &&
+        cur_n.shape.volume() == root_n.shape.volume()) {
+      roots[s] = roots[user];
+    }
+  }
+  vector<vector<std::uint32_t>> members(num_steps);
+  vector<std::uint32_t> positions(num_steps);
+  for (std::uint32_t s = 0; s < num_steps; ++s) {
+    positions[s] = members[roots[s]].size();
+    members[roots[s]].emplace_back(s);
+  }
+
+  // Replaces each group with one step at the position of its root, which is
+  // the last member in the topological order.
+  vector<Step> plan;
+  for (std::uint32_t s = 0; s < num_steps; ++s) {
+    if (roots[s] != s) continue;
+    Step &step = plan_[s];
+    if (members[s].size() == 1) {
+      plan.emplace_back(move(step));
+      continue;
+    }
+    const auto is_member = [&](const Address addr) {
+      return in_plan(addr) && roots[task_ids_[addr.oid]] == s;
+    };
+
+    // Registers of external arguments come before those of results.
+    vector<Address> inputs;
+    for (const std::uint32_t m : members[s]) {
+      for (const Address arg : plan_[m].inputs) {
+        if (is_member(arg)) continue;
+        bool found = false;
+        for (const Address input : inputs) {
+          found |= input.oid == arg.oid && input.vid == arg.vid;
+        }
+        if (!found) inputs.emplace_back(arg);
+      }
+    }
+    const auto get_register = [&](const Address addr) {
+      if (is_member(addr)) {
+        return inputs.size() + positions[task_ids_[addr.oid]];
+      }
+      std::uint32_t i = 0;
+      while (inputs[i].oid != addr.oid || inputs[i].vid != addr.vid) ++i;
+      return static_cast<std::size_t>(i);
+    };
+    vector<ElementwiseInstruction> program;
+    for (const std::uint32_t m : members[s]) {
+      ElementwiseInstruction inst = insts[m];
+      inst.a = get_register(plan_[m].inputs[inst.a]);
+      inst.b = get_register(plan_[m].inputs[inst.b]);
+      program.emplace_back(inst);
     }
 
-    // Calculates the value.
-    cur_f.op->forward(args_v, rets_v);
+    step.fused.reset(new operators::FusedElementwise(
+          program, ops_[step.oid].rets[0].shape));
+    for (const std::uint32_t m : members[s]) {
+      if (m != s) step.fused_rets.emplace_back(plan_[m].rets[0]);
+    }
+    step.args.resize(inputs.size());
+    step.inputs = move(inputs);
+    plan.emplace_back(move(step));
+  }
+  plan_ = move(plan);
+}
+
+void Graph::plan_memory(const vector<Address> &targets) {
+  // Offsets are counted in floats, and are aligned to 64 bytes.
+  const std::uint32_t align_floats = 64 / sizeof(float);
+  const auto cpu = static_cast<std::uint32_t>(Device::DeviceType::GROUP_CPU);
+  const auto filter =
+    static_cast<std::uint32_t>(Device::DeviceType::GROUP_FILTER);
+  const std::uint32_t num_steps = plan_.size();
+  if (task_ids_.size() < ops_.size()) task_ids_.resize(ops_.size());
+  for (std::uint32_t s = 0; s < num_steps; ++s) {
+    task_ids_[plan_[s].oid] = s;
+  }
+  const auto in_plan = [&](const Address addr) {
+    return ops_[addr.oid].visited == visit_count_ &&
+      !ops_[addr.oid].op->has_inner_values();
+  };
+
+  // Determines the last step using each value, and whether the value can be
+  // placed in the arena. Values are placed only if they are written by
+  // operators supporting return buffers, and all their users also support
+  // them, because other operators may hold the memory of their arguments
+  // (e.g., `reshape()`).
+  vector<vector<std::uint32_t>> last_use(num_steps);
+  vector<vector<bool>> planned(num_steps);
+  for (std::uint32_t s = 0; s < num_steps; ++s) {
+    const OperatorInfo &cur_f = ops_[plan_[s].oid];
+    const bool accepts = get_step_operator(plan_[s]).accepts_return_buffers();
+    last_use[s].assign(cur_f.rets.size(), s);
+    planned[s].assign(cur_f.rets.size(), accepts);
+    for (std::uint32_t i = 0; i < cur_f.rets.size(); ++i) {
+      const auto type =
+        static_cast<std::uint32_t>(cur_f.rets[i].device->type());
+      if ((type & filter) != cpu) planned[s][i] = false;
+    }
+    for (const Address arg : plan_[s].inputs) {
+      if (!in_plan(arg)) continue;
+      const std::uint32_t as = task_ids_[arg.oid];
+      last_use[as][arg.vid] = s;
+      if (!accepts) planned[as][arg.vid] = false;
+    }
+  }
+  for (const Address target : targets) {
+    if (in_plan(target)) planned[task_ids_[target.oid]][target.vid] = false;
+  }
 
-    return &cur_n.value;
+  // Assigns offsets with the best-fit strategy over free blocks of each arena.
+  // Each free list maps offsets to sizes of free blocks.
+  std::unordered_map<const Device *, std::uint32_t> arena_ids;
+  vector<Device *> devices;
+  vector<std::uint32_t> arena_sizes;
+  vector<std::map<std::uint32_t, std::uint32_t>> free_lists;
+  vector<vector<std::uint32_t>> offsets(num_steps);
+  const auto aligned_size = [&](const Shape &shape) {
+    return (shape.size() + align_floats - 1) / align_floats * align_floats;
+  };
+  const auto allocate = [&](std::uint32_t arena, std::uint32_t size) {
+    auto &free_list = free_lists[arena];
+    auto best = free_list.end();
+    for (auto it = free_list.begin(); it != free_list.end(); ++it) {
+      if (it->second >= size &&
+          (best == free_list.end() || it->second < best->second)) {
+        best = it;
+      }
+    }
+    if (best == free_list.end()) {
+      const std::uint32_t offset = arena_sizes[arena];
+      arena_sizes[arena] += size;
+      return offset;
+    }
+    const std::uint32_t offset = best->first;
+    const std::uint32_t rest = best->second - size;
+    free_list.erase(best);
+    if (rest > 0) free_list.emplace(offset + size, rest);
+    return offset;
+  };
+  const auto release = [&](std::uint32_t arena, std::uint32_t offset,
+      std::uint32_t size) {
+    auto &free_list = free_lists[arena];
+    auto next = free_list.emplace(offset, size).first;
+    auto cur = next++;
+    if (next != free_list.end() && cur->first + cur->second == next->first) {
+      cur->second += next->second;
+      free_list.erase(next);
+    }
+    if (cur != free_list.begin()) {
+      auto prev = cur;
+      --prev;
+      if (prev->first + prev->second == cur->first) {
+        prev->second += cur->second;
+        free_list.erase(cur);
+      }
+    }
   };
 
-  return *forward_recursive(Address { node.oid_, node.vid_ });
+  for (std::uint32_t s = 0; s < num_steps; ++s) {
+    Step &step = plan_[s];
+    const OperatorInfo &cur_f = ops_[step.oid];
+    offsets[s].assign(cur_f.rets.size(), 0);
+
+    // Arguments which are no longer used after this step.
+    vector<Address> dying;
+    for (const Address arg : step.inputs) {
+      if (!in_plan(arg)) continue;
+      const std::uint32_t as = task_ids_[arg.oid];
+      if (!planned[as][arg.vid] || last_use[as][arg.vid] != s) continue;
+      bool found = false;
+      for (const Address d : dying) {
+        found |= d.oid == arg.oid && d.vid == arg.vid;
+      }
+      if (!found) dying.emplace_back(arg);
+    }
+
+    for (std::uint32_t i = 0; i < cur_f.rets.size(); ++i) {
+      if (!planned[s][i]) continue;
+      const NodeInfo &ret = cur_f.rets[i];
+      auto it = arena_ids.find(ret.device);
+      if (it == arena_ids.end()) {
+        it = arena_ids.emplace(ret.device, devices.size()).first;
+        devices.emplace_back(ret.device);
+        arena_sizes.emplace_back(0);
+        free_lists.emplace_back();
+      }
+      const std::uint32_t arena = it->second;
+
+      // Elementwise operators overwrite a dying argument with the same shape.
+      bool inplace = false;
+      if (get_step_operator(step).is_elementwise()) {
+        for (auto d = dying.begin(); d != dying.end(); ++d) {
+          const NodeInfo &arg_n = ops_[d->oid].rets[d->vid];
+          if (arg_n.device == ret.device && arg_n.shape == ret.shape) {
+            offsets[s][i] = offsets[task_ids_[d->oid]][d->vid];
+            dying.erase(d);
+            inplace = true;
+            break;
+          }
+        }
+      }
+      if (!inplace) offsets[s][i] = allocate(arena, aligned_size(ret.shape));
+      step.buffers.emplace_back(Buffer { i, arena, offsets[s][i] });
+    }
+
+    // Releases arguments and return values which are no longer used.
+    for (const Address d : dying) {
+      const NodeInfo &arg_n = ops_[d.oid].rets[d.vid];
+      release(
+          arena_ids[arg_n.device], offsets[task_ids_[d.oid]][d.vid],
+          aligned_size(arg_n.shape));
+    }
+    for (const Buffer &buf : step.buffers) {
+      if (last_use[s][buf.vid] == s) {
+        release(
+            buf.arena, buf.offset, aligned_size(cur_f.rets[buf.vid].shape));
+      }
+    }
+  }
+
+  for (std::uint32_t i = 0; i < devices.size(); ++i) {
+    arenas_.emplace_back(
+        devices[i]->new_tensor_by_constant({arena_sizes[i]}, 0));
+  }
 }
 
-void Graph::backward(const Node &node) {
+std::size_t Graph::planned_memory_size() const {
+  std::size_t size = 0;
+  for (const Tensor &arena : arenas_) {
+    size += arena.shape().size() * sizeof(float);
+  }
+  return size;
+}
+
+void Graph::replay() {
+  if (plan_.empty()) PRIMITIV_THROW_ERROR("No execution plan is captured.");
+
+  // Releases all old values before recalculation to allow devices to reuse
+  // their memory for new values. Values of fused operators are not
+  // calculated by the plan, and are recalculated by their own operators on
+  // demand.
+  for (Step &step : plan_) {
+    for (Tensor *ret : step.rets) {
+      ret->invalidate();
+    }
+    for (Tensor *ret : step.fused_rets) {
+      ret->invalidate();
+    }
+  }
+
+  for (Step &step : plan_) {
+    OperatorInfo &cur_f = ops_[step.oid];
+    for (const Buffer &buf : step.buffers) {
+      NodeInfo &ret = cur_f.rets[buf.vid];
+      ret.value = ret.device->new_tensor_view(
+          arenas_[buf.arena], buf.offset, ret.shape);
+    }
+    invoke_forward(step.oid, get_step_operator(step), step.args, step.rets);
+  }
+
+  // Planned values are overwritten by other values in the same arena.
+  for (Step &step : plan_) {
+    for (const Buffer &buf : step.buffers) {
+      ops_[step.oid].rets[buf.vid].value.invalidate();
+    }
+  }
+}
+
+void Graph::bind_input(const Node &node, const vector<float> &data) {
   CHECK_NODE(node);
+  OperatorInfo &f = ops_[node.oid_];
+  operators::Input *op = dynamic_cast<operators::Input *>(f.op.get());
+  if (!op) {
+    PRIMITIV_THROW_ERROR(
+        "Attempted to bind data to a non-input node. operator: '"
+        << f.op->name() << "'");
+  }
+  op->reset_data(data);
+  f.rets[0].value.invalidate();
+}
 
-  OperatorInfo &last_f = ops_[node.oid_];
-  NodeInfo &last_n = last_f.rets[node.vid_];
+void Graph::bind_parameter(const Node &node, Parameter &param) {
+  CHECK_NODE(node);
+  OperatorInfo &f = ops_[node.oid_];
+  operators::Parameter *op = dynamic_cast<operators::Parameter *>(f.op.get());
+  if (!op) {
+    PRIMITIV_THROW_ERROR(
+        "Attempted to bind a parameter to a non-parameter node. operator: '"
+        << f.op->name() << "'");
+  }
+  const NodeInfo &n = f.rets[0];
+  if (param.shape() != n.shape || &param.device() != n.device) {
+    PRIMITIV_THROW_ERROR(
+        "Parameter mismatched. required: " << n.shape.to_string()
+        << " on " << n.device << ", actual: " << param.shape().to_string()
+        << " on " << &param.device());
+  }
+  op->reset_parameter(param);
 
-  // Force to perform the forward operation.
-  if (!last_n.value.valid()) {
-    forward(node);
+  // The shared key of the node still refers the previous parameter.
+  for (auto it = shared_ops_.begin(); it != shared_ops_.end(); ) {
+    if (it->second == node.oid_) it = shared_ops_.erase(it);
+    else ++it;
   }
 
-  // Makes the identity gradient (dx/dx = 1) at the last node.
-  last_n.grad = functions::ones<Tensor>(last_n.shape, last_n.device);
+  update_plan_arguments();
+}
 
-  // Performs the backpropagation.
-  // NOTE(odashi):
-  // In the current implementation, the node ID corresponds to the inverse
-  // topological order of the computation graph.
-  for (std::int32_t oid = node.oid_; oid >= 0; --oid) {
-    OperatorInfo &cur_f = ops_[oid];
-    const std::uint32_t argn = cur_f.args.size();
-    const std::uint32_t retn = cur_f.rets.size();
-
-    // Gathers information of return values.
-    vector<const Tensor *> rets_v(retn), rets_g(retn);
-    bool enabled = false;
-    for (uint32_t i = 0; i < retn; ++i) {
-      NodeInfo &cur_n = cur_f.rets[i];
-      rets_v[i] = &cur_n.value;
-      rets_g[i] = &cur_n.grad;
-      enabled = enabled || cur_n.grad.valid();
-    }
-    if (!enabled) {
-      // This operator is out of the forward path because all gradients of
-      // return values are invalid.
-      continue;
+void Graph::save_plan(const std::string &path, const Model &model) const {
+  if (plan_.empty()) PRIMITIV_THROW_ERROR("No execution plan is captured.");
+
+  // Collects all operators required by the plan. Arguments of each operator
+  // always have smaller operator IDs than the operator itself.
+  vector<bool> required(ops_.size(), false);
+  for (const Address target : plan_targets_) required[target.oid] = true;
+  for (std::uint32_t oid = ops_.size(); oid-- > 0; ) {
+    if (!required[oid]) continue;
+    for (const Address arg : ops_[oid].args) required[arg.oid] = true;
+  }
+  vector<std::uint32_t> oids;
+  vector<std::uint32_t> indices(ops_.size());
+  for (std::uint32_t oid = 0; oid < ops_.size(); ++oid) {
+    if (!required[oid]) continue;
+    indices[oid] = oids.size();
+    oids.emplace_back(oid);
+  }
+
+  const auto params = model.get_all_parameters();
+  std::unordered_map<const Parameter *, const vector<std::string> *> keys;
+  for (const auto &kv : params) keys.emplace(kv.second, &kv.first);
+
+  std::ofstream ofs(path);
+  if (!ofs.is_open()) {
+    PRIMITIV_THROW_ERROR("Could not open file: " << path);
+  }
+  msgpack::Writer writer(ofs);
+
+  writer << FileFormat::CurrentVersion::MAJOR;
+  writer << FileFormat::CurrentVersion::MINOR;
+  writer << static_cast<std::uint32_t>(FileFormat::DataType::GRAPH);
+
+  writer << static_cast<std::uint32_t>(oids.size());
+  for (const std::uint32_t oid : oids) {
+    const OperatorInfo &f = ops_[oid];
+    const auto *param = dynamic_cast<const operators::Parameter *>(f.op.get());
+    if (param) {
+      const auto it = keys.find(&param->parameter());
+      if (it == keys.end()) {
+        PRIMITIV_THROW_ERROR(
+            "The plan uses a parameter which is not registered in the model.");
+      }
+      writer << "Parameter" << *it->second;
+    } else {
+      f.op->save(writer);
+    }
+    writer << f.args.size();
+    for (const Address arg : f.args) {
+      writer << indices[arg.oid] << arg.vid;
+    }
+    writer << static_cast<std::uint32_t>(f.rets.size());
+    for (const NodeInfo &ret : f.rets) {
+      writer << ret.shape.dims() << ret.shape.batch();
+    }
+  }
+
+  writer << static_cast<std::uint32_t>(plan_targets_.size());
+  for (const Address target : plan_targets_) {
+    writer << indices[target.oid] << target.vid;
+  }
+}
+
+vector<Node> Graph::load_plan(
+    const std::string &path, Model &model, vector<Node> &inputs,
+    Device *device) {
+  std::ifstream ifs(path);
+  if (!ifs.is_open()) {
+    PRIMITIV_THROW_ERROR("Could not open file: " << path);
+  }
+  msgpack::Reader reader(ifs);
+
+  std::uint32_t major, minor;
+  reader >> major >> minor;
+  FileFormat::assert_version(major, minor);
+
+  std::uint32_t datatype;
+  reader >> datatype;
+  FileFormat::assert_datatype(FileFormat::DataType::GRAPH, datatype);
+
+  Device &dev = Device::get_reference_or_default(device);
+  const auto params = model.get_all_parameters();
+
+  // Reads a reference to the return value of a restored operator.
+  vector<vector<Node>> rets;
+  const auto read_node = [&]() {
+    std::uint32_t index, vid;
+    reader >> index >> vid;
+    if (index >= rets.size() || vid >= rets[index].size()) {
+      PRIMITIV_THROW_ERROR(
+          "Invalid node in the plan. operator: " << index
+          << ", value: " << vid);
+    }
+    return rets[index][vid];
+  };
+
+  clear();
+  inputs.clear();
+
+  std::uint32_t num_ops;
+  reader >> num_ops;
+  rets.reserve(num_ops);
+  for (std::uint32_t i = 0; i < num_ops; ++i) {
+    std::string type;
+    reader >> type;
+    std::unique_ptr<Operator> op;
+    if (type == "Parameter") {
+      vector<std::string> key;
+      reader >> key;
+      const auto it = params.find(key);
+      if (it == params.end()) {
+        PRIMITIV_THROW_ERROR(
+            "Model does not have a parameter with name: '"
+            << string_utils::join(key, ".") << "'");
+      }
+      op.reset(new operators::Parameter(*it->second));
+    } else {
+      op = operators::load_operator(type, reader, dev);
+    }
+
+    std::uint32_t argn;
+    reader >> argn;
+    vector<Node> args;
+    args.reserve(argn);
+    for (std::uint32_t j = 0; j < argn; ++j) {
+      args.emplace_back(read_node());
+    }
+    rets.emplace_back(add_operator(move(op), args));
+    if (type == "Input") inputs.emplace_back(rets.back()[0]);
+
+    // Checks that the restored operator behaves the same as the saved one.
+    std::uint32_t retn;
+    reader >> retn;
+    if (retn != rets.back().size()) {
+      PRIMITIV_THROW_ERROR(
+          "Number of return values mismatched. operator: " << type
+          << ", saved: " << retn << ", actual: " << rets.back().size());
+    }
+    for (const Node &ret : rets.back()) {
+      vector<std::uint32_t> dims;
+      std::uint32_t batch;
+      reader >> dims >> batch;
+      const Shape saved(dims, batch);
+      const Shape &actual = ops_[ret.oid_].rets[ret.vid_].shape;
+      if (saved != actual) {
+        PRIMITIV_THROW_ERROR(
+            "Shape mismatched. operator: " << type
+            << ", saved: " << saved.to_string()
+            << ", actual: " << actual.to_string());
+      }
+    }
+  }
+
+  std::uint32_t num_targets;
+  reader >> num_targets;
+  vector<Node> targets;
+  targets.reserve(num_targets);
+  for (std::uint32_t i = 0; i < num_targets; ++i) {
+    targets.emplace_back(read_node());
+  }
+  capture(targets);
+  return targets;
+}
+
+void Graph::forward_batched() {
+  // Counts arguments of each operator calculated in the schedule. Scheduled
+  // operators are marked by `visited` in `make_schedule()`.
+  std::unordered_map<std::uint32_t, std::uint32_t> num_waiting;
+  std::unordered_map<std::uint32_t, vector<std::uint32_t>> users;
+  vector<std::uint32_t> ready;
+  for (const std::uint32_t oid : schedule_) {
+    std::uint32_t n = 0;
+    for (const Address arg : ops_[oid].args) {
+      if (ops_[arg.oid].visited == visit_count_) {
+        ++n;
+        users[arg.oid].emplace_back(oid);
+      }
+    }
+    if (n == 0) ready.emplace_back(oid);
+    else num_waiting.emplace(oid, n);
+  }
+
+  std::unordered_map<std::string, std::uint32_t> group_ids;
+  vector<vector<std::uint32_t>> groups;
+  vector<std::uint32_t> next;
+  std::string key;
+  while (!ready.empty()) {
+    // Groups ready operators by their batch keys. Groups are calculated in
+    // the order of their first operators to keep the order of operators
+    // without arguments.
+    group_ids.clear();
+    groups.clear();
+    for (const std::uint32_t oid : ready) {
+      make_batch_key(oid, key);
+      if (key.empty()) {
+        groups.emplace_back(1, oid);
+        continue;
+      }
+      const auto it = group_ids.find(key);
+      if (it != group_ids.end()) {
+        groups[it->second].emplace_back(oid);
+      } else {
+        group_ids.emplace(key, groups.size());
+        groups.emplace_back(1, oid);
+      }
+    }
+
+    for (const vector<std::uint32_t> &group : groups) {
+      if (group.size() == 1) forward_operator(group[0], ws_);
+      else forward_group(group);
+    }
+
+    // Arguments are released after calculating the whole wave because other
+    // operators in the same wave may use them.
+    next.clear();
+    for (const std::uint32_t oid : ready) {
+      release_arguments(oid);
+      const auto it = users.find(oid);
+      if (it == users.end()) continue;
+      for (const std::uint32_t user : it->second) {
+        if (--num_waiting[user] == 0) next.emplace_back(user);
+      }
     }
+    ready.swap(next);
+  }
+}
+
+void Graph::make_batch_key(std::uint32_t oid, std::string &key) const {
+  key.clear();
+  const OperatorInfo &cur_f = ops_[oid];
+  const Operator &op = *cur_f.op;
+  if (cur_f.args.empty() || !op.is_batchable()) return;
+  key = op.signature();
+  if (key.empty()) return;
+
+  const Device *dev = cur_f.rets[0].device;
+  key.append(reinterpret_cast<const char *>(&dev), sizeof(dev));
+  for (const Address arg : cur_f.args) {
+    key += '\0';
+    key += ops_[arg.oid].rets[arg.vid].shape.to_string();
+  }
+}
+
+void Graph::forward_group(const vector<std::uint32_t> &oids) {
+  const OperatorInfo &first_f = ops_[oids[0]];
+  const std::uint32_t argn = first_f.args.size();
+  const std::uint32_t retn = first_f.rets.size();
+  const std::uint32_t n = oids.size();
+
+  // All results of each operator should have the same minibatch size, which
+  // is the size of the minibatch of each argument to be concatenated.
+  const std::uint32_t bs = first_f.rets[0].shape.batch();
+  bool batchable = true;
+  for (const NodeInfo &ret : first_f.rets) {
+    batchable = batchable && ret.shape.batch() == bs;
+  }
 
-    // All invalid gradients of return values should be treated as 0.
-    for (uint32_t i = 0; i < retn; ++i) {
-      NodeInfo &cur_n = cur_f.rets[i];
-      if (!cur_n.grad.valid()) {
-        cur_n.grad = functions::zeros<Tensor>(cur_n.shape, cur_n.device);
+  // Arguments with the same address in all operators are shared.
+  vector<bool> shared(argn, true);
+  bool varying = false;
+  for (std::uint32_t i = 0; i < argn; ++i) {
+    const Address a0 = first_f.args[i];
+    for (const std::uint32_t oid : oids) {
+      const Address a = ops_[oid].args[i];
+      if (a.oid != a0.oid || a.vid != a0.vid) {
+        shared[i] = false;
+        break;
       }
     }
+    const std::uint32_t arg_bs = ops_[a0.oid].rets[a0.vid].shape.batch();
+    batchable = batchable && (shared[i] ? arg_bs == 1 : arg_bs == bs);
+    varying = varying || !shared[i];
+  }
 
-    // Gathers information of arguments.
-    vector<const Tensor *> args_v(argn);
-    vector<Tensor *> args_g(argn);
+  if (!batchable || !varying) {
+    for (const std::uint32_t oid : oids) forward_operator(oid, ws_);
+    return;
+  }
+
+  // Concatenates arguments.
+  vector<Tensor> concatenated(argn);
+  vector<const Tensor *> parts(n);
+  ws_.args_v.resize(argn);
+  for (std::uint32_t i = 0; i < argn; ++i) {
+    if (shared[i]) {
+      ws_.args_v[i] = get_value(first_f.args[i]);
+      continue;
+    }
+    for (std::uint32_t j = 0; j < n; ++j) {
+      parts[j] = get_value(ops_[oids[j]].args[i]);
+    }
+    concatenated[i] = parts[0]->device().batch_concat_fw(parts);
+    ws_.args_v[i] = &concatenated[i];
+  }
+
+  // Calculates all results by one call.
+  vector<Tensor> results(retn);
+  ws_.rets.resize(retn);
+  for (std::uint32_t i = 0; i < retn; ++i) {
+    ws_.rets[i] = &results[i];
+  }
+  invoke_forward(oids[0], *first_f.op, ws_.args_v, ws_.rets);
+
+  // Splits results into each operator.
+  for (std::uint32_t j = 0; j < n; ++j) {
+    const AllocationScope scope(memory_tracker_, oids[j], false);
+    for (std::uint32_t i = 0; i < retn; ++i) {
+      ops_[oids[j]].rets[i].value =
+        results[i].device().batch_slice_fw(results[i], j * bs, (j + 1) * bs);
+    }
+  }
+}
+
+void Graph::backward_operator(
+    std::uint32_t oid, WorkSpace &ws, std::mutex *locks) {
+  OperatorInfo &cur_f = ops_[oid];
+  const std::uint32_t argn = cur_f.args.size();
+  const std::uint32_t retn = cur_f.rets.size();
+
+  // Gathers information of return values.
+  ws.rets_v.resize(retn);
+  ws.rets_g.resize(retn);
+  bool enabled = false;
+  for (uint32_t i = 0; i < retn; ++i) {
+    NodeInfo &cur_n = cur_f.rets[i];
+    ws.rets_v[i] = &cur_n.value;
+    ws.rets_g[i] = &cur_n.grad;
+    enabled = enabled || cur_n.grad.valid();
+  }
+  if (!enabled) {
+    // This operator is out of the forward path because all gradients of
+    // return values are invalid.
+    return;
+  }
+  // Allocations of gradients are also counted by the profiler.
+  const AllocationScope scope(memory_tracker_, oid, true);
+  const auto begin = profiling_
+    ? std::chrono::steady_clock::now()
+    : std::chrono::steady_clock::time_point();
+  const std::uint64_t num_allocations =
+    profiling_ ? Device::num_thread_allocations() : 0;
+
+  // All invalid gradients of return values should be treated as 0.
+  for (uint32_t i = 0; i < retn; ++i) {
+    NodeInfo &cur_n = cur_f.rets[i];
+    if (!cur_n.grad.valid()) {
+      cur_n.grad = functions::zeros<Tensor>(cur_n.shape, cur_n.device);
+    }
+  }
+
+  // Gathers information of arguments.
+  // Invalid gradients of arguments are treated as 0 by operators accepting
+  // them, and are overwritten by the first contribution. Otherwise they are
+  // initialized by 0 here.
+  // Arguments which do not require gradients receive temporary gradients
+  // discarded immediately after the backward operation.
+  const bool lazy = cur_f.op->accepts_invalid_gradients();
+  ws.args_v.resize(argn);
+  ws.args_g.resize(argn);
+  ws.dummy_g.resize(argn);
+  ws.local_g.resize(argn);
+  for (uint32_t i = 0; i < argn; ++i) {
+    const Address arg = cur_f.args[i];
+    const OperatorInfo &arg_f = ops_[arg.oid];
+    NodeInfo &arg_n = ops_[arg.oid].rets[arg.vid];
+    ws.args_v[i] = get_value(arg);
+    ws.local_g[i].invalidate();
+    Tensor *arg_g;
+    if (arg_f.requires_grad) {
+      arg_g = locks ? &ws.local_g[i] : &arg_n.grad;
+    } else {
+      ws.dummy_g[i].invalidate();
+      arg_g = &ws.dummy_g[i];
+    }
+    if (!lazy && !arg_g->valid()) {
+      *arg_g = functions::zeros<Tensor>(arg_n.shape, arg_n.device);
+    }
+    ws.args_g[i] = arg_g;
+  }
+
+  // Propagetes the gradient from this node.
+  cur_f.op->backward(ws.args_v, ws.rets_v, ws.rets_g, ws.args_g);
+  if (profiling_) {
+    record_profile(oid, *cur_f.op, true, begin, num_allocations, ws.args_g);
+  }
+
+  // Merges local gradients into shared ones. Other operators may update the
+  // same gradients simultaneously.
+  if (locks) {
     for (uint32_t i = 0; i < argn; ++i) {
+      Tensor &local = ws.local_g[i];
+      if (!local.valid()) continue;
       const Address arg = cur_f.args[i];
+      Tensor &grad = ops_[arg.oid].rets[arg.vid].grad;
+      const std::lock_guard<std::mutex> lock(locks[task_ids_[arg.oid]]);
+      if (grad.valid()) {
+        grad += local;
+        local.invalidate();
+      } else {
+        grad = move(local);
+      }
+    }
+  }
+
+  // Deletes current gradient to suppress memory.
+  for (uint32_t i = 0; i < retn; ++i) {
+    cur_f.rets[i].grad.invalidate();
+  }
+  for (Tensor &dummy : ws.dummy_g) {
+    dummy.invalidate();
+  }
+}
+
+void Graph::recompute_values(std::uint32_t oid) {
+  const OperatorInfo &cur_f = ops_[oid];
+  targets_.clear();
+  for (const Address arg : cur_f.args) {
+    if (!is_calculated(arg)) targets_.emplace_back(arg);
+  }
+  for (std::uint32_t i = 0; i < cur_f.rets.size(); ++i) {
+    const Address ret { oid, i };
+    if (!is_calculated(ret)) targets_.emplace_back(ret);
+  }
+  if (targets_.empty()) return;
+
+  // Recalculated values are kept until the backward operation of their
+  // operators, because other operators in the same segment may require them.
+  make_schedule(targets_, false, recompute_schedule_);
+  for (const std::uint32_t sid : recompute_schedule_) {
+    forward_operator(sid, ws_);
+    recomputed_.emplace_back(sid);
+  }
+}
+
+void Graph::release_recomputed_values() {
+  // Releases remaining values recalculated only to obtain other values.
+  for (const std::uint32_t oid : recomputed_) {
+    if (ops_[oid].recomputable) {
+      for (NodeInfo &ret : ops_[oid].rets) {
+        ret.value.invalidate();
+      }
+    }
+  }
+  recomputed_.clear();
+}
+
+void Graph::make_backward_schedule(std::uint32_t last_oid) {
+  schedule_.clear();
+
+  // Only operators reachable from the output through operators which require
+  // gradients are marked. Operator IDs always represent a topological order,
+  // so that the descending scan visits each operator after all its consumers.
+  const std::uint64_t visit_id = ++visit_count_;
+  ops_[last_oid].visited = visit_id;
+  for (std::int32_t oid = last_oid; oid >= 0; --oid) {
+    const OperatorInfo &cur_f = ops_[oid];
+    if (cur_f.visited != visit_id) continue;
+    schedule_.emplace_back(oid);
+    for (const Address arg : cur_f.args) {
       OperatorInfo &arg_f = ops_[arg.oid];
-      NodeInfo &arg_n = arg_f.rets[arg.vid];
-      args_v[i] = arg_n.value.valid()
-        ? &arg_n.value
-        : arg_f.op->get_inner_values()[arg.vid];
-      args_g[i] = &arg_n.grad;
-      if (!arg_n.grad.valid()) {
-        arg_n.grad = functions::zeros<Tensor>(arg_n.shape, arg_n.device);
+      if (arg_f.requires_grad) arg_f.visited = visit_id;
+    }
+  }
+}
+
+bool Graph::backward_parallel() {
+  if (!is_parallelizable(schedule_)) return false;
+
+  // Operators without arguments are processed after all other operators on
+  // this thread, because gradients of their return values (e.g., Parameter
+  // objects) may be shared with other graphs.
+  vector<std::uint32_t> oids, sources;
+  for (const std::uint32_t oid : schedule_) {
+    if (ops_[oid].recomputable) {
+      // Recalculation of released values is performed sequentially.
+      return false;
+    }
+    if (ops_[oid].args.empty()) {
+      sources.emplace_back(oid);
+    } else {
+      oids.emplace_back(oid);
+    }
+  }
+
+  // Released values are recalculated in advance. Operators here are not
+  // recomputable, but their arguments without gradients may be.
+  recomputed_.clear();
+  for (const std::uint32_t oid : schedule_) {
+    recompute_values(oid);
+  }
+
+  // Makes the dependency graph: each operator waits for all consumers of its
+  // return values.
+  // Sources are numbered after tasks to assign locks to all operators.
+  const std::uint32_t num_tasks = oids.size();
+  if (task_ids_.size() < ops_.size()) task_ids_.resize(ops_.size());
+  for (std::uint32_t i = 0; i < num_tasks; ++i) {
+    task_ids_[oids[i]] = i;
+  }
+  for (std::uint32_t i = 0; i < sources.size(); ++i) {
+    task_ids_[sources[i]] = num_tasks + i;
+  }
+  vector<std::uint32_t> num_deps(num_tasks, 0);
+  vector<vector<std::uint32_t>> succs(num_tasks);
+  std::unordered_map<std::uint64_t, std::uint32_t> last_writers;
+  for (std::uint32_t i = 0; i < num_tasks; ++i) {
+    for (const Address arg : ops_[oids[i]].args) {
+      const OperatorInfo &arg_f = ops_[arg.oid];
+      if (!arg_f.requires_grad) continue;
+      if (!arg_f.args.empty()) {
+        succs[i].emplace_back(task_ids_[arg.oid]);
+        ++num_deps[task_ids_[arg.oid]];
+      }
+      if (deterministic_) {
+        // Serializes all operators writing the same gradient in the same order
+        // as the sequential execution.
+        const std::uint64_t key =
+          (static_cast<std::uint64_t>(arg.oid) << 32) | arg.vid;
+        const auto it = last_writers.find(key);
+        if (it == last_writers.end()) {
+          last_writers.emplace(key, i);
+        } else if (it->second != i) {
+          succs[it->second].emplace_back(i);
+          ++num_deps[i];
+          it->second = i;
+        }
       }
     }
+  }
 
-    // Propagetes the gradient from this node.
-    cur_f.op->backward(args_v, rets_v, rets_g, args_g);
+  // Each operator calculates gradients of its arguments without any locks,
+  // and holds the lock of each argument only while merging the results, since
+  // gradients may be updated by multiple operators simultaneously.
+  // In the deterministic mode, gradients are directly updated because all
+  // operators writing the same gradient are already serialized.
+  std::unique_ptr<std::mutex[]> locks;
+  if (!deterministic_) locks.reset(new std::mutex[schedule_.size()]);
+  run_dag(*pool_, num_deps, succs, [&](std::uint32_t task) {
+    thread_local WorkSpace ws;
+    backward_operator(oids[task], ws, locks.get());
+  });
 
-    // Deletes current gradient to suppress memory.
-    for (uint32_t i = 0; i < retn; ++i) {
-      cur_f.rets[i].grad.invalidate();
+  for (const std::uint32_t oid : sources) {
+    backward_operator(oid, ws_);
+  }
+  release_recomputed_values();
+  return true;
+}
+
+void Graph::backward(const Node &node) {
+  CHECK_NODE(node);
+  if (inference_mode_) {
+    PRIMITIV_THROW_ERROR(
+        "Backward operation is disabled in the inference mode.");
+  }
+
+  OperatorInfo &last_f = ops_[node.oid_];
+  NodeInfo &last_n = last_f.rets[node.vid_];
+
+  // Force to perform the forward operation.
+  if (!last_n.value.valid()) {
+    forward(node);
+  }
+
+  // Nothing to do if the output does not depend on any trainable values.
+  if (!last_f.requires_grad) return;
+
+  // Makes the identity gradient (dx/dx = 1) at the last node.
+  {
+    const AllocationScope scope(memory_tracker_, node.oid_, true);
+    last_n.grad = functions::ones<Tensor>(last_n.shape, last_n.device);
+  }
+
+  // Performs the backpropagation.
+  make_backward_schedule(node.oid_);
+  if (backward_parallel()) return;
+  recomputed_.clear();
+  for (const std::uint32_t oid : schedule_) {
+    recompute_values(oid);
+    backward_operator(oid, ws_);
+    if (ops_[oid].recomputable) {
+      // Values of this operator are no longer used by the backpropagation.
+      for (NodeInfo &ret : ops_[oid].rets) {
+        ret.value.invalidate();
+      }
     }
   }
+
+  release_recomputed_values();
 }
 
 Shape Graph::get_shape(const Node &node) const {
@@ -231,7 +1615,262 @@ Device &Graph::get_device(const Node &node) const {
   return *ops_[node.oid_].rets[node.vid_].device;
 }
 
+bool Graph::depends_on_trainable_values(
+    const Node &node, const vector<Node> &excluded) const {
+  CHECK_NODE(node);
+  vector<bool> visited(ops_.size(), false);
+  for (const Node &x : excluded) {
+    CHECK_NODE(x);
+    visited[x.oid_] = true;
+  }
+
+  // Operators which do not require gradients never use trainable values.
+  vector<std::uint32_t> stack { node.oid_ };
+  while (!stack.empty()) {
+    const std::uint32_t oid = stack.back();
+    stack.pop_back();
+    if (visited[oid]) continue;
+    visited[oid] = true;
+    const OperatorInfo &cur_f = ops_[oid];
+    if (!cur_f.requires_grad) continue;
+    if (cur_f.op->has_trainable_values()) return true;
+    for (const Address arg : cur_f.args) stack.emplace_back(arg.oid);
+  }
+  return false;
+}
+
+void Graph::set_profiling(bool enabled) {
+  const std::lock_guard<std::mutex> lock(profile_mutex_);
+  if (enabled && !profiling_ && profile_.empty()) {
+    profile_origin_ = std::chrono::steady_clock::now();
+  }
+  profiling_ = enabled;
+}
+
+void Graph::clear_profile() {
+  const std::lock_guard<std::mutex> lock(profile_mutex_);
+  profile_.clear();
+  profile_origin_ = std::chrono::steady_clock::now();
+}
+
+void Graph::set_memory_tracking(bool enabled) {
+  if (enabled && !memory_tracker_) {
+    memory_tracker_.reset(new MemoryTracker());
+  } else if (!enabled) {
+    memory_tracker_.reset();
+  }
+}
+
+Graph::MemoryUsage Graph::memory_usage() const {
+  return memory_tracker_
+    ? memory_tracker_->summary()
+    : MemoryUsage { 0, 0, 0, 0 };
+}
+
+void Graph::record_profile(
+    std::uint32_t oid, const Operator &op, bool backward,
+    std::chrono::steady_clock::time_point begin,
+    std::uint64_t num_allocations, const vector<Tensor *> &results) {
+  const auto end = std::chrono::steady_clock::now();
+  std::size_t bytes = 0;
+  for (const Tensor *result : results) {
+    if (result->valid()) bytes += result->shape().size() * sizeof(float);
+  }
+  const Device &dev = *ops_[oid].rets[0].device;
+  ProfileEvent event {
+    oid, backward, op.name(), dev.type(), &dev, std::this_thread::get_id(),
+    std::chrono::steady_clock::duration(), end - begin, bytes,
+    Device::num_thread_allocations() - num_allocations,
+  };
+  const std::lock_guard<std::mutex> lock(profile_mutex_);
+  event.begin = begin - profile_origin_;
+  profile_.emplace_back(move(event));
+}
+
+namespace {
+
+// Obtains the name of the device type.
+const char *get_device_type_name(Device::DeviceType type) {
+  switch (type) {
+    case Device::DeviceType::NAIVE: return "Naive";
+    case Device::DeviceType::EIGEN: return "Eigen";
+    case Device::DeviceType::CUDA: return "CUDA";
+    case Device::DeviceType::CUDA16: return "CUDA16";
+    case Device::DeviceType::OPENCL: return "OpenCL";
+    default: return "Unknown";
+  }
+}
+
+// Escapes the string to be embedded into JSON.
+std::string escape_json(const std::string &str) {
+  std::string ret;
+  for (const char c : str) {
+    if (c == '"' || c == '\\') ret += '\\';
+    ret += c;
+  }
+  return ret;
+}
+
+}  // namespace
+
+std::string Graph::dump_trace() const {
+  using microseconds = std::chrono::duration<double, std::micro>;
+  const std::lock_guard<std::mutex> lock(profile_mutex_);
+
+  // Threads are numbered in the order of their first appearance.
+  vector<std::thread::id> threads;
+  std::stringstream ss;
+  ss << "{\"traceEvents\":[";
+  for (std::uint32_t i = 0; i < profile_.size(); ++i) {
+    const ProfileEvent &e = profile_[i];
+    const std::uint32_t tid =
+      std::find(threads.begin(), threads.end(), e.thread) - threads.begin();
+    if (tid == threads.size()) threads.emplace_back(e.thread);
+    ss << (i > 0 ? ",\n" : "\n")
+       << "{\"name\":\"" << escape_json(e.name)
+       << "\",\"cat\":\"" << (e.backward ? "backward" : "forward")
+       << "\",\"ph\":\"X\",\"ts\":"
+       << std::chrono::duration_cast<microseconds>(e.begin).count()
+       << ",\"dur\":"
+       << std::chrono::duration_cast<microseconds>(e.duration).count()
+       << ",\"pid\":0,\"tid\":" << tid
+       << ",\"args\":{\"oid\":" << e.oid
+       << ",\"device\":\"" << get_device_type_name(e.device_type)
+       << '@' << e.device
+       << "\",\"bytes\":" << e.bytes
+       << ",\"allocations\":" << e.num_allocations << "}}";
+  }
+  ss << "\n]}\n";
+  return ss.str();
+}
+
+std::string Graph::dump_profile() const {
+  using milliseconds = std::chrono::duration<double, std::milli>;
+  struct Entry {
+    std::string name;
+    bool backward;
+    std::uint64_t num_calls;
+    std::chrono::steady_clock::duration duration;
+    std::size_t bytes;
+    std::uint64_t num_allocations;
+  };
+
+  // Aggregates profiles by names of operators and directions.
+  vector<Entry> entries;
+  {
+    const std::lock_guard<std::mutex> lock(profile_mutex_);
+    std::unordered_map<std::string, std::uint32_t> ids;
+    for (const ProfileEvent &e : profile_) {
+      const std::string key = e.name + (e.backward ? "\tb" : "\tf");
+      auto it = ids.find(key);
+      if (it == ids.end()) {
+        it = ids.emplace(key, entries.size()).first;
+        entries.emplace_back(Entry {
+            e.name, e.backward, 0, std::chrono::steady_clock::duration(), 0, 0
+        });
+      }
+      Entry &entry = entries[it->second];
+      ++entry.num_calls;
+      entry.duration += e.duration;
+      entry.bytes += e.bytes;
+      entry.num_allocations += e.num_allocations;
+    }
+  }
+  std::stable_sort(
+      entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.duration > b.duration;
+      });
+
+  Entry total {
+    "(total)", false, 0, std::chrono::steady_clock::duration(), 0, 0 };
+  for (const Entry &entry : entries) {
+    total.num_calls += entry.num_calls;
+    total.duration += entry.duration;
+    total.bytes += entry.bytes;
+    total.num_allocations += entry.num_allocations;
+  }
+
+  std::stringstream ss;
+  ss << std::left << std::setw(32) << "operator" << std::right
+     << std::setw(9) << "pass"
+     << std::setw(10) << "calls"
+     << std::setw(14) << "total[ms]"
+     << std::setw(14) << "mean[us]"
+     << std::setw(14) << "bytes"
+     << std::setw(12) << "allocs" << '\n';
+  ss << std::fixed << std::setprecision(3);
+  const auto print = [&](const Entry &entry, const char *pass) {
+    const double ms =
+      std::chrono::duration_cast<milliseconds>(entry.duration).count();
+    ss << std::left << std::setw(32) << entry.name << std::right
+       << std::setw(9) << pass
+       << std::setw(10) << entry.num_calls
+       << std::setw(14) << ms
+       << std::setw(14)
+       << (entry.num_calls > 0 ? 1000. * ms / entry.num_calls : 0.)
+       << std::setw(14) << entry.bytes
+       << std::setw(12) << entry.num_allocations << '\n';
+  };
+  for (const Entry &entry : entries) {
+    print(entry, entry.backward ? "backward" : "forward");
+  }
+  print(total, "");
+  return ss.str();
+}
+
+std::string Graph::dump_memory() const {
+  struct Entry {
+    std::uint32_t oid;
+    bool backward;
+    MemoryTracker::Usage usage;
+  };
+
+  // Sorts operations by their peak memory usages.
+  vector<Entry> entries;
+  if (memory_tracker_) {
+    for (const auto &kv : memory_tracker_->usage()) {
+      entries.emplace_back(Entry {
+          static_cast<std::uint32_t>(kv.first >> 1), !!(kv.first & 1),
+          kv.second });
+    }
+  }
+  std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+      if (a.usage.peak != b.usage.peak) return a.usage.peak > b.usage.peak;
+      if (a.oid != b.oid) return a.oid < b.oid;
+      return a.backward < b.backward;
+    });
+  if (entries.size() > 10) entries.resize(10);
+
+  const MemoryUsage summary = memory_usage();
+  std::stringstream ss;
+  ss << "live bytes: " << summary.live_bytes << '\n'
+     << "peak bytes: " << summary.peak_bytes << '\n'
+     << "forward bytes: " << summary.forward_bytes << '\n'
+     << "backward bytes: " << summary.backward_bytes << '\n';
+  ss << std::left << std::setw(32) << "operator" << std::right
+     << std::setw(10) << "id"
+     << std::setw(9) << "pass"
+     << std::setw(14) << "peak"
+     << std::setw(14) << "live"
+     << std::setw(14) << "total" << '\n';
+  for (const Entry &entry : entries) {
+    const std::string name = entry.oid < ops_.size()
+      ? ops_[entry.oid].op->name()
+      : "(unknown)";
+    ss << std::left << std::setw(32) << name << std::right
+       << std::setw(10) << entry.oid
+       << std::setw(9) << (entry.backward ? "backward" : "forward")
+       << std::setw(14) << entry.usage.peak
+       << std::setw(14) << entry.usage.live
+       << std::setw(14) << entry.usage.total << '\n';
+  }
+  return ss.str();
+}
+
 std::string Graph::dump(const std::string &format) const {
+  if (format == "trace") return dump_trace();
+  if (format == "profile") return dump_profile();
+  if (format == "memory") return dump_memory();
   if (format != "dot") PRIMITIV_THROW_ERROR("Unknown format: " << format);
 
   std::stringstream ss;
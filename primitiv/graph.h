@@ -1,9 +1,20 @@
 #ifndef PRIMITIV_GRAPH_H_
 #define PRIMITIV_GRAPH_H_
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#include <primitiv/arena.h>
+#include <primitiv/device.h>
 #include <primitiv/mixins.h>
 #include <primitiv/operator.h>
 #include <primitiv/shape.h>
@@ -12,7 +23,10 @@ namespace primitiv {
 
 class Device;
 class Graph;
+class Model;
 class Node;
+class Parameter;
+class ThreadPool;
 
 /**
  * Pointer of a node in the computation graph.
@@ -143,16 +157,32 @@ class Graph
     : public mixins::DefaultSettable<Graph>
     , mixins::Nonmovable<Graph> {
 public:
-  Graph() = default;
-  ~Graph() = default;
+  Graph();
+  ~Graph();
 
   /**
    * Clear all operators in the graph.
    * @remarks After calling this method, all Node objects supplied by the graph
    *          itself is invalidated.
+   *          Memory of the operator arena is kept and reused by operators
+   *          added after this method.
    */
   void clear();
 
+  /**
+   * Detaches given nodes from the graph and discards all other operators.
+   * @param nodes List of nodes to be kept.
+   * @return New Node objects corresponding to `nodes`.
+   * @remarks Values of `nodes` are calculated by this function if necessary,
+   *          and each node is replaced with a new leaf node holding the value.
+   *          The graph is then cleared as `clear()` except the new nodes, and
+   *          all previous Node objects, including `nodes` themselves, are
+   *          invalidated. Gradients are not propagated beyond the new nodes.
+   *          Calling this function at each step of long-running loops (e.g.,
+   *          decoding with RNNs) keeps the size of the graph constant.
+   */
+  std::vector<Node> detach(const std::vector<Node> &nodes);
+
   /**
    * Adds an operator into the graph.
    * @param op Interface of the new operator.
@@ -163,6 +193,308 @@ public:
   std::vector<Node> add_operator(
       std::unique_ptr<Operator> &&op, const std::vector<Node> &args);
 
+  /**
+   * Allocates the memory of a new operator from the operator arena.
+   * @param size Number of bytes of the operator object.
+   * @return Pointer to the allocated memory, which is suitably aligned for any
+   *         operator object.
+   * @remarks The memory is reclaimed by `clear()` or the destructor of the
+   *          graph. Operator objects constructed on the memory should be passed
+   *          to `add_arena_operator()`.
+   */
+  void *allocate_operator(std::size_t size) {
+    return arena_.allocate(size, alignof(std::max_align_t));
+  }
+
+  /**
+   * Constructs a new operator in the operator arena.
+   * @param args Arguments of the constructor of `T`.
+   * @return Pointer to the new operator, which should be passed to
+   *         `add_arena_operator()`.
+   * @remarks The memory of the operator is obtained with the size and the
+   *          alignment of `T`.
+   */
+  template<typename T, typename... Args>
+  T *new_operator(Args &&... args) {
+    return new (arena_.allocate(sizeof(T), alignof(T)))
+      T(std::forward<Args>(args)...);
+  }
+
+  /**
+   * Adds an operator made by `new_operator()` or `allocate_operator()`.
+   * @param op Operator object. The graph takes the ownership of `op`, and calls
+   *           only its destructor when the operator is discarded.
+   * @param args List of arguments. Each node should point a node in the same
+   *        computation graph.
+   * @return New Node object of the first resulting value.
+   * @remarks Unlike `add_operator()`, this function does not allocate any
+   *          memory to construct the graph after the operator arena and
+   *          internal lists grow large enough.
+   *          Operators should have at least one return value.
+   */
+  Node add_arena_operator(Operator *op, std::initializer_list<Node> args);
+
+  /**
+   * Adds an operator made by `new_operator()` or `allocate_operator()`.
+   * @param op Operator object. The graph takes the ownership of `op`, and calls
+   *           only its destructor when the operator is discarded.
+   * @param args List of arguments. Each node should point a node in the same
+   *        computation graph.
+   * @return New Node object of the first resulting value.
+   */
+  Node add_arena_operator(Operator *op, const std::vector<Node> &args);
+
+  /**
+   * Enables or disables the inference mode.
+   * @param enabled `true` to enable the inference mode, `false` otherwise.
+   * @remarks In the inference mode, the graph does not keep any information
+   *          for the backpropagation, and each intermediate value is released
+   *          as soon as all operators using it are calculated. Values directly
+   *          requested by `forward()` are kept until some other operators
+   *          consume them. Released values are recalculated when they are
+   *          required again.
+   */
+  void set_inference_mode(bool enabled) { inference_mode_ = enabled; }
+
+  /**
+   * Returns whether the graph is in the inference mode or not.
+   * @return `true` if the inference mode is enabled, `false` otherwise.
+   */
+  bool is_inference_mode() const { return inference_mode_; }
+
+  /**
+   * Sets the number of worker threads used by `forward()` and `backward()`.
+   * @param num_threads Number of worker threads. 0 disables the multithreaded
+   *                    execution.
+   * @remarks Independent operators are calculated concurrently only when all
+   *          operators to be calculated are placed on CPU devices. Otherwise,
+   *          the graph falls back to the sequential execution.
+   *          Operators without any arguments (e.g., inputs, parameters, and
+   *          random number generators) are always calculated sequentially on
+   *          the calling thread to keep their order.
+   */
+  void set_num_threads(std::uint32_t num_threads);
+
+  /**
+   * Returns the number of worker threads.
+   * @return Number of worker threads, or 0 if the multithreaded execution is
+   *         disabled.
+   */
+  std::uint32_t num_threads() const;
+
+  /**
+   * Enables or disables the deterministic mode of the multithreaded execution.
+   * @param enabled `true` to enable the deterministic mode, `false` otherwise.
+   * @remarks In the deterministic mode, gradients of each value are always
+   *          accumulated in the same order as the sequential execution, and
+   *          results of `backward()` do not depend on the thread scheduling.
+   *          This mode may decrease the degree of parallelism.
+   */
+  void set_deterministic(bool enabled) { deterministic_ = enabled; }
+
+  /**
+   * Returns whether the graph is in the deterministic mode or not.
+   * @return `true` if the deterministic mode is enabled, `false` otherwise.
+   */
+  bool is_deterministic() const { return deterministic_; }
+
+  /**
+   * Enables or disables the gradient checkpointing for new operators.
+   * @param enabled `true` to enable the checkpointing, `false` otherwise.
+   * @remarks Values of operators added while the checkpointing is enabled are
+   *          released as soon as all operators using them are calculated,
+   *          and they are recalculated from the nearest values held by other
+   *          operators (checkpoints) when `backward()` requires them.
+   *          Enabling and disabling this mode around each segment of the
+   *          network (e.g., each time step of RNNs) reduces the memory usage
+   *          of the backpropagation in exchange for additional forward
+   *          calculations.
+   *          Operators without arguments (e.g., inputs and random number
+   *          generators) always keep their values.
+   */
+  void set_checkpointing(bool enabled) { checkpointing_ = enabled; }
+
+  /**
+   * Returns whether the gradient checkpointing is enabled or not.
+   * @return `true` if the checkpointing is enabled, `false` otherwise.
+   */
+  bool is_checkpointing() const { return checkpointing_; }
+
+  /**
+   * Enables or disables the sharing of common subexpressions.
+   * @param enabled `true` to enable the sharing, `false` otherwise.
+   * @remarks While the sharing is enabled, `add_operator()` returns existing
+   *          nodes instead of adding a new operator if the graph already has
+   *          an operator with the same signature, device, and arguments which
+   *          was also added while the sharing is enabled.
+   *          Operators without signatures (e.g., inputs and random number
+   *          generators) are never shared. Note that `bind_parameter()` to a
+   *          shared parameter node affects all its users.
+   */
+  void set_subexpression_sharing(bool enabled) {
+    subexpression_sharing_ = enabled;
+  }
+
+  /**
+   * Returns whether the sharing of common subexpressions is enabled or not.
+   * @return `true` if the sharing is enabled, `false` otherwise.
+   */
+  bool is_subexpression_sharing() const { return subexpression_sharing_; }
+
+  /**
+   * Enables or disables the constant folding.
+   * @param enabled `true` to enable the constant folding, `false` otherwise.
+   * @remarks While the constant folding is enabled, operators whose arguments
+   *          are all constants (e.g., results of `functions::zeros()` and
+   *          `functions::identity()`) are calculated immediately by
+   *          `add_operator()`, and each constant value is released after all
+   *          its users are calculated. Released values are recalculated when
+   *          they are required again.
+   */
+  void set_constant_folding(bool enabled) { constant_folding_ = enabled; }
+
+  /**
+   * Returns whether the constant folding is enabled or not.
+   * @return `true` if the constant folding is enabled, `false` otherwise.
+   */
+  bool is_constant_folding() const { return constant_folding_; }
+
+  /**
+   * Enables/disables the fusion of elementwise operators in captured plans.
+   * @param enabled `true` to enable the fusion, `false` otherwise.
+   * @remarks This option is applied by the next `capture()`. While the fusion
+   *          is enabled, `capture()` collapses each chain of elementwise
+   *          operators on Naive or Eigen devices into one operator which
+   *          calculates all results element by element. Intermediate values
+   *          in the chain are not calculated by `replay()`, and are
+   *          recalculated when they are required.
+   */
+  void set_operator_fusion(bool enabled) { operator_fusion_ = enabled; }
+
+  /**
+   * Returns whether the fusion of elementwise operators is enabled or not.
+   * @return `true` if the fusion is enabled, `false` otherwise.
+   */
+  bool is_operator_fusion() const { return operator_fusion_; }
+
+  /**
+   * Enables/disables the static memory planning of captured plans.
+   * @param enabled `true` to enable the memory planning, `false` otherwise.
+   * @remarks This option is applied by the next `capture()`. While the memory
+   *          planning is enabled, `capture()` assigns intermediate values of
+   *          the plan to offsets in a preallocated memory arena of each
+   *          device, reusing the memory of values which are no longer used,
+   *          and elementwise operators overwrite their dead arguments
+   *          in-place. Only values on devices in the CPU group and consumed
+   *          only by operators which support writing into given memory are
+   *          planned. Planned values are released at the end of `replay()`
+   *          and recalculated when they are required again.
+   */
+  void set_memory_planning(bool enabled) { memory_planning_ = enabled; }
+
+  /**
+   * Returns whether the memory planning is enabled or not.
+   * @return `true` if the memory planning is enabled, `false` otherwise.
+   */
+  bool is_memory_planning() const { return memory_planning_; }
+
+  /**
+   * Enables or disables the automatic batching of operators.
+   * @param enabled `true` to enable the batching, `false` otherwise.
+   * @remarks While the batching is enabled, `forward()` calculates operators
+   *          in waves of operators whose arguments are all available. In each
+   *          wave, operators which calculate each minibatch independently and
+   *          have the same signature, device, and argument shapes are merged
+   *          into one call: their arguments are concatenated along the
+   *          minibatch, and results are split into each operator. Arguments
+   *          shared by all merged operators should not have minibatches, and
+   *          are not concatenated. This mode improves the throughput of
+   *          models written for each sample (e.g., tree-structured networks)
+   *          without changing their code.
+   *          This mode affects only `forward()`, and disables the
+   *          multithreaded execution of `forward()`.
+   */
+  void set_autobatching(bool enabled) { autobatching_ = enabled; }
+
+  /**
+   * Returns whether the automatic batching is enabled or not.
+   * @return `true` if the batching is enabled, `false` otherwise.
+   */
+  bool is_autobatching() const { return autobatching_; }
+
+  /**
+   * Returns the total size of memory arenas used by the captured plan.
+   * @return Number of bytes of memory arenas, or 0 if the memory planning was
+   *         disabled while capturing the plan.
+   */
+  std::size_t planned_memory_size() const;
+
+  /**
+   * Returns the number of operators invoked by `replay()`.
+   * @return Number of operators in the captured plan.
+   */
+  std::uint32_t plan_size() const { return plan_.size(); }
+
+  /**
+   * Enables/disables the profiler.
+   * @param enabled `true` to enable the profiler, `false` otherwise.
+   * @remarks While the profiler is enabled, the graph records the wall time,
+   *          the size of results, the number of memory allocations, and the
+   *          device of every forward and backward operation of operators.
+   *          Recorded profiles are obtained by `dump("trace")` or
+   *          `dump("profile")`, and are kept until `clear_profile()`.
+   */
+  void set_profiling(bool enabled);
+
+  /**
+   * Returns whether the profiler is enabled or not.
+   * @return `true` if the profiler is enabled, `false` otherwise.
+   */
+  bool is_profiling() const { return profiling_; }
+
+  /**
+   * Discards all recorded profiles.
+   */
+  void clear_profile();
+
+  /**
+   * Summary of the memory usage recorded by the memory tracker.
+   */
+  struct MemoryUsage {
+    // Number of bytes of tensors currently alive.
+    std::size_t live_bytes;
+    // Maximum number of bytes of tensors alive at the same time.
+    std::size_t peak_bytes;
+    // Total number of bytes allocated by forward operations.
+    std::size_t forward_bytes;
+    // Total number of bytes allocated by backward operations.
+    std::size_t backward_bytes;
+  };
+
+  /**
+   * Enables/disables the memory tracker.
+   * @param enabled `true` to enable the tracker, `false` otherwise.
+   * @remarks While the tracker is enabled, every tensor allocated by forward
+   *          and backward operations of operators is attributed to the
+   *          operator, and the tracker records the number of bytes alive
+   *          until the tensor is released. Recorded usages are obtained by
+   *          `memory_usage()` or `dump("memory")`, and are discarded by
+   *          `clear()` or disabling the tracker.
+   */
+  void set_memory_tracking(bool enabled);
+
+  /**
+   * Returns whether the memory tracker is enabled or not.
+   * @return `true` if the tracker is enabled, `false` otherwise.
+   */
+  bool is_memory_tracking() const { return !!memory_tracker_; }
+
+  /**
+   * Returns the memory usage recorded by the memory tracker.
+   * @return Summary of the memory usage, or zeros if the tracker is disabled.
+   */
+  MemoryUsage memory_usage() const;
+
   /**
    * Calculates the value of given node.
    * @param node Node object specifying the target node.
@@ -175,14 +507,113 @@ public:
    */
   const Tensor &forward(const Node &node);
 
+  /**
+   * Calculates values of given nodes at once.
+   * @param nodes List of Node objects specifying target nodes.
+   * @return List of pointers to calculated values, in the same order as
+   *         `nodes`.
+   * @remarks This function calculates the union of subgraphs required to
+   *          calculate all target nodes by one traversal, and each operator
+   *          is calculated only once. All target values are kept until this
+   *          function returns even in the inference mode.
+   */
+  std::vector<const Tensor *> forward(const std::vector<Node> &nodes);
+
+  /**
+   * Calculates values of given nodes at once and copies them to the host.
+   * @param nodes List of Node objects specifying target nodes.
+   * @return List of calculated values, in the same order as `nodes`.
+   * @remarks This function is equivalent to calling `Node::to_vector()` of
+   *          each node, but calculates all values by one `forward()` before
+   *          copying any of them.
+   */
+  std::vector<std::vector<float>> fetch(const std::vector<Node> &nodes);
+
   /**
    * Calculates the backpropagation.
    * @param node Node object specifying the output node.
    * @remarks If `node` is not yet forwarded, this function implicitly calls
    *          `forward(node)`.
+   * @throw primitiv::Error The graph is in the inference mode.
    */
   void backward(const Node &node);
 
+  /**
+   * Captures the execution plan to calculate given nodes.
+   * @param nodes List of nodes to be calculated by `replay()`.
+   * @remarks The plan holds all operators required to calculate `nodes`
+   *          regardless of whether their values are already calculated or not.
+   *          Previously captured plan is discarded by this function or
+   *          `clear()`.
+   */
+  void capture(const std::vector<Node> &nodes);
+
+  /**
+   * Recalculates all values in the captured plan.
+   * @throw primitiv::Error No plan is captured.
+   * @remarks This function invokes only the forward operation of each operator
+   *          in the plan, and skips the shape calculation and other
+   *          bookkeeping performed while constructing the graph. All values in
+   *          the plan are kept after this function to allow subsequent
+   *          `forward()` and `backward()` calls.
+   */
+  void replay();
+
+  /**
+   * Binds new data to the node created by `functions::input()`.
+   * @param node Node object specifying the input node.
+   * @param data List of new values.
+   * @throw primitiv::Error `node` is not an input node, or the size of `data`
+   *                        does not match the shape of `node`.
+   * @remarks Values already calculated using `node` are not updated until
+   *          the next `replay()`.
+   */
+  void bind_input(const Node &node, const std::vector<float> &data);
+
+  /**
+   * Binds a new Parameter object to the node created by
+   * `functions::parameter()`.
+   * @param node Node object specifying the parameter node.
+   * @param param New Parameter object.
+   * @throw primitiv::Error `node` is not a parameter node, or the shape or the
+   *                        device of `param` does not match those of `node`.
+   * @remarks The node is no longer shared by the subexpression sharing, and
+   *          later `functions::parameter()` makes a new node.
+   */
+  void bind_parameter(const Node &node, Parameter &param);
+
+  /**
+   * Saves the captured execution plan.
+   * @param path File path to save the plan.
+   * @param model Model object which holds all parameters used by the plan.
+   * @throw primitiv::Error No plan is captured, the plan uses a parameter not
+   *                        registered in `model`, or the plan contains an
+   *                        operator which can not be serialized.
+   * @remarks The file holds all operators required by the plan with their
+   *          attributes, arguments, and shapes of return values. Parameters
+   *          are stored as their keys in `model` instead of their values.
+   */
+  void save_plan(const std::string &path, const Model &model) const;
+
+  /**
+   * Loads the execution plan saved by `save_plan()`.
+   * @param path File path of the saved plan.
+   * @param model Model object which holds all parameters used by the plan.
+   * @param inputs Output list of nodes created by `functions::input()` in
+   *               the plan, in the order of creation.
+   * @param device Device object used by all operators in the plan, or
+   *               `nullptr` to use the default device.
+   * @return List of nodes which were given to `capture()`.
+   * @throw primitiv::Error The file is broken, or `model` does not match the
+   *                        plan.
+   * @remarks This function clears the graph, restores all operators, and
+   *          captures the plan again. `bind_input()` and `replay()` can be
+   *          used immediately after this function.
+   */
+  std::vector<Node> load_plan(
+      const std::string &path, Model &model, std::vector<Node> &inputs,
+      Device *device = nullptr);
+
   /**
    * Retrieves the shape of the node.
    * @param node Node object specifying the target node.
@@ -197,10 +628,27 @@ public:
    */
   Device &get_device(const Node &node) const;
 
+  /**
+   * Checks whether the node depends on any trainable values.
+   * @param node Node object specifying the target node.
+   * @param excluded List of nodes whose operators are not regarded as
+   *                 trainable.
+   * @return `true` if some operator used to calculate `node` has trainable
+   *         values (e.g., parameters), `false` otherwise.
+   */
+  bool depends_on_trainable_values(
+      const Node &node, const std::vector<Node> &excluded) const;
+
   /**
    * Dump internal graph structure.
    * @param format Name of the format. Available options:
    *                 "dot" ... Graphviz's dot format.
+   *                 "trace" ... Chrome's trace event format (JSON) of
+   *                             recorded profiles.
+   *                 "profile" ... Text summary of recorded profiles
+   *                               aggregated by names of operators.
+   *                 "memory" ... Text summary of the memory usage and
+   *                              operators which hold the most memory.
    * @return A string that represents the internal graph using given format.
    */
   std::string dump(const std::string &format) const;
@@ -220,6 +668,44 @@ private:
     std::uint32_t vid;
   };
 
+  /**
+   * List of addresses of arguments.
+   * @remarks Up to `NUM_INLINE` addresses are stored in the object itself, and
+   *          longer lists are stored in the operator arena.
+   */
+  class ArgumentList {
+  public:
+    static constexpr std::uint32_t NUM_INLINE = 2;
+
+    ArgumentList() : size_(0), outer_(nullptr) {}
+
+    /**
+     * Creates a new list.
+     * @param size Number of arguments.
+     * @param arena Arena used when `size` is greater than `NUM_INLINE`.
+     */
+    ArgumentList(std::uint32_t size, Arena &arena)
+      : size_(size)
+      , outer_(size > NUM_INLINE
+          ? static_cast<Address *>(
+            arena.allocate(size * sizeof(Address), alignof(Address)))
+          : nullptr) {}
+
+    std::uint32_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    Address *begin() { return outer_ ? outer_ : inner_; }
+    Address *end() { return begin() + size_; }
+    const Address *begin() const { return outer_ ? outer_ : inner_; }
+    const Address *end() const { return begin() + size_; }
+    Address &operator[](std::uint32_t i) { return begin()[i]; }
+    const Address &operator[](std::uint32_t i) const { return begin()[i]; }
+
+  private:
+    std::uint32_t size_;
+    Address inner_[NUM_INLINE];
+    Address *outer_;
+  };
+
   /**
    * Informations of each node.
    */
@@ -228,21 +714,368 @@ private:
     Device *device;
     Tensor value;
     Tensor grad;
-    //std::vector<std::uint32_t> sinks;
+    std::uint32_t num_pending_sinks;
   };
 
+  /**
+   * Deleter of operators which may be placed in the operator arena.
+   */
+  struct OperatorDeleter {
+    bool in_arena;
+    void operator()(Operator *op) const {
+      if (in_arena) op->~Operator();
+      else delete op;
+    }
+  };
+
+  using OperatorPtr = std::unique_ptr<Operator, OperatorDeleter>;
+  using NodeInfoList = std::vector<NodeInfo, ArenaAllocator<NodeInfo>>;
+
   /**
    * Set of informations that represents the operator: an implementation of the
    * operator, its arguments, and its return values.
    */
   struct OperatorInfo {
-    std::unique_ptr<Operator> op;
-    std::vector<Address> args;
-    std::vector<NodeInfo> rets;
+    OperatorPtr op;
+    ArgumentList args;
+    NodeInfoList rets;
+    std::uint64_t visited;
+    bool requires_grad;
+    bool recomputable;
+    bool constant;
   };
 
+  class MemoryTracker;
+
+  /**
+   * Profile of one forward or backward operation.
+   */
+  struct ProfileEvent {
+    std::uint32_t oid;
+    bool backward;
+    std::string name;
+    Device::DeviceType device_type;
+    const Device *device;
+    std::thread::id thread;
+    std::chrono::steady_clock::duration begin;
+    std::chrono::steady_clock::duration duration;
+    std::size_t bytes;
+    std::uint64_t num_allocations;
+  };
+
+  /**
+   * Working space to gather arguments of operator functions.
+   */
+  struct WorkSpace {
+    std::vector<const Tensor *> args_v;
+    std::vector<Tensor *> args_g;
+    std::vector<Tensor *> rets;
+    std::vector<const Tensor *> rets_v;
+    std::vector<const Tensor *> rets_g;
+    std::vector<Tensor> dummy_g;
+    std::vector<Tensor> local_g;
+  };
+
+  /**
+   * Location of a return value in the memory arena.
+   */
+  struct Buffer {
+    std::uint32_t vid;
+    std::uint32_t arena;
+    std::uint32_t offset;
+  };
+
+  /**
+   * A step of the captured execution plan.
+   */
+  struct Step {
+    std::uint32_t oid;
+    std::unique_ptr<Operator> fused;
+    std::vector<Address> inputs;
+    std::vector<const Tensor *> args;
+    std::vector<Tensor *> rets;
+    std::vector<Buffer> buffers;
+    std::vector<Tensor *> fused_rets;  // Values of other fused operators.
+  };
+
+  /**
+   * Adds an operator into the graph.
+   * @param op Interface of the new operator.
+   * @param args Pointer to the first argument.
+   * @param argn Number of arguments.
+   * @return Operator ID of the new or the shared operator.
+   */
+  std::uint32_t add_operator_impl(
+      OperatorPtr &&op, const Node *args, std::uint32_t argn);
+
+  /**
+   * Checks whether the value is already calculated or not.
+   * @param addr Address of the target value.
+   * @return `true` if the value is available, `false` otherwise.
+   */
+  bool is_calculated(const Address addr) const {
+    const OperatorInfo &f = ops_[addr.oid];
+    return f.op->has_inner_values() || f.rets[addr.vid].value.valid();
+  }
+
+  /**
+   * Obtains the pointer of the calculated value.
+   * @param addr Address of the target value.
+   * @return Pointer of the value.
+   * @remarks The value should be calculated before calling this function.
+   */
+  const Tensor *get_value(const Address addr) const {
+    const OperatorInfo &f = ops_[addr.oid];
+    return f.op->has_inner_values()
+      ? f.op->get_inner_values()[addr.vid]
+      : &f.rets[addr.vid].value;
+  }
+
+  /**
+   * Makes the execution schedule to calculate given values.
+   * @param targets Addresses of target values.
+   * @param force If `true`, operators whose results are already available are
+   *              also scheduled.
+   * @param schedule Output list of operator IDs.
+   * @remarks Resulting operator IDs are stored into `schedule` in a
+   *          topological order. Unless `force` is `true`, operators whose
+   *          results are already available are omitted from the schedule.
+   *          Operators with inner values are never scheduled.
+   */
+  void make_schedule(
+      const std::vector<Address> &targets, bool force,
+      std::vector<std::uint32_t> &schedule);
+
+  /**
+   * Calculates all operators required to obtain given values.
+   * @param targets Addresses of target values.
+   * @remarks Target values are kept until this function returns even in the
+   *          inference mode.
+   */
+  void forward_targets(const std::vector<Address> &targets);
+
+  /**
+   * Updates argument pointers of all steps in the captured plan.
+   */
+  void update_plan_arguments();
+
+  /**
+   * Obtains the operator invoked by the step.
+   * @param step A step of the captured plan.
+   * @return The fused operator if available, or the original operator.
+   */
+  const Operator &get_step_operator(const Step &step) const {
+    return step.fused ? *step.fused : *ops_[step.oid].op;
+  }
+
+  /**
+   * Collapses chains of elementwise operators in the captured plan.
+   * @param targets Addresses of values which are kept after `replay()`.
+   * @remarks Operators in the plan should be marked by `visited` using
+   *          `make_schedule()` before calling this function.
+   */
+  void fuse_operators(const std::vector<Address> &targets);
+
+  /**
+   * Assigns intermediate values of the captured plan to memory arenas.
+   * @param targets Addresses of values which are kept after `replay()`.
+   * @remarks Operators in the plan should be marked by `visited` using
+   *          `make_schedule()` before calling this function.
+   */
+  void plan_memory(const std::vector<Address> &targets);
+
+  /**
+   * Checks whether given operators can be calculated by worker threads.
+   * @param oids List of operator IDs.
+   * @return `true` if the thread pool is available and all operators are
+   *         placed on CPU devices, `false` otherwise.
+   */
+  bool is_parallelizable(const std::vector<std::uint32_t> &oids) const;
+
+  /**
+   * Performs the forward operation of one operator.
+   * @param oid Operator ID to be calculated.
+   * @param ws Working space.
+   * @remarks All arguments of the operator should be calculated before calling
+   *          this function.
+   */
+  void forward_operator(std::uint32_t oid, WorkSpace &ws);
+
+  /**
+   * Invokes the forward operation of the operator, and records its profile if
+   * the profiler is enabled.
+   * @param oid Operator ID.
+   * @param op Operator to be invoked.
+   * @param args Values of arguments.
+   * @param rets Values of return values.
+   */
+  void invoke_forward(
+      std::uint32_t oid, const Operator &op,
+      const std::vector<const Tensor *> &args,
+      const std::vector<Tensor *> &rets);
+
+  /**
+   * Records the profile of one operation.
+   * @param oid Operator ID.
+   * @param op Invoked operator.
+   * @param backward `true` if the operation is the backward operation.
+   * @param begin Time when the operation started.
+   * @param num_allocations Number of memory allocations on this thread when
+   *                        the operation started.
+   * @param results Tensors written by the operation.
+   */
+  void record_profile(
+      std::uint32_t oid, const Operator &op, bool backward,
+      std::chrono::steady_clock::time_point begin,
+      std::uint64_t num_allocations, const std::vector<Tensor *> &results);
+
+  /**
+   * Makes the text summary of the memory usage.
+   * @return Summary string.
+   */
+  std::string dump_memory() const;
+
+  /**
+   * Makes Chrome's trace event JSON of recorded profiles.
+   * @return JSON string.
+   */
+  std::string dump_trace() const;
+
+  /**
+   * Makes the text summary of recorded profiles.
+   * @return Summary string.
+   */
+  std::string dump_profile() const;
+
+  /**
+   * Updates the number of operators waiting for each argument of the operator.
+   * @param oid Operator ID which was calculated.
+   * @remarks In the inference mode, the checkpointing, or the constant folding,
+   *          argument values which are no longer used by any other operators
+   *          are released.
+   */
+  void release_arguments(std::uint32_t oid);
+
+  /**
+   * Calculates all operators in `schedule_` using worker threads.
+   */
+  void forward_parallel();
+
+  /**
+   * Calculates all operators in `schedule_` with the automatic batching.
+   */
+  void forward_batched();
+
+  /**
+   * Makes the key to find operators which can be merged into one call.
+   * @param oid Operator ID.
+   * @param key Output key, or an empty string if the operator can not be
+   *            merged with other operators.
+   */
+  void make_batch_key(std::uint32_t oid, std::string &key) const;
+
+  /**
+   * Calculates operators with the same batch key by one call.
+   * @param oids List of operator IDs.
+   * @remarks Operators are calculated one by one if their arguments can not be
+   *          concatenated.
+   */
+  void forward_group(const std::vector<std::uint32_t> &oids);
+
+  /**
+   * Performs the backward operation of one operator.
+   * @param oid Operator ID to be calculated.
+   * @param ws Working space.
+   * @param locks Locks of gradients indexed by `task_ids_`, or nullptr.
+   * @remarks This function does nothing if no gradients of return values are
+   *          available.
+   *          If `locks` is not nullptr, gradients of arguments are calculated
+   *          into `ws` first, and then merged into shared gradients while
+   *          holding the lock of each argument.
+   */
+  void backward_operator(
+      std::uint32_t oid, WorkSpace &ws, std::mutex *locks = nullptr);
+
+  /**
+   * Recalculates values released by the checkpointing which are required by
+   * the backward operation of the operator.
+   * @param oid Operator ID.
+   * @remarks Recalculated operators are recorded into `recomputed_`.
+   */
+  void recompute_values(std::uint32_t oid);
+
+  /**
+   * Releases values of recomputable operators in `recomputed_`, and clears
+   * `recomputed_`.
+   */
+  void release_recomputed_values();
+
+  /**
+   * Makes the schedule of the backward operation from given operator.
+   * @param last_oid Operator ID of the output node.
+   * @remarks Resulting operator IDs are stored into `schedule_` in the reverse
+   *          topological order. Operators which do not depend on any trainable
+   *          values (e.g., inputs and constants) are omitted.
+   */
+  void make_backward_schedule(std::uint32_t last_oid);
+
+  /**
+   * Performs the backward operation of all operators in `schedule_` using
+   * worker threads.
+   * @return `true` if the operation is performed, `false` if some operators
+   *         can not be calculated by worker threads.
+   */
+  bool backward_parallel();
+
   static Graph *default_obj_;
+
+  // Arena holding operators, long argument lists, and return values.
+  // This should be declared before `ops_` to outlive all operators.
+  Arena arena_;
+
   std::vector<OperatorInfo> ops_;
+  bool inference_mode_;
+  bool deterministic_;
+  bool checkpointing_;
+  bool subexpression_sharing_;
+  bool constant_folding_;
+  bool operator_fusion_;
+  bool memory_planning_;
+  bool profiling_;
+  bool autobatching_;
+  std::unique_ptr<ThreadPool> pool_;
+
+  // Working spaces reused by forward/backward operations to suppress
+  // allocations.
+  std::uint64_t visit_count_;
+  std::vector<std::uint32_t> schedule_;
+  std::vector<std::uint32_t> recompute_schedule_;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> stack_;
+  std::vector<std::uint32_t> task_ids_;
+  std::vector<Address> targets_;
+  std::vector<std::uint32_t> recomputed_;
+  std::vector<const Shape *> arg_shapes_;
+  std::vector<Shape *> ret_shapes_;
+  WorkSpace ws_;
+
+  // Operators which can be shared, keyed by their signatures, devices, and
+  // arguments.
+  std::unordered_map<std::string, std::uint32_t> shared_ops_;
+
+  // Captured execution plan.
+  std::vector<Step> plan_;
+  std::vector<Address> plan_targets_;
+
+  // Memory arenas holding planned values of the captured plan.
+  std::vector<Tensor> arenas_;
+
+  // Recorded profiles.
+  std::chrono::steady_clock::time_point profile_origin_;
+  std::vector<ProfileEvent> profile_;
+  mutable std::mutex profile_mutex_;
+
+  // Memory tracker shared with tensors allocated while it is enabled.
+  std::shared_ptr<MemoryTracker> memory_tracker_;
 };
 
 inline Shape Node::shape() const {
@@ -319,7 +319,8 @@ struct InternalState {
         },
         [](void *ptr) -> void {  // deleter
           CUDA_CALL(::cudaFree(ptr));
-        }) {}
+        },
+        true) {}
   CuBLASHandle cublas;
   CuRANDHandle curand;
   CuDNNHandle cudnn;
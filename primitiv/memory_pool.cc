@@ -1,32 +1,671 @@
 #include <primitiv/config.h>
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <primitiv/error.h>
 #include <primitiv/memory_pool.h>
 #include <primitiv/numeric_utils.h>
 
-using std::cerr;
-using std::endl;
-using std::make_pair;
+namespace {
+
+// Number of sub-classes in each power of two.
+constexpr std::uint32_t SUB_CLASS_SHIFTS = 2;
+
+// The last size class, which holds memories with 2^63 bytes.
+constexpr std::uint32_t MAX_CLASS = 63 << SUB_CLASS_SHIFTS;
+
+// Number of size classes.
+constexpr std::uint32_t NUM_CLASSES = MAX_CLASS + 1;
+
+// Memories up to 2^20 bytes are cached by each thread. Larger memories are
+// divided and merged in splittable pools.
+constexpr std::uint32_t MAX_CACHED_CLASS = 20 << SUB_CLASS_SHIFTS;
+
+// Maximum number of memories cached by each thread for each size class.
+constexpr std::size_t MAX_CACHED_BLOCKS = 16;
+
+// Number of 64-bit words of the bitmap of free lists.
+constexpr std::uint32_t NUM_BITMAP_WORDS = (NUM_CLASSES + 63) / 64;
+
+/*
+ * Size classes:
+ *   Each power of two `[2^k, 2^(k+1))` (k >= 2) is divided into 4 classes with
+ *   sizes `5 * 2^(k-2)`, `6 * 2^(k-2)`, `7 * 2^(k-2)` and `2^(k+1)`, so that
+ *   the wasted size of each memory is less than 25% of the requested size.
+ *   The class `c` holds memories with `(4 + c % 4) * 2^(c / 4 - 2)` bytes.
+ *   Sizes less than 4 bytes are rounded up to the power of two.
+ */
+
+// Calculates `floor(log2(x))`.
+std::uint32_t floor_log2(std::uint64_t x) {
+  const std::uint64_t s = primitiv::numeric_utils::calculate_shifts(x);
+  return s == 64 || (1ull << s) != x ? s - 1 : s;
+}
+
+// Obtains the smallest size class that can hold `size` bytes.
+std::uint32_t ceil_class(std::uint64_t size) {
+  if (size < 4) {
+    return primitiv::numeric_utils::calculate_shifts(size) << SUB_CLASS_SHIFTS;
+  }
+  const std::uint32_t fl = floor_log2(size);
+  const std::uint32_t sl = ((size - 1) >> (fl - SUB_CLASS_SHIFTS)) + 1;
+  return (fl << SUB_CLASS_SHIFTS) + sl - (1 << SUB_CLASS_SHIFTS);
+}
+
+// Obtains the largest size class that is not larger than `size` bytes.
+std::uint32_t floor_class(std::uint64_t size) {
+  const std::uint32_t fl = floor_log2(size);
+  if (fl < SUB_CLASS_SHIFTS) return fl << SUB_CLASS_SHIFTS;
+  const std::uint32_t sl = size >> (fl - SUB_CLASS_SHIFTS);
+  return (fl << SUB_CLASS_SHIFTS) + sl - (1 << SUB_CLASS_SHIFTS);
+}
+
+// Obtains the size of memories in the size class.
+std::uint64_t class_size(std::uint32_t cls) {
+  const std::uint32_t fl = cls >> SUB_CLASS_SHIFTS;
+  if (fl < SUB_CLASS_SHIFTS) return 1ull << fl;
+  const std::uint64_t sl = cls & ((1 << SUB_CLASS_SHIFTS) - 1);
+  return ((1 << SUB_CLASS_SHIFTS) + sl) << (fl - SUB_CLASS_SHIFTS);
+}
+
+// Updates the maximum value.
+template<typename T>
+void update_peak(std::atomic<T> &peak, T value) {
+  T prev = peak.load(std::memory_order_relaxed);
+  while (prev < value && !peak.compare_exchange_weak(prev, value)) {}
+}
+
+// Calculates the number of trailing zeros of a nonzero integer using the
+// de Bruijn sequence.
+std::uint32_t count_trailing_zeros(std::uint64_t x) {
+  static const std::uint32_t TABLE[64] {
+     0,  1,  2, 53,  3,  7, 54, 27,  4, 38, 41,  8, 34, 55, 48, 28,
+    62,  5, 39, 46, 44, 42, 22,  9, 24, 35, 59, 56, 49, 18, 29, 11,
+    63, 52,  6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+    51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12,
+  };
+  return TABLE[((x & (~x + 1)) * 0x022fdd63cc95386dull) >> 58];
+}
+
+// Set while the cache of the current thread is destroyed. This variable is
+// trivially destructible and is available at any time.
+thread_local bool thread_exiting = false;
+
+// Allocates a host memory aligned to `MemoryPool::ALIGNMENT` bytes. The
+// pointer returned by `std::malloc()` is stored just before the resulting
+// memory.
+void *aligned_malloc(std::size_t size) {
+  const std::size_t align = primitiv::MemoryPool::ALIGNMENT;
+  void *base = std::malloc(size + align + sizeof(void *));
+  if (!base) {
+    PRIMITIV_THROW_ERROR("Memory allocation failed. Requested size: " << size);
+  }
+  const std::uintptr_t head =
+    (reinterpret_cast<std::uintptr_t>(base) + sizeof(void *) + align - 1)
+    & ~static_cast<std::uintptr_t>(align - 1);
+  reinterpret_cast<void **>(head)[-1] = base;
+  return reinterpret_cast<void *>(head);
+}
+
+// Releases the memory allocated by `aligned_malloc()`.
+void aligned_free(void *ptr) {
+  std::free(static_cast<void **>(ptr)[-1]);
+}
+
+}  // namespace
 
 namespace primitiv {
 
+struct MemoryPool::Block {
+  void *ptr;
+  std::size_t size;
+  bool used;
+  Block *prev;  // Physically preceding block in the same chunk.
+  Block *next;  // Physically following block in the same chunk.
+  Block *prev_free;  // Previous block in the same free list.
+  Block *next_free;  // Next block in the same free list.
+};
+
+struct MemoryPool::State {
+  /**
+   * Free list of one size class shared by all threads.
+   */
+  struct FreeList {
+    std::mutex mutex;
+    std::vector<void *> blocks;
+  };
+
+  /**
+   * Memories cached by one thread. The lock is only contended while the
+   * pool is trimmed by other threads.
+   */
+  struct Cache {
+    std::mutex mutex;
+    std::vector<void *> blocks[MAX_CACHED_CLASS + 1];
+  };
+
+  /**
+   * Counters of one size class.
+   */
+  struct Counters {
+    std::atomic<std::uint64_t> in_use;
+    std::atomic<std::uint64_t> reserved;
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+    std::atomic<std::uint64_t> peak;
+  };
+
+  std::function<void *(std::size_t)> allocator;
+  std::function<void(void *)> deleter;
+  const bool splittable;
+  std::atomic<bool> alive;
+  FreeList free_lists[NUM_CLASSES];
+
+  // Caches of all threads using this pool.
+  std::mutex caches_mutex;
+  std::vector<Cache *> caches;
+
+  // Free blocks of splittable pools. Each list holds blocks with sizes in
+  // `[class_size(c), class_size(c + 1))`, and the bitmap holds whether each
+  // list has any blocks.
+  std::mutex heap_mutex;
+  Block *free_blocks[NUM_CLASSES];
+  std::uint64_t free_bitmap[NUM_BITMAP_WORDS];
+
+  // Statistics. Reserved memories in free lists of splittable pools are
+  // counted by the size classes of their free lists.
+  Counters counters[NUM_CLASSES];
+  std::atomic<std::size_t> allocated_bytes;
+  std::atomic<std::size_t> in_use_bytes;
+  std::atomic<std::size_t> peak_allocated_bytes;
+  std::atomic<std::size_t> peak_in_use_bytes;
+
+  // Background thread to trim the pool.
+  std::mutex policy_mutex;
+  std::mutex trimmer_mutex;
+  std::condition_variable trimmer_cv;
+  bool trimmer_stopping;
+  std::thread trimmer;
+
+  State(
+      std::function<void *(std::size_t)> allocator,
+      std::function<void(void *)> deleter,
+      bool splittable)
+    : allocator(allocator), deleter(deleter)
+    , splittable(splittable), alive(true)
+    , free_blocks(), free_bitmap(), counters()
+    , allocated_bytes(0), in_use_bytes(0)
+    , peak_allocated_bytes(0), peak_in_use_bytes(0)
+    , trimmer_stopping(false) {}
+
+  ~State() { trim(0); }
+
+  /**
+   * Obtains a memory from the free list or the allocator.
+   * @param cls Size class of the memory.
+   * @return Pointer of the memory.
+   */
+  void *allocate(std::uint32_t cls);
+
+  /**
+   * Obtains a new memory from the allocator.
+   * @param size Size of the memory.
+   * @return Pointer of the memory.
+   * @remarks Reserved memories are deleted and the allocation is retried once
+   *          if the allocator failed.
+   */
+  void *new_memory(std::size_t size);
+
+  /**
+   * Counts an allocation of the size class.
+   * @param cls Size class of the memory.
+   * @param hit Whether the memory was a reserved one.
+   */
+  void count_allocation(std::uint32_t cls, bool hit) {
+    Counters &c = counters[cls];
+    if (hit) {
+      ++c.hits;
+    } else {
+      ++c.misses;
+    }
+    ::update_peak(c.peak, ++c.in_use);
+    ::update_peak(
+        peak_in_use_bytes, in_use_bytes += ::class_size(cls));
+  }
+
+  /**
+   * Counts a release of the size class.
+   * @param cls Size class of the memory.
+   */
+  void count_release(std::uint32_t cls) {
+    --counters[cls].in_use;
+    in_use_bytes -= ::class_size(cls);
+  }
+
+  /**
+   * Returns a memory to the free list, or deletes it if the pool has gone.
+   * @param ptr Pointer of the memory.
+   * @param cls Size class of the memory.
+   */
+  void free(void *ptr, std::uint32_t cls) {
+    if (!alive) {
+      delete_block(ptr, ::class_size(cls));
+      return;
+    }
+    FreeList &list = free_lists[cls];
+    std::lock_guard<std::mutex> lock(list.mutex);
+    list.blocks.emplace_back(ptr);
+    ++counters[cls].reserved;
+  }
+
+  /**
+   * Registers a cache of a thread.
+   * @param cache Target cache.
+   */
+  void register_cache(Cache *cache) {
+    std::lock_guard<std::mutex> lock(caches_mutex);
+    caches.emplace_back(cache);
+  }
+
+  /**
+   * Unregisters a cache of a thread and returns its memories to the pool.
+   * @param cache Target cache.
+   */
+  void unregister_cache(Cache *cache) {
+    std::lock_guard<std::mutex> lock(caches_mutex);
+    flush_cache(*cache);
+    caches.erase(std::find(caches.begin(), caches.end(), cache));
+  }
+
+  /**
+   * Returns all memories in caches of all threads to the pool.
+   */
+  void flush_caches() {
+    std::lock_guard<std::mutex> lock(caches_mutex);
+    for (Cache *cache : caches) flush_cache(*cache);
+  }
+
+  /**
+   * Returns all memories in the cache to the pool.
+   * @param cache Target cache.
+   */
+  void flush_cache(Cache &cache) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (std::uint32_t cls = 0; cls <= MAX_CACHED_CLASS; ++cls) {
+      for (void *ptr : cache.blocks[cls]) {
+        --counters[cls].reserved;
+        free(ptr, cls);
+      }
+      cache.blocks[cls].clear();
+    }
+  }
+
+  /**
+   * Obtains a block by dividing a free block, or from the allocator.
+   * @param cls Size class of the block.
+   * @return Pointer of the block.
+   */
+  Block *allocate_block(std::uint32_t cls);
+
+  /**
+   * Returns a block to the free lists after merging it with its neighbors.
+   * @param block Target block.
+   * @remarks The whole chunk is deleted if it becomes free after the pool has
+   *          gone.
+   */
+  void free_block(Block *block) {
+    std::lock_guard<std::mutex> lock(heap_mutex);
+    block->used = false;
+    Block *next = block->next;
+    if (next && !next->used) {
+      remove_free_block(next);
+      merge_blocks(block, next);
+    }
+    Block *prev = block->prev;
+    if (prev && !prev->used) {
+      remove_free_block(prev);
+      merge_blocks(prev, block);
+      block = prev;
+    }
+    if (!alive && !block->prev && !block->next) {
+      delete_block(block->ptr, block->size);
+      delete block;
+      return;
+    }
+    insert_free_block(block);
+  }
+
+  /**
+   * Deletes reserved memories in free lists, and chunks without used blocks,
+   * in descending order of their sizes.
+   * @param max_reserved_bytes Upper bound of reserved bytes.
+   * @return Number of deleted bytes.
+   * @remarks Memories cached by threads are returned to the pool and deleted
+   *          only if other memories are not enough.
+   */
+  std::size_t trim(std::size_t max_reserved_bytes);
+
+  /**
+   * Deletes reserved memories in free lists.
+   * @param max_reserved_bytes Upper bound of reserved bytes.
+   * @return Number of deleted bytes.
+   */
+  std::size_t trim_free_lists(std::size_t max_reserved_bytes);
+
+  /**
+   * Stops the background thread to trim the pool.
+   * @remarks `policy_mutex` should be locked by the caller.
+   */
+  void stop_trimmer() {
+    if (!trimmer.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(trimmer_mutex);
+      trimmer_stopping = true;
+    }
+    trimmer_cv.notify_all();
+    trimmer.join();
+    trimmer_stopping = false;
+  }
+
+  /**
+   * Obtains the number of bytes reserved by the pool.
+   * @return Number of reserved bytes.
+   */
+  std::size_t reserved_bytes() const {
+    const std::size_t allocated = allocated_bytes;
+    const std::size_t in_use = in_use_bytes;
+    return allocated > in_use ? allocated - in_use : 0;
+  }
+
+  /**
+   * Deletes a memory.
+   * @param ptr Pointer of the memory.
+   * @param size Size of the memory.
+   * @remarks Errors are ignored because this function may be called while
+   *          destroying tensors after the device has gone.
+   */
+  void delete_block(void *ptr, std::size_t size) {
+    allocated_bytes -= size;
+    try {
+      deleter(ptr);
+    } catch (...) {}
+  }
+
+  /**
+   * Finds a free block that can hold memories of the size class.
+   * @param cls Size class of the memory.
+   * @return Pointer of the found block, or nullptr if not found.
+   * @remarks This function searches the bitmap in constant time.
+   */
+  Block *find_free_block(std::uint32_t cls) {
+    for (std::uint32_t w = cls / 64; w < NUM_BITMAP_WORDS; ++w) {
+      std::uint64_t bits = free_bitmap[w];
+      if (w == cls / 64) bits &= ~0ull << (cls % 64);
+      if (bits) return free_blocks[w * 64 + ::count_trailing_zeros(bits)];
+    }
+    return nullptr;
+  }
+
+  /**
+   * Adds a block to the free list.
+   * @param block Target block.
+   */
+  void insert_free_block(Block *block) {
+    const std::uint32_t cls = ::floor_class(block->size);
+    block->prev_free = nullptr;
+    block->next_free = free_blocks[cls];
+    if (block->next_free) block->next_free->prev_free = block;
+    free_blocks[cls] = block;
+    free_bitmap[cls / 64] |= 1ull << (cls % 64);
+    ++counters[cls].reserved;
+  }
+
+  /**
+   * Removes a block from the free list.
+   * @param block Target block.
+   */
+  void remove_free_block(Block *block) {
+    const std::uint32_t cls = ::floor_class(block->size);
+    if (block->prev_free) block->prev_free->next_free = block->next_free;
+    else free_blocks[cls] = block->next_free;
+    if (block->next_free) block->next_free->prev_free = block->prev_free;
+    if (!free_blocks[cls]) free_bitmap[cls / 64] &= ~(1ull << (cls % 64));
+    --counters[cls].reserved;
+  }
+
+  /**
+   * Divides a block and adds the remainder to the free list.
+   * @param block Target block.
+   * @param size Size of the first part.
+   */
+  void split_block(Block *block, std::size_t size) {
+    if (block->size == size) return;
+    Block *rest = new Block {
+      static_cast<char *>(block->ptr) + size, block->size - size, false,
+      block, block->next, nullptr, nullptr,
+    };
+    if (rest->next) rest->next->prev = rest;
+    block->size = size;
+    block->next = rest;
+    insert_free_block(rest);
+  }
+
+  /**
+   * Merges a block into the preceding block.
+   * @param block Preceding block.
+   * @param next Following block, which is deleted.
+   */
+  static void merge_blocks(Block *block, Block *next) {
+    block->size += next->size;
+    block->next = next->next;
+    if (block->next) block->next->prev = block;
+    delete next;
+  }
+};
+
+struct MemoryPool::ThreadCache {
+  /**
+   * Cached memories of one pool.
+   */
+  struct Entry {
+    std::shared_ptr<State> state;
+    std::unique_ptr<State::Cache> cache;
+  };
+
+  std::vector<Entry> entries;
+
+  ~ThreadCache() {
+    ::thread_exiting = true;
+    for (Entry &entry : entries) {
+      entry.state->unregister_cache(entry.cache.get());
+    }
+  }
+
+  /**
+   * Obtains the cache of the pool.
+   * @param state State of the pool.
+   * @return Reference of the cache.
+   * @remarks Caches of destroyed pools are flushed when a new cache is added.
+   *          The reference is available until the next call.
+   */
+  State::Cache &get(const std::shared_ptr<State> &state) {
+    for (Entry &entry : entries) {
+      if (entry.state == state) return *entry.cache;
+    }
+    for (auto it = entries.begin(); it != entries.end(); ) {
+      if (it->state->alive) {
+        ++it;
+      } else {
+        it->state->unregister_cache(it->cache.get());
+        it = entries.erase(it);
+      }
+    }
+    entries.emplace_back(Entry { state, std::unique_ptr<State::Cache>(
+          new State::Cache()) });
+    state->register_cache(entries.back().cache.get());
+    return *entries.back().cache;
+  }
+
+  /**
+   * Removes the cache of the pool and returns its memories to the pool.
+   * @param state State of the pool.
+   */
+  void remove(const State *state) {
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (it->state.get() == state) {
+        it->state->unregister_cache(it->cache.get());
+        entries.erase(it);
+        return;
+      }
+    }
+  }
+};
+
+void *MemoryPool::State::allocate(std::uint32_t cls) {
+  FreeList &list = free_lists[cls];
+  {
+    std::lock_guard<std::mutex> lock(list.mutex);
+    if (!list.blocks.empty()) {
+      void *ptr = list.blocks.back();
+      list.blocks.pop_back();
+      --counters[cls].reserved;
+      count_allocation(cls, true);
+      return ptr;
+    }
+  }
+  void *ptr = new_memory(::class_size(cls));
+  count_allocation(cls, false);
+  return ptr;
+}
+
+MemoryPool::Block *MemoryPool::State::allocate_block(std::uint32_t cls) {
+  const std::size_t size = ::class_size(cls);
+  {
+    std::lock_guard<std::mutex> lock(heap_mutex);
+    Block *block = find_free_block(cls);
+    if (block) {
+      remove_free_block(block);
+      split_block(block, size);
+      block->used = true;
+      count_allocation(cls, true);
+      return block;
+    }
+  }
+  std::unique_ptr<Block> block(new Block {
+    nullptr, size, true, nullptr, nullptr, nullptr, nullptr,
+  });
+  block->ptr = new_memory(size);
+  count_allocation(cls, false);
+  return block.release();
+}
+
+void *MemoryPool::State::new_memory(std::size_t size) {
+  void *ptr;
+  try {
+    ptr = allocator(size);
+  } catch (...) {
+    // Maybe out-of-memory.
+    // Release other blocks and try allocation again.
+    trim(0);
+    // Below allocation may throw an error when the memory allocation
+    // process finally failed.
+    ptr = allocator(size);
+  }
+  ::update_peak(peak_allocated_bytes, allocated_bytes += size);
+  return ptr;
+}
+
+std::size_t MemoryPool::State::trim(std::size_t max_reserved_bytes) {
+  std::size_t deleted = trim_free_lists(max_reserved_bytes);
+  if (reserved_bytes() > max_reserved_bytes) {
+    // Memories cached by threads, including idle ones, are deleted as well.
+    flush_caches();
+    deleted += trim_free_lists(max_reserved_bytes);
+  }
+  return deleted;
+}
+
+std::size_t MemoryPool::State::trim_free_lists(
+    std::size_t max_reserved_bytes) {
+  std::size_t deleted = 0;
+  for (std::uint32_t cls = NUM_CLASSES; cls-- > 0; ) {
+    if (reserved_bytes() <= max_reserved_bytes) break;
+    {
+      FreeList &list = free_lists[cls];
+      std::lock_guard<std::mutex> lock(list.mutex);
+      while (!list.blocks.empty() && reserved_bytes() > max_reserved_bytes) {
+        delete_block(list.blocks.back(), ::class_size(cls));
+        list.blocks.pop_back();
+        --counters[cls].reserved;
+        deleted += ::class_size(cls);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(heap_mutex);
+      for (Block *block = free_blocks[cls]; block; ) {
+        if (reserved_bytes() <= max_reserved_bytes) break;
+        Block *next_free = block->next_free;
+        if (!block->prev && !block->next) {
+          remove_free_block(block);
+          delete_block(block->ptr, block->size);
+          deleted += block->size;
+          delete block;
+        }
+        block = next_free;
+      }
+    }
+  }
+  return deleted;
+}
+
+void MemoryPool::Deleter::operator()(void *ptr) {
+  state_->count_release(cls_);
+  if (block_) {
+    state_->free_block(block_);
+    return;
+  }
+  ThreadCache *cache =
+    cls_ <= MAX_CACHED_CLASS && state_->alive ? get_thread_cache() : nullptr;
+  if (cache) {
+    State::Cache &c = cache->get(state_);
+    std::lock_guard<std::mutex> lock(c.mutex);
+    std::vector<void *> &blocks = c.blocks[cls_];
+    if (blocks.size() < MAX_CACHED_BLOCKS) {
+      blocks.emplace_back(ptr);
+      ++state_->counters[cls_].reserved;
+      return;
+    }
+  }
+  state_->free(ptr, cls_);
+}
+
+constexpr std::size_t MemoryPool::ALIGNMENT;
+
+MemoryPool::MemoryPool()
+: MemoryPool(::aligned_malloc, ::aligned_free, true) {}
+
 MemoryPool::MemoryPool(
     std::function<void *(std::size_t)> allocator,
-    std::function<void(void *)> deleter)
-: allocator_(allocator)
-, deleter_(deleter)
-, reserved_(64)
-, supplied_() {}
+    std::function<void(void *)> deleter,
+    bool splittable)
+: state_(std::make_shared<State>(allocator, deleter, splittable)) {}
 
 MemoryPool::~MemoryPool() {
-  // NOTE(odashi):
-  // Due to GC-based languages, we chouldn't assume that all memories were
-  // disposed before arriving this code.
-  while (!supplied_.empty()) {
-    free(supplied_.begin()->first);
-  }
-  release_reserved_blocks();
+  // Memories still in use are deleted by their deleters, because we
+  // shouldn't assume that all memories were disposed before arriving this
+  // code (e.g., in GC-based languages).
+  reset_trim_policy();
+  state_->alive = false;
+  ThreadCache *cache = get_thread_cache();
+  if (cache) cache->remove(state_.get());
+  state_->trim(0);
 }
 
 std::shared_ptr<void> MemoryPool::allocate(std::size_t size) {
@@ -34,50 +673,89 @@ std::shared_ptr<void> MemoryPool::allocate(std::size_t size) {
 
   if (size == 0) return std::shared_ptr<void>();
 
-  static const std::uint64_t MAX_SHIFTS = 63;
-  const std::uint64_t shift = numeric_utils::calculate_shifts(size);
-  if (shift > MAX_SHIFTS) PRIMITIV_THROW_ERROR("Invalid memory size: " << size);
+  const std::uint32_t cls = ::ceil_class(size);
+  if (cls > MAX_CLASS) PRIMITIV_THROW_ERROR("Invalid memory size: " << size);
 
-  void *ptr;
-  if (reserved_[shift].empty()) {
-    // Allocates a new block.
-    try {
-      ptr = allocator_(1ull << shift);
-    } catch (...) {
-      // Maybe out-of-memory.
-      // Release other blocks and try allocation again.
-      release_reserved_blocks();
-      // Below allocation may throw an error when the memory allocation
-      // process finally failed.
-      ptr = allocator_(1ull << shift);
+  if (cls > MAX_CACHED_CLASS && state_->splittable) {
+    // Large memories are divided from free blocks.
+    Block *block = state_->allocate_block(cls);
+    return std::shared_ptr<void>(block->ptr, Deleter(state_, cls, block));
+  }
+
+  void *ptr = nullptr;
+  ThreadCache *cache = cls <= MAX_CACHED_CLASS ? get_thread_cache() : nullptr;
+  if (cache) {
+    // Returns a memory cached by this thread.
+    State::Cache &c = cache->get(state_);
+    std::lock_guard<std::mutex> lock(c.mutex);
+    std::vector<void *> &blocks = c.blocks[cls];
+    if (!blocks.empty()) {
+      ptr = blocks.back();
+      blocks.pop_back();
+      --state_->counters[cls].reserved;
+      state_->count_allocation(cls, true);
     }
-    supplied_.emplace(ptr, shift);
-  } else {
-    // Returns an existing block.
-    ptr = reserved_[shift].back();
-    reserved_[shift].pop_back();
-    supplied_.emplace(ptr, shift);
   }
+  if (!ptr) ptr = state_->allocate(cls);
 
-  return std::shared_ptr<void>(ptr, Deleter(id()));
+  return std::shared_ptr<void>(ptr, Deleter(state_, cls, nullptr));
 }
 
-void MemoryPool::free(void *ptr) {
-  auto it = supplied_.find(ptr);
-  if (it == supplied_.end()) {
-    PRIMITIV_THROW_ERROR("Detected to dispose unknown handle: " << ptr);
-  }
-  reserved_[it->second].emplace_back(ptr);
-  supplied_.erase(it);
+std::size_t MemoryPool::trim(std::size_t max_reserved_bytes) {
+  return state_->trim(max_reserved_bytes);
 }
 
-void MemoryPool::release_reserved_blocks() {
-  for (auto &ptrs : reserved_) {
-    while (!ptrs.empty()) {
-      deleter_(ptrs.back());
-      ptrs.pop_back();
+void MemoryPool::set_trim_policy(
+    std::size_t max_reserved_bytes, std::uint32_t interval_ms) {
+  if (interval_ms == 0) {
+    PRIMITIV_THROW_ERROR("Interval of trimming should be greater than 0.");
+  }
+  std::lock_guard<std::mutex> policy_lock(state_->policy_mutex);
+  state_->stop_trimmer();
+  State *state = state_.get();
+  state->trimmer = std::thread([state, max_reserved_bytes, interval_ms] {
+    const std::chrono::milliseconds interval(interval_ms);
+    std::unique_lock<std::mutex> lock(state->trimmer_mutex);
+    while (!state->trimmer_cv.wait_for(
+          lock, interval, [state] { return state->trimmer_stopping; })) {
+      state->trim(max_reserved_bytes);
     }
+  });
+}
+
+void MemoryPool::reset_trim_policy() {
+  std::lock_guard<std::mutex> policy_lock(state_->policy_mutex);
+  state_->stop_trimmer();
+}
+
+MemoryPool::Statistics MemoryPool::get_statistics() const {
+  Statistics stats;
+  stats.allocated_bytes = state_->allocated_bytes;
+  stats.in_use_bytes = state_->in_use_bytes;
+  stats.reserved_bytes = state_->reserved_bytes();
+  stats.peak_allocated_bytes = state_->peak_allocated_bytes;
+  stats.peak_in_use_bytes = state_->peak_in_use_bytes;
+  for (std::uint32_t cls = 0; cls < NUM_CLASSES; ++cls) {
+    const State::Counters &c = state_->counters[cls];
+    if (c.hits == 0 && c.misses == 0 && c.reserved == 0) continue;
+    stats.classes.emplace_back(ClassStatistics {
+        static_cast<std::size_t>(::class_size(cls)),
+        c.in_use, c.reserved, c.hits, c.misses, c.peak,
+    });
   }
+  return stats;
 }
 
-}  // namespace
+void MemoryPool::reset_peaks() {
+  state_->peak_allocated_bytes = state_->allocated_bytes.load();
+  state_->peak_in_use_bytes = state_->in_use_bytes.load();
+  for (State::Counters &c : state_->counters) c.peak = c.in_use.load();
+}
+
+MemoryPool::ThreadCache *MemoryPool::get_thread_cache() {
+  if (::thread_exiting) return nullptr;
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+}  // namespace primitiv
@@ -5,7 +5,6 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
-#include <unordered_map>
 #include <vector>
 
 #include <primitiv/mixins.h>
@@ -14,61 +13,177 @@ namespace primitiv {
 
 /**
  * Memory manager on the device specified by allocator/deleter functors.
+ * @remarks This class is thread-safe. Each thread keeps a small cache of
+ *          released memories and reuses them through an uncontended lock,
+ *          which is taken by other threads only while trimming. Other
+ *          released memories are shared by all threads through the free list
+ *          of each size class, which has its own lock.
+ * @remarks Each size of memories is rounded up to one of 4 size classes in
+ *          each power of two. If the pool is splittable, memories larger than
+ *          1 MiB are divided from larger free blocks, and are merged with
+ *          their free neighbors when released.
+ * @remarks Released memories are kept by the pool until an allocation fails,
+ *          `trim()` is called, or the background trimming policy deletes
+ *          them.
  */
 class MemoryPool : public mixins::Identifiable<MemoryPool> {
+  /**
+   * Internal state shared by the pool and memories supplied from it.
+   */
+  struct State;
+
+  /**
+   * Cache of released memories owned by each thread.
+   */
+  struct ThreadCache;
+
+  /**
+   * Division of a memory obtained from the allocator.
+   */
+  struct Block;
+
   /**
    * Custom deleter class for MemoryPool.
+   * @remarks The deleter holds the state of the pool directly, and is
+   *          available even after the pool is destroyed.
    */
   class Deleter {
-    std::uint64_t pool_id_;
+    std::shared_ptr<State> state_;
+    std::uint32_t cls_;
+    Block *block_;
   public:
-    explicit Deleter(std::uint64_t pool_id) : pool_id_(pool_id) {}
-
-    void operator()(void *ptr) {
-      try {
-        MemoryPool::get_object(pool_id_).free(ptr);
-      } catch (primitiv::Error) {
-        // Memory pool already has gone and the pointer is already deleted by
-        // the memory pool.
-      }
-    }
+    Deleter(
+        const std::shared_ptr<State> &state, std::uint32_t cls, Block *block)
+      : state_(state), cls_(cls), block_(block) {}
+
+    void operator()(void *ptr);
   };
 
-  std::function<void *(std::size_t)> allocator_;
-  std::function<void(void *)> deleter_;
-  std::vector<std::vector<void *>> reserved_;
-  std::unordered_map<void *, std::uint32_t> supplied_;
+  std::shared_ptr<State> state_;
 
 public:
+  /**
+   * Statistics of one size class.
+   */
+  struct ClassStatistics {
+    // Size of each memory in bytes.
+    std::size_t size;
+    // Number of memories in use.
+    std::uint64_t in_use;
+    // Number of released memories kept by the pool.
+    std::uint64_t reserved;
+    // Number of allocations using reserved memories.
+    std::uint64_t hits;
+    // Number of allocations calling the allocator.
+    std::uint64_t misses;
+    // Maximum number of memories in use.
+    std::uint64_t peak;
+  };
+
+  /**
+   * Statistics of the memory pool.
+   */
+  struct Statistics {
+    // Bytes obtained from the allocator.
+    std::size_t allocated_bytes;
+    // Bytes of memories in use.
+    std::size_t in_use_bytes;
+    // Bytes of memories kept by the pool.
+    std::size_t reserved_bytes;
+    // Maximum of `allocated_bytes`.
+    std::size_t peak_allocated_bytes;
+    // Maximum of `in_use_bytes`.
+    std::size_t peak_in_use_bytes;
+    // Statistics of size classes used so far.
+    std::vector<ClassStatistics> classes;
+  };
+
+  /**
+   * Alignment of memories allocated by the default constructor in bytes.
+   */
+  static constexpr std::size_t ALIGNMENT = 64;
+
+  /**
+   * Creates a splittable memory pool on the host memory.
+   * @remarks Each memory supplied by this pool is aligned to `ALIGNMENT`
+   *          bytes.
+   */
+  MemoryPool();
+
   /**
    * Creates a memory pool.
    * @param allocator Functor to allocate new memories.
    * @param deleter Functor to delete allocated memories.
+   * @param splittable Whether each allocated memory can be divided, i.e.,
+   *                   `static_cast<char *>(ptr) + offset` is also a valid
+   *                   pointer on the device.
    */
   explicit MemoryPool(
       std::function<void *(std::size_t)> allocator,
-      std::function<void(void *)> deleter);
+      std::function<void(void *)> deleter,
+      bool splittable = false);
 
+  /**
+   * Destroys the memory pool.
+   * @remarks Reserved memories, including those cached by threads, are
+   *          deleted immediately. Memories still used are deleted when they
+   *          are released.
+   */
   ~MemoryPool();
 
   /**
    * Allocates a memory.
    * @param size Size of the resulting memory.
    * @return Shared pointer of the allocated memory.
+   * @remarks This function can be called from multiple threads.
    */
   std::shared_ptr<void> allocate(std::size_t size);
 
-private:
   /**
-   * Disposes the memory managed by this pool.
-   * @param ptr Handle of the memory to be disposed.
+   * Deletes reserved memories until the number of reserved bytes becomes
+   * less than or equal to the given bound. Larger memories are deleted
+   * first.
+   * @param max_reserved_bytes Upper bound of reserved bytes.
+   * @return Number of deleted bytes.
+   * @remarks Memories cached by threads are also deleted if other reserved
+   *          memories are not enough.
+   */
+  std::size_t trim(std::size_t max_reserved_bytes);
+
+  /**
+   * Starts a background thread that calls `trim()` periodically.
+   * @param max_reserved_bytes Upper bound of reserved bytes.
+   * @param interval_ms Interval of trimming in milliseconds.
+   * @throw primitiv::Error `interval_ms` is 0.
+   * @remarks The previous policy is replaced by the new one.
    */
-  void free(void *ptr);
+  void set_trim_policy(
+      std::size_t max_reserved_bytes, std::uint32_t interval_ms);
 
   /**
-   * Releases all reserved memory blocks.
+   * Stops the background trimming.
+   */
+  void reset_trim_policy();
+
+  /**
+   * Retrieves the statistics of the memory pool.
+   * @return Statistics object.
+   * @remarks Counters are updated by multiple threads concurrently, and the
+   *          result may not be an exact snapshot.
+   */
+  Statistics get_statistics() const;
+
+  /**
+   * Resets all peak values to current values.
+   */
+  void reset_peaks();
+
+private:
+  /**
+   * Obtains the cache of the current thread.
+   * @return Pointer of the cache, or nullptr if the thread is exiting.
    */
-  void release_reserved_blocks();
+  static ThreadCache *get_thread_cache();
 };
 
 }  // namespace primitiv
@@ -1,9 +1,11 @@
 #ifndef PRIMITIV_MIXINS_H_
 #define PRIMITIV_MIXINS_H_
 
+#include <atomic>
 #include <cstdint>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <primitiv/error.h>
 
 namespace primitiv {
@@ -88,6 +90,8 @@ std::mutex Identifiable<T>::mutex_;
 
 /**
  * Mix-in class to provide default value setter/getter.
+ * @remarks Each thread can override the process-wide default object by its own
+ *          default object, which is invisible from other threads.
  */
 template<typename T>
 class DefaultSettable {
@@ -97,39 +101,113 @@ class DefaultSettable {
   DefaultSettable &operator=(DefaultSettable &&) = delete;
 
   /**
-   * Pointer of current default object.
+   * Thread-specific default object. All slots are registered to unregister
+   * destroyed objects from every thread.
    */
-  static T *default_obj_;
+  struct ThreadSlot {
+    std::atomic<T *> obj;
+
+    ThreadSlot() : obj(nullptr) {
+      std::lock_guard<std::mutex> lock(slots_mutex());
+      slots().emplace(this);
+    }
+
+    ~ThreadSlot() {
+      std::lock_guard<std::mutex> lock(slots_mutex());
+      slots().erase(this);
+    }
+  };
+
+  // Registry of all slots. These are constructed on demand to be available
+  // while initializing other static objects, and at the latest by the first
+  // settable object.
+  static std::unordered_set<ThreadSlot *> &slots() {
+    static std::unordered_set<ThreadSlot *> slots;
+    return slots;
+  }
+
+  static std::mutex &slots_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  /**
+   * Pointer of current process-wide default object.
+   */
+  static std::atomic<T *> default_obj_;
+
+  static thread_local ThreadSlot thread_slot_;
 
 protected:
-  DefaultSettable() = default;
+  DefaultSettable() {
+    // Constructs the registry before this object so that the registry is
+    // destroyed after this object, e.g., when this is a global object.
+    slots_mutex();
+    slots();
+  }
 
   ~DefaultSettable() {
     // If the current default object is this, unregister it.
-    if (default_obj_ == static_cast<T *>(this)) {
-      default_obj_ = nullptr;
+    T *self = static_cast<T *>(this);
+    T *expected = self;
+    default_obj_.compare_exchange_strong(expected, nullptr);
+    std::lock_guard<std::mutex> lock(slots_mutex());
+    for (ThreadSlot *slot : slots()) {
+      expected = self;
+      slot->obj.compare_exchange_strong(expected, nullptr);
     }
   }
 
 public:
   /**
    * Retrieves the current default object.
-   * @return Reference of the current default object.
+   * @return Reference of the default object of the current thread if
+   *         specified, or reference of the process-wide default object.
    * @throw primitiv::Error Default object is null.
    */
   static T &get_default() {
-    if (!default_obj_) PRIMITIV_THROW_ERROR("Default object is null.");
-    return *default_obj_;
+    T *obj = thread_slot_.obj.load();
+    if (!obj) obj = default_obj_.load();
+    if (!obj) PRIMITIV_THROW_ERROR("Default object is null.");
+    return *obj;
   }
 
   /**
-   * Specifies a new default object.
+   * Specifies a new process-wide default object.
    * @param obj Reference of the new default object.
+   * @remarks Threads which have their own default objects are not affected.
    */
   static void set_default(T &obj) {
     default_obj_ = &obj;
   }
 
+  /**
+   * Specifies a new default object of the current thread.
+   * @param obj Reference of the new default object.
+   * @remarks The object is used instead of the process-wide default object
+   *          only on the current thread.
+   */
+  static void set_thread_default(T &obj) {
+    thread_slot_.obj = &obj;
+  }
+
+  /**
+   * Unregisters the default object of the current thread, and falls back to
+   * the process-wide default object.
+   */
+  static void reset_thread_default() {
+    thread_slot_.obj = nullptr;
+  }
+
+  /**
+   * Retrieves the default object of the current thread.
+   * @return Pointer of the default object of the current thread, or `nullptr`
+   *         if it is not specified.
+   */
+  static T *get_thread_default() {
+    return thread_slot_.obj.load();
+  }
+
   /**
    * Obtains the reference of the object pointed by a pointer, or obtains the
    * default object.
@@ -145,7 +223,10 @@ public:
 };
 
 template<typename T>
-T *DefaultSettable<T>::default_obj_ = nullptr;
+std::atomic<T *> DefaultSettable<T>::default_obj_(nullptr);
+template<typename T>
+thread_local typename DefaultSettable<T>::ThreadSlot
+DefaultSettable<T>::thread_slot_;
 
 }  // namespace mixins
 }  // namespace primitiv
@@ -1,7 +1,9 @@
 #ifndef PRIMITIV_NAIVE_DEVICE_H_
 #define PRIMITIV_NAIVE_DEVICE_H_
 
+#include <memory>
 #include <primitiv/device.h>
+#include <primitiv/memory_pool.h>
 #include <primitiv/random.h>
 
 namespace primitiv {
@@ -9,25 +11,62 @@ namespace devices {
 
 /**
  * Device class for the naive function implementations on CPU.
+ * @remarks This device is thread-safe: kernels can be called concurrently from
+ *          multiple threads as long as they do not write the same tensor.
+ *          Each thread draws random numbers from its own stream.
  */
 class Naive : public Device {
 public:
   /**
    * Creates a Naive object.
    */
-  Naive() = default;
+  Naive() : pool_(new MemoryPool()) {}
 
   /**
    * Creates a Naive object.
    * @param seed The seed value of internal random number generator.
    */
-  explicit Naive(std::uint32_t seed) : randomizer_(seed) {}
+  explicit Naive(std::uint32_t seed)
+    : randomizer_(seed), pool_(new MemoryPool()) {}
+
+  /**
+   * Creates a Naive object.
+   * @param seed The seed value of internal random number generator.
+   * @param use_memory_pool If `true`, memories of tensors are allocated
+   *                        through the memory pool which reuses released
+   *                        memories. Otherwise, each memory is allocated by
+   *                        `std::malloc()`.
+   */
+  Naive(std::uint32_t seed, bool use_memory_pool)
+    : randomizer_(seed)
+    , pool_(use_memory_pool ? new MemoryPool() : nullptr) {}
 
   ~Naive() override = default;
 
   void dump_description() const override;
   Device::DeviceType type() const override { return Device::DeviceType::NAIVE; }
 
+  /**
+   * Retrieves the memory pool of this device.
+   * @return Pointer of the memory pool, or nullptr if the pool is disabled.
+   */
+  MemoryPool *memory_pool() const { return pool_.get(); }
+
+  /**
+   * Enables or disables the memory pool.
+   * @param enabled If `true`, memories of new tensors are allocated through
+   *                the memory pool. Otherwise, each memory is allocated by
+   *                `std::malloc()`.
+   * @remarks Memories of existing tensors are still available. Disabling the
+   *          pool deletes its reserved memories immediately.
+   *          This function should not be called while other threads are
+   *          using this device.
+   */
+  void set_memory_pool_enabled(bool enabled) {
+    if (!enabled) pool_.reset();
+    else if (!pool_) pool_.reset(new MemoryPool());
+  }
+
 private:
   std::shared_ptr<void> new_handle(const Shape &shape) override;
 
@@ -138,6 +177,10 @@ private:
       const Tensor &a, const Tensor &b, const Tensor &y, const Tensor &gy,
       Tensor &ga, Tensor &gb) override;
 
+  void fused_elementwise_fw_impl(
+      const std::vector<const Tensor *> &xs,
+      const std::vector<ElementwiseInstruction> &program, Tensor &y) override;
+
   void sum_fw_impl(const Tensor &x, std::uint32_t dim, Tensor &y) override;
   void logsumexp_fw_impl(const Tensor &x, std::uint32_t dim, Tensor &y) override;
   void broadcast_fw_impl(const Tensor &x, std::uint32_t dim, std::uint32_t size, Tensor &y) override;
@@ -177,6 +220,7 @@ private:
 
 private:
   DefaultRandomizer randomizer_;
+  std::unique_ptr<MemoryPool> pool_;
 };
 
 }  // namespace devices
@@ -13,12 +13,14 @@
 #include <primitiv/operator_impl.h>
 #include <primitiv/parameter.h>
 
-#define REG(g, op, ...) ( \
-    (g).add_operator( \
-      std::unique_ptr<Operator>(new operators::op), \
+// Constructs the operator in the operator arena of the graph.
+// `args` is the parenthesized list of arguments of the constructor.
+#define REG(g, op, args, ...) ( \
+    (g).add_arena_operator( \
+      (g).new_operator<operators::op> args, \
       {__VA_ARGS__}))
 
-#define REGX(x, op, ...) REG((x).graph(), op, __VA_ARGS__)
+#define REGX(x, op, args, ...) REG((x).graph(), op, args, __VA_ARGS__)
 
 namespace {
 
@@ -38,128 +40,128 @@ namespace primitiv {
 namespace functions {
 
 template<>
-Node positive(const Node &x) { return REGX(x, Positive(), x)[0]; }
+Node positive(const Node &x) { return REGX(x, Positive, (), x); }
 
 template<>
-Node negative(const Node &x) { return REGX(x, Negative(), x)[0]; }
+Node negative(const Node &x) { return REGX(x, Negative, (), x); }
 
 template<>
-Node add(const Node &x, float k) { return REGX(x, AddConst(k), x)[0]; }
+Node add(const Node &x, float k) { return REGX(x, AddConst, (k), x); }
 
 template<>
-Node add(float k, const Node &x) { return REGX(x, AddConst(k), x)[0]; }
+Node add(float k, const Node &x) { return REGX(x, AddConst, (k), x); }
 
 template<>
 Node add(const Node &a, const Node &b) {
-  if (a.shape().is_scalar()) return REGX(a, AddScalar(), b, a)[0];
-  else if (b.shape().is_scalar()) return REGX(a, AddScalar(), a, b)[0];
-  else return REGX(a, Add(), a, b)[0];
+  if (a.shape().is_scalar()) return REGX(a, AddScalar, (), b, a);
+  else if (b.shape().is_scalar()) return REGX(a, AddScalar, (), a, b);
+  else return REGX(a, Add, (), a, b);
 }
 
 template<>
 Node subtract(const Node &x, float k) {
-  return REGX(x, SubtractConstR(k), x)[0];
+  return REGX(x, SubtractConstR, (k), x);
 }
 
 template<>
 Node subtract(float k, const Node &x) {
-  return REGX(x, SubtractConstL(k), x)[0];
+  return REGX(x, SubtractConstL, (k), x);
 }
 
 template<>
 Node subtract(const Node &a, const Node &b) {
-  if (a.shape().is_scalar()) return REGX(a, SubtractScalarL(), b, a)[0];
-  else if (b.shape().is_scalar()) return REGX(a, SubtractScalarR(), a, b)[0];
-  else return REGX(a, Subtract(), a, b)[0];
+  if (a.shape().is_scalar()) return REGX(a, SubtractScalarL, (), b, a);
+  else if (b.shape().is_scalar()) return REGX(a, SubtractScalarR, (), a, b);
+  else return REGX(a, Subtract, (), a, b);
 }
 
 template<>
 Node multiply(const Node &x, float k) {
-  return REGX(x, MultiplyConst(k), x)[0];
+  return REGX(x, MultiplyConst, (k), x);
 }
 
 template<>
 Node multiply(float k, const Node &x) {
-  return REGX(x, MultiplyConst(k), x)[0];
+  return REGX(x, MultiplyConst, (k), x);
 }
 
 template<>
 Node multiply(const Node &a, const Node &b) {
-  if (a.shape().is_scalar()) return REGX(a, MultiplyScalar(), b, a)[0];
-  else if (b.shape().is_scalar()) return REGX(a, MultiplyScalar(), a, b)[0];
-  else return REGX(a, Multiply(), a, b)[0];
+  if (a.shape().is_scalar()) return REGX(a, MultiplyScalar, (), b, a);
+  else if (b.shape().is_scalar()) return REGX(a, MultiplyScalar, (), a, b);
+  else return REGX(a, Multiply, (), a, b);
 }
 
 template<>
-Node divide(const Node &x, float k) { return REGX(x, DivideConstR(k), x)[0]; }
+Node divide(const Node &x, float k) { return REGX(x, DivideConstR, (k), x); }
 
 template<>
-Node divide(float k, const Node &x) { return REGX(x, DivideConstL(k), x)[0]; }
+Node divide(float k, const Node &x) { return REGX(x, DivideConstL, (k), x); }
 
 template<>
 Node divide(const Node &a, const Node &b) {
-  if (a.shape().is_scalar()) return REGX(a, DivideScalarL(), b, a)[0];
-  else if (b.shape().is_scalar()) return REGX(a, DivideScalarR(), a, b)[0];
-  else return REGX(a, Divide(), a, b)[0];
+  if (a.shape().is_scalar()) return REGX(a, DivideScalarL, (), b, a);
+  else if (b.shape().is_scalar()) return REGX(a, DivideScalarR, (), a, b);
+  else return REGX(a, Divide, (), a, b);
 }
 
 template<>
-Node pow(const Node &x, float k) { return REGX(x, PowConstR(k), x)[0]; }
+Node pow(const Node &x, float k) { return REGX(x, PowConstR, (k), x); }
 
 template<>
-Node pow(float k, const Node &x) { return REGX(x, PowConstL(k), x)[0]; }
+Node pow(float k, const Node &x) { return REGX(x, PowConstL, (k), x); }
 
 template<>
 Node pow(const Node &a, const Node &b) {
-  if (a.shape().is_scalar()) return REGX(a, PowScalarL(), b, a)[0];
-  else if (b.shape().is_scalar()) return REGX(a, PowScalarR(), a, b)[0];
-  else return REGX(a, Pow(), a, b)[0];
+  if (a.shape().is_scalar()) return REGX(a, PowScalarL, (), b, a);
+  else if (b.shape().is_scalar()) return REGX(a, PowScalarR, (), a, b);
+  else return REGX(a, Pow, (), a, b);
 }
 
 template<>
-Node pown(const Node &x, std::int32_t k) { return REGX(x, PowN(k), x)[0]; }
+Node pown(const Node &x, std::int32_t k) { return REGX(x, PowN, (k), x); }
 
 Node input_node(
     const Shape &shape, const std::vector<float> &data, Device *dev, Graph *g) {
   return REG(
       Graph::get_reference_or_default(g),
-      Input(shape, data, Device::get_reference_or_default(dev))
-  )[0];
+      Input, (shape, data, Device::get_reference_or_default(dev))
+  );
 }
 
 Node parameter_node(primitiv::Parameter &param, Graph *g) {
-  return REG(Graph::get_reference_or_default(g), Parameter(param))[0];
+  return REG(Graph::get_reference_or_default(g), Parameter, (param));
 }
 
 template<>
 Node copy(const Node &x, Device *dev) {
-  return REGX(x, Copy(Device::get_reference_or_default(dev)), x)[0];
+  return REGX(x, Copy, (Device::get_reference_or_default(dev)), x);
 }
 
 template<>
 Node pick(
     const Node &x, const std::vector<std::uint32_t> &ids, std::uint32_t dim) {
-  return REGX(x, Pick(ids, dim), x)[0];
+  return REGX(x, Pick, (ids, dim), x);
 }
 
 template<>
 Node slice(
     const Node &x, std::uint32_t dim,
     std::uint32_t lower, std::uint32_t upper) {
-  return REGX(x, Slice(dim, lower, upper), x)[0];
+  return REGX(x, Slice, (dim, lower, upper), x);
 }
 
 template<>
 std::vector<Node> split(const Node &x, std::uint32_t dim, std::uint32_t n) {
-  return REGX(x, Split(dim, n), x);
+  return x.graph().add_operator(
+      std::unique_ptr<Operator>(new operators::Split(dim, n)), {x});
 }
 
 template<>
 Node concat(const std::vector<Node> &xs, std::uint32_t dim) {
   if (xs.empty()) PRIMITIV_THROW_ERROR("No nodes to concat.");
-  return xs[0].graph().add_operator(
-      std::unique_ptr<Operator>(new operators::Concat(dim)), xs
-  )[0];
+  Graph &g = xs[0].graph();
+  return g.add_arena_operator(g.new_operator<operators::Concat>(dim), xs);
 }
 
 template<>
@@ -169,102 +171,102 @@ Node concat(const std::vector<const Node *> &xs, std::uint32_t dim) {
 
 template<>
 Node reshape(const Node &x, const Shape &shape) {
-  return REGX(x, Reshape(shape), x)[0];
+  return REGX(x, Reshape, (shape), x);
 }
 
 template<>
 Node flatten(const Node &x) {
-  return REGX(x, Flatten(), x)[0];
+  return REGX(x, Flatten, (), x);
 }
 
 template<>
 Node transpose(const Node &x) {
-  return REGX(x, Transpose(), x)[0];
+  return REGX(x, Transpose, (), x);
 }
 
 template<>
 Node matmul(const Node &a, const Node &b) {
-  return REGX(a, MatrixMultiply(), a, b)[0];
+  return REGX(a, MatrixMultiply, (), a, b);
 }
 
 template<>
 Node sqrt(const Node &x) {
-  return REGX(x, Sqrt(), x)[0];
+  return REGX(x, Sqrt, (), x);
 }
 
 template<>
 Node exp(const Node &x) {
-  return REGX(x, Exp(), x)[0];
+  return REGX(x, Exp, (), x);
 }
 
 template<>
 Node log(const Node &x) {
-  return REGX(x, Log(), x)[0];
+  return REGX(x, Log, (), x);
 }
 
 template<>
 Node tanh(const Node &x) {
-  return REGX(x, Tanh(), x)[0];
+  return REGX(x, Tanh, (), x);
 }
 
 template<>
 Node sigmoid(const Node &x) {
-  return REGX(x, Sigmoid(), x)[0];
+  return REGX(x, Sigmoid, (), x);
 }
 
 template<>
 Node softplus(const Node &x) {
-  return REGX(x, Softplus(), x)[0];
+  return REGX(x, Softplus, (), x);
 }
 
 template<>
 Node sin(const Node &x) {
-  return REGX(x, Sin(), x)[0];
+  return REGX(x, Sin, (), x);
 }
 
 template<>
 Node cos(const Node &x) {
-  return REGX(x, Cos(), x)[0];
+  return REGX(x, Cos, (), x);
 }
 
 template<>
 Node tan(const Node &x) {
-  return REGX(x, Tan(), x)[0];
+  return REGX(x, Tan, (), x);
 }
 
 template<>
 Node relu(const Node &x) {
-  return REGX(x, ReLU(), x)[0];
+  return REGX(x, ReLU, (), x);
 }
 
 template<>
 Node lrelu(const Node &x) {
-  return REGX(x, LReLU(), x)[0];
+  return REGX(x, LReLU, (), x);
 }
 
 template<>
 Node prelu(const Node &x, float a) {
-  return REGX(x, PReLU(a), x)[0];
+  return REGX(x, PReLU, (a), x);
 }
 
 template<>
 Node elu(const Node &x, float a) {
-  return REGX(x, ELU(a), x)[0];
+  return REGX(x, ELU, (a), x);
 }
 
 template<>
 Node sum(const Node &x, std::uint32_t dim) {
-  return REGX(x, Sum(dim), x)[0];
+  return REGX(x, Sum, (dim), x);
 }
 
 template<>
 Node broadcast(const Node &x, std::uint32_t dim, std::uint32_t size) {
-  return REGX(x, Broadcast(dim, size), x)[0];
+  return REGX(x, Broadcast, (dim, size), x);
 }
 
 template<>
 Node logsumexp(const Node &x, std::uint32_t dim) {
-  return REGX(x, LogSumExp(dim), x)[0];
+  return REGX(x, LogSumExp, (dim), x);
 }
 
 template<>
@@ -279,18 +281,29 @@ Node softmax(const Node &x, std::uint32_t dim) {
 
 template<>
 Node softmax_cross_entropy(const Node &x, const Node &t, std::uint32_t dim) {
-  return REGX(x, SoftmaxCrossEntropy(dim), x, t)[0];
+  return REGX(x, SoftmaxCrossEntropy, (dim), x, t);
 }
 
 template<>
 Node softmax_cross_entropy(
     const Node &x, const std::vector<std::uint32_t> &ids, std::uint32_t dim) {
-  return REGX(x, SparseSoftmaxCrossEntropy(ids, dim), x)[0];
+  return REGX(x, SparseSoftmaxCrossEntropy, (ids, dim), x);
 }
 
 template<>
 Node stop_gradient(const Node &x) {
-  return REGX(x, StopGradient(), x)[0];
+  return REGX(x, StopGradient, (), x);
+}
+
+std::vector<Node> scan(
+    const std::function<
+      std::vector<Node>(const std::vector<Node> &, const Node &)> &step,
+    const std::vector<Node> &init, const Node &xs, std::uint32_t dim) {
+  std::vector<Node> args(init);
+  args.emplace_back(xs);
+  return xs.graph().add_operator(
+      std::unique_ptr<Operator>(new operators::Scan(step, init, xs, dim)),
+      args);
 }
 
 template<>
@@ -301,9 +314,10 @@ Node conv2d(
     std::uint32_t dilation0, std::uint32_t dilation1) {
   return REGX(
       x,
-      Convolution2D(padding0, padding1, stride0, stride1, dilation0, dilation1),
+      Convolution2D,
+      (padding0, padding1, stride0, stride1, dilation0, dilation1),
       x, w
-  )[0];
+  );
 }
 
 template<>
@@ -314,16 +328,16 @@ Node max_pool2d(
     std::uint32_t stride0, std::uint32_t stride1) {
   return REGX(
       x,
-      MaxPooling2D(window0, window1, padding0, padding1, stride0, stride1),
+      MaxPooling2D, (window0, window1, padding0, padding1, stride0, stride1),
       x
-  )[0];
+  );
 }
 
 namespace batch {
 
 template<>
 Node sum(const Node &x) {
-  return REGX(x, BatchSum(), x)[0];
+  return REGX(x, BatchSum, (), x);
 }
 
 }  // namespace batch
@@ -331,15 +345,15 @@ Node sum(const Node &x) {
 Node constant_node(const Shape &shape, float k, Device *dev, Graph *g) {
   return REG(
       Graph::get_reference_or_default(g),
-      Constant(shape, k, Device::get_reference_or_default(dev))
-  )[0];
+      Constant, (shape, k, Device::get_reference_or_default(dev))
+  );
 }
 
 Node identity_node(std::uint32_t size, Device *dev, Graph *g) {
   return REG(
       Graph::get_reference_or_default(g),
-      Identity(size, Device::get_reference_or_default(dev))
-  )[0];
+      Identity, (size, Device::get_reference_or_default(dev))
+  );
 }
 
 namespace random {
@@ -348,33 +362,33 @@ Node bernoulli_node(
     const Shape &shape, float p, Device *dev, Graph *g) {
   return REG(
       Graph::get_reference_or_default(g),
-      RandomBernoulli(shape, p, Device::get_reference_or_default(dev))
-  )[0];
+      RandomBernoulli, (shape, p, Device::get_reference_or_default(dev))
+  );
 }
 
 Node uniform_node(
     const Shape &shape, float lower, float upper, Device *dev, Graph *g) {
   return REG(
       Graph::get_reference_or_default(g),
-      RandomUniform(
+      RandomUniform, (
         shape, lower, upper, Device::get_reference_or_default(dev))
-  )[0];
+  );
 }
 
 Node normal_node(
     const Shape &shape, float mean, float sd, Device *dev, Graph *g) {
   return REG(
       Graph::get_reference_or_default(g),
-      RandomNormal(shape, mean, sd, Device::get_reference_or_default(dev))
-  )[0];
+      RandomNormal, (shape, mean, sd, Device::get_reference_or_default(dev))
+  );
 }
 
 Node log_normal_node(
     const Shape &shape, float mean, float sd, Device *dev, Graph *g) {
   return REG(
       Graph::get_reference_or_default(g),
-      RandomLogNormal(shape, mean, sd, Device::get_reference_or_default(dev))
-  )[0];
+      RandomLogNormal, (shape, mean, sd, Device::get_reference_or_default(dev))
+  );
 }
 
 Node gumbel_node(
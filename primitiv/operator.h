@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <primitiv/elementwise.h>
 #include <primitiv/mixins.h>
 #include <primitiv/shape.h>
 #include <primitiv/tensor.h>
@@ -11,6 +12,10 @@ namespace primitiv {
 
 class Device;
 
+namespace msgpack {
+class Writer;
+}  // namespace msgpack
+
 /**
  * Interface of the operator on the computation graph.
  */
@@ -25,6 +30,16 @@ public:
    */
   virtual std::string name() const = 0;
 
+  /**
+   * Returns the signature of the operator.
+   * @return A string which consists of the type and all attributes of the
+   *         operator, or an empty string if the operator can not be identified
+   *         with other operators (e.g., random number generators).
+   * @remarks Two operators with the same non-empty signature should calculate
+   *          the same results from the same arguments on the same device.
+   */
+  virtual std::string signature() const { return std::string(); }
+
   static constexpr std::uint32_t ANY = 0xffffffff;
   static constexpr std::uint32_t NONZERO = 0xfffffffe;
 
@@ -49,6 +64,78 @@ public:
    */
   virtual bool has_inner_values() const = 0;
 
+  /**
+   * Returns whether the operator holds values updated by gradients or not.
+   * @return `true` if the operator holds trainable values (e.g., parameters),
+   *         `false` otherwise.
+   * @remarks The backward operation is performed only through operators which
+   *          depend on some trainable values.
+   */
+  virtual bool has_trainable_values() const { return false; }
+
+  /**
+   * Returns whether `forward()` can write results into given tensors or not.
+   * @return `true` if `forward()` writes results into the memory of `rets`
+   *         when they hold valid tensors with correct shapes, `false`
+   *         otherwise.
+   */
+  virtual bool accepts_return_buffers() const { return false; }
+
+  /**
+   * Returns whether `backward()` can receive invalid gradients of arguments.
+   * @return `true` if `backward()` treats invalid tensors in `args_g` as 0,
+   *         `false` otherwise.
+   * @remarks Gradients of arguments are initialized by 0 before calling
+   *          `backward()` of operators which return `false`.
+   */
+  virtual bool accepts_invalid_gradients() const { return false; }
+
+  /**
+   * Returns whether the operator is elementwise or not.
+   * @return `true` if each element of return values depends only on elements
+   *         at the same position of arguments, `false` otherwise.
+   * @remarks Results of elementwise operators can be written into the memory
+   *          of arguments with the same shape.
+   */
+  virtual bool is_elementwise() const { return false; }
+
+  /**
+   * Returns whether the operator calculates each minibatch independently.
+   * @return `true` if results of the operator with arguments concatenated
+   *         along the minibatch are equal to the concatenation of its results
+   *         with each argument, `false` otherwise.
+   * @remarks Calls of such operators with the same signature can be merged
+   *          into one call by concatenating their arguments.
+   */
+  virtual bool is_batchable() const { return false; }
+
+  /**
+   * Obtains the instruction of fused elementwise operations which performs the
+   * same calculation as this operator.
+   * @param inst Output instruction. Its operands represent the indices of
+   *             arguments of this operator.
+   * @return `true` if the instruction is available, `false` otherwise.
+   */
+  virtual bool get_elementwise_instruction(
+      ElementwiseInstruction &inst) const {
+    static_cast<void>(inst);
+    return false;
+  }
+
+  /**
+   * Writes the type and all attributes of the operator.
+   * @param writer Writer object of the output stream.
+   * @throw primitiv::Error The operator can not be serialized.
+   * @remarks Written data is restored by `operators::load_operator()`, using
+   *          the device given to the loader instead of the device of this
+   *          operator.
+   */
+  virtual void save(msgpack::Writer &writer) const {
+    static_cast<void>(writer);
+    PRIMITIV_THROW_ERROR(
+        "Operator `" << name() << "` does not support serialization.");
+  }
+
   /**
    * Returns the device object if the class holds it.
    * @return A pointer of the Device object if the class holds it, or nullptr
@@ -106,6 +193,9 @@ public:
    * @remarks `args_v/g` and `rets_v/g` should have the same number of pointers
    *          with the value returned from `num_arguments()` and
    *          `num_returns()`.
+   *          If `accepts_invalid_gradients()` returns `true`, each `args_g`
+   *          may be an invalid tensor which represents zeros, and the first
+   *          contribution should be assigned to it instead of accumulated.
    */
   virtual void backward(
       const std::vector<const Tensor *> &args_v,
@@ -1,6 +1,11 @@
 #include <primitiv/config.h>
 
 #include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <primitiv/device.h>
 #include <primitiv/error.h>
 #include <primitiv/functions.h>
@@ -22,15 +27,124 @@ namespace operators {
 
 Input::Input(const Shape &shape, const vector<float> &data, Device &device)
 : shape_(shape)
-, data_(data)
+, data_()
 , device_(device) {
-  if (data_.size() != shape_.size()) {
+  reset_data(data);
+}
+
+namespace {
+
+// Registers a graph as the default graph of the current thread while the
+// object is alive.
+class DefaultGraphScope {
+public:
+  explicit DefaultGraphScope(Graph &g) : prev_(Graph::get_thread_default()) {
+    Graph::set_thread_default(g);
+  }
+
+  ~DefaultGraphScope() {
+    if (prev_) Graph::set_thread_default(*prev_);
+    else Graph::reset_thread_default();
+  }
+
+private:
+  Graph *prev_;
+};
+
+}  // namespace
+
+Scan::Scan(
+    const StepFunction &step,
+    const vector<Node> &init, const Node &xs, std::uint32_t dim)
+: num_states_(init.size())
+, dim_(dim)
+, graph_(new Graph())
+, input_(nullptr)
+, trainable_(false) {
+  if (init.empty()) PRIMITIV_THROW_ERROR("No initial states are given.");
+
+  // Builds the step subgraph once. Leaf nodes created by `step` (e.g.,
+  // parameters) are added to the inner graph.
+  const auto placeholder = [&](const Shape &shape, Device &dev, bool trainable) {
+    Placeholder *op = new Placeholder(shape, dev, trainable);
+    const Node node = graph_->add_operator(
+        std::unique_ptr<Operator>(op), {})[0];
+    return std::make_pair(op, node);
+  };
+  vector<Node> state_nodes;
+  for (const Node &x : init) {
+    state_shapes_.emplace_back(x.shape());
+    const auto ph = placeholder(x.shape(), x.device(), true);
+    states_.emplace_back(ph.first);
+    state_nodes.emplace_back(ph.second);
+  }
+  if (dim >= Shape::MAX_DEPTH) {
+    PRIMITIV_THROW_ERROR("Invalid dimension: " << dim);
+  }
+  input_shape_ = xs.shape().resize_dim(dim, 1);
+  const auto input_ph = placeholder(input_shape_, xs.device(), true);
+  input_ = input_ph.first;
+  {
+    DefaultGraphScope scope(*graph_);
+    outputs_ = step(state_nodes, input_ph.second);
+  }
+  if (outputs_.size() != num_states_) {
+    PRIMITIV_THROW_ERROR(
+        "Number of states mismatched. required: " << num_states_
+        << ", actual: " << outputs_.size());
+  }
+  for (std::uint32_t i = 0; i < num_states_; ++i) {
+    if (&outputs_[i].graph() != graph_.get() ||
+        outputs_[i].shape() != init[i].shape()) {
+      PRIMITIV_THROW_ERROR(
+          "Invalid state is returned from the step function. index: " << i
+          << ", required shape: " << init[i].shape().to_string());
+    }
+  }
+
+  // The backward operation of each step calculates gradients of the loss
+  // `sum_i <outputs_[i], seeds_[i]>` which propagates given gradients.
+  vector<Node> terms;
+  for (std::uint32_t i = 0; i < num_states_; ++i) {
+    const auto seed_ph = placeholder(
+        init[i].shape(), init[i].device(), false);
+    seeds_.emplace_back(seed_ph.first);
+    terms.emplace_back(functions::batch::sum(functions::sum(
+            functions::flatten(outputs_[i] * seed_ph.second), 0)));
+  }
+  loss_ = functions::sum(terms);
+
+  // Placeholders are trainable to propagate gradients through steps. Scan
+  // itself has trainable values only if the step function uses others (e.g.,
+  // parameters), and arguments requiring gradients are handled by the graph.
+  vector<Node> excluded = state_nodes;
+  excluded.emplace_back(input_ph.second);
+  trainable_ = graph_->depends_on_trainable_values(loss_, excluded);
+}
+
+/*
+ * Updating operator states.
+ */
+
+void Input::reset_data(const vector<float> &data) {
+  if (data.size() != shape_.size()) {
     PRIMITIV_THROW_ERROR(
         "Data sizes mismatched."
         << " operator: Input"
         << ", required: " << shape_.size() << " (" << shape_.to_string() << ")"
-        << ", actual: " << data_.size());
+        << ", actual: " << data.size());
   }
+  data_ = data;
+}
+
+void Placeholder::set_value(const Tensor &value) {
+  if (value.shape() != shape_ || &value.device() != &device_) {
+    PRIMITIV_THROW_ERROR(
+        "Value mismatched. required: " << shape_.to_string()
+        << " on " << &device_ << ", actual: " << value.shape().to_string()
+        << " on " << &value.device());
+  }
+  value_ = value;
 }
 
 /*
@@ -51,6 +165,8 @@ Input::Input(const Shape &shape, const vector<float> &data, Device &device)
 
 IMPL_NAME_0(Input);
 IMPL_NAME_0(Parameter);
+IMPL_NAME_0(Detached);
+IMPL_NAME_0(Placeholder);
 IMPL_NAME_0(Copy);
 IMPL_NAME_1(Constant, k_);
 IMPL_NAME_1(Identity, size_);
@@ -129,6 +245,9 @@ IMPL_NAME_0(LReLU);
 
 IMPL_NAME_0(BatchSum);
 
+IMPL_NAME_1(Scan, dim_);
+IMPL_NAME_1(FusedElementwise, program_.size());
+
 std::string Convolution2D::name() const {
   return "Convolution2D("
     + string_utils::to_string(padding0_) + ','
@@ -153,6 +272,517 @@ std::string MaxPooling2D::name() const {
 #undef IMPL_NAME_1
 #undef IMPL_NAME_2
 
+/*
+ * Operator signatures.
+ */
+
+namespace {
+
+// Appends the binary representation of the attribute.
+template<typename T>
+void append_attribute(std::string &sig, const T &value) {
+  sig.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void append_attribute(std::string &sig, const Shape &value) {
+  sig += value.to_string();
+  sig += '\0';
+}
+
+void append_attribute(std::string &sig, const vector<std::uint32_t> &value) {
+  append_attribute(sig, static_cast<std::uint32_t>(value.size()));
+  for (const std::uint32_t x : value) append_attribute(sig, x);
+}
+
+void append_attributes(std::string &) {}
+
+template<typename T, typename... Args>
+void append_attributes(std::string &sig, const T &value, const Args &...args) {
+  append_attribute(sig, value);
+  append_attributes(sig, args...);
+}
+
+template<typename... Args>
+std::string make_signature(const char *name, const Args &...args) {
+  std::string sig(name);
+  sig += '\0';
+  append_attributes(sig, args...);
+  return sig;
+}
+
+}  // namespace
+
+#define IMPL_NO_SIGNATURE(cls) \
+  std::string cls::signature() const { return std::string(); }
+#define IMPL_SIGNATURE_0(cls) \
+  std::string cls::signature() const { return make_signature(#cls); }
+#define IMPL_SIGNATURE(cls, ...) \
+  std::string cls::signature() const { \
+    return make_signature(#cls, __VA_ARGS__); \
+  }
+
+IMPL_NO_SIGNATURE(Input);
+IMPL_SIGNATURE(Parameter, param_);
+IMPL_NO_SIGNATURE(Detached);
+IMPL_NO_SIGNATURE(Placeholder);
+IMPL_SIGNATURE_0(Copy);
+IMPL_SIGNATURE(Constant, shape_, k_);
+IMPL_SIGNATURE(Identity, size_);
+IMPL_NO_SIGNATURE(RandomBernoulli);
+IMPL_NO_SIGNATURE(RandomUniform);
+IMPL_NO_SIGNATURE(RandomNormal);
+IMPL_NO_SIGNATURE(RandomLogNormal);
+IMPL_SIGNATURE(Pick, ids_, dim_);
+IMPL_SIGNATURE(Slice, dim_, lower_, upper_);
+IMPL_SIGNATURE(Split, dim_, n_);
+IMPL_SIGNATURE(Concat, dim_);
+IMPL_SIGNATURE(Reshape, shape_);
+IMPL_SIGNATURE(Sum, dim_);
+IMPL_SIGNATURE(LogSumExp, dim_);
+IMPL_SIGNATURE(Broadcast, dim_, size_);
+IMPL_SIGNATURE(SoftmaxCrossEntropy, dim_);
+IMPL_SIGNATURE(SparseSoftmaxCrossEntropy, ids_, dim_);
+IMPL_SIGNATURE_0(StopGradient);
+IMPL_SIGNATURE_0(Flatten);
+IMPL_SIGNATURE_0(Positive);
+IMPL_SIGNATURE_0(Negative);
+
+IMPL_SIGNATURE(AddConst, k_);
+IMPL_SIGNATURE(SubtractConstR, k_);
+IMPL_SIGNATURE(SubtractConstL, k_);
+IMPL_SIGNATURE(MultiplyConst, k_);
+IMPL_SIGNATURE(DivideConstR, k_);
+IMPL_SIGNATURE(DivideConstL, k_);
+IMPL_SIGNATURE(PowConstR, k_);
+IMPL_SIGNATURE(PowConstL, k_);
+IMPL_SIGNATURE(PReLU, k_);
+IMPL_SIGNATURE(ELU, k_);
+
+IMPL_SIGNATURE(PowN, k_);
+
+IMPL_SIGNATURE_0(AddScalar);
+IMPL_SIGNATURE_0(SubtractScalarR);
+IMPL_SIGNATURE_0(SubtractScalarL);
+IMPL_SIGNATURE_0(MultiplyScalar);
+IMPL_SIGNATURE_0(DivideScalarR);
+IMPL_SIGNATURE_0(DivideScalarL);
+IMPL_SIGNATURE_0(PowScalarR);
+IMPL_SIGNATURE_0(PowScalarL);
+
+IMPL_SIGNATURE_0(Add);
+IMPL_SIGNATURE_0(Subtract);
+IMPL_SIGNATURE_0(Multiply);
+IMPL_SIGNATURE_0(Divide);
+IMPL_SIGNATURE_0(Pow);
+
+IMPL_SIGNATURE_0(Transpose);
+IMPL_SIGNATURE_0(MatrixMultiply);
+
+IMPL_SIGNATURE_0(Sqrt);
+IMPL_SIGNATURE_0(Exp);
+IMPL_SIGNATURE_0(Log);
+IMPL_SIGNATURE_0(Tanh);
+IMPL_SIGNATURE_0(Sigmoid);
+IMPL_SIGNATURE_0(Softplus);
+IMPL_SIGNATURE_0(Sin);
+IMPL_SIGNATURE_0(Cos);
+IMPL_SIGNATURE_0(Tan);
+IMPL_SIGNATURE_0(ReLU);
+IMPL_SIGNATURE_0(LReLU);
+
+IMPL_SIGNATURE_0(BatchSum);
+
+IMPL_SIGNATURE(
+    Convolution2D,
+    padding0_, padding1_, stride0_, stride1_, dilation0_, dilation1_);
+IMPL_SIGNATURE(
+    MaxPooling2D,
+    window0_, window1_, padding0_, padding1_, stride0_, stride1_);
+
+// Scan has no signature because its step function is opaque and can not be
+// compared with others.
+IMPL_NO_SIGNATURE(Scan);
+
+// Fused operators are made only by the graph and never shared.
+IMPL_NO_SIGNATURE(FusedElementwise);
+
+#undef IMPL_NO_SIGNATURE
+#undef IMPL_SIGNATURE_0
+#undef IMPL_SIGNATURE
+
+/*
+ * Operator serialization.
+ */
+
+namespace {
+
+// Writes the attribute.
+template<typename T>
+void write_attribute(msgpack::Writer &writer, const T &value) {
+  writer << value;
+}
+
+void write_attribute(msgpack::Writer &writer, const Shape &value) {
+  writer << value.dims() << value.batch();
+}
+
+void write_attributes(msgpack::Writer &) {}
+
+template<typename T, typename... Args>
+void write_attributes(
+    msgpack::Writer &writer, const T &value, const Args &...args) {
+  write_attribute(writer, value);
+  write_attributes(writer, args...);
+}
+
+// Reads the attribute.
+template<typename T>
+T read_attribute(msgpack::Reader &reader) {
+  T value;
+  reader >> value;
+  return value;
+}
+
+template<>
+Shape read_attribute<Shape>(msgpack::Reader &reader) {
+  vector<std::uint32_t> dims;
+  std::uint32_t batch;
+  reader >> dims >> batch;
+  return Shape(dims, batch);
+}
+
+}  // namespace
+
+#define IMPL_NO_SAVE(cls) \
+  void cls::save(msgpack::Writer &writer) const { \
+    UNUSED(writer); \
+    PRIMITIV_THROW_ERROR( \
+        "Operator `" << name() << "` does not support serialization."); \
+  }
+#define IMPL_SAVE_0(cls) \
+  void cls::save(msgpack::Writer &writer) const { writer << #cls; }
+#define IMPL_SAVE(cls, ...) \
+  void cls::save(msgpack::Writer &writer) const { \
+    writer << #cls; \
+    write_attributes(writer, __VA_ARGS__); \
+  }
+
+IMPL_SAVE(Input, shape_, data_);
+// Parameters are written as their keys in the model by `Graph::save_plan()`.
+IMPL_NO_SAVE(Parameter);
+IMPL_NO_SAVE(Detached);
+IMPL_NO_SAVE(Placeholder);
+IMPL_SAVE_0(Copy);
+IMPL_SAVE(Constant, shape_, k_);
+IMPL_SAVE(Identity, size_);
+IMPL_SAVE(RandomBernoulli, shape_, p_);
+IMPL_SAVE(RandomUniform, shape_, lower_, upper_);
+IMPL_SAVE(RandomNormal, shape_, mean_, sd_);
+IMPL_SAVE(RandomLogNormal, shape_, mu_, beta_);
+IMPL_SAVE(Pick, ids_, dim_);
+IMPL_SAVE(Slice, dim_, lower_, upper_);
+IMPL_SAVE(Split, dim_, n_);
+IMPL_SAVE(Concat, dim_);
+IMPL_SAVE(Reshape, shape_);
+IMPL_SAVE(Sum, dim_);
+IMPL_SAVE(LogSumExp, dim_);
+IMPL_SAVE(Broadcast, dim_, size_);
+IMPL_SAVE(SoftmaxCrossEntropy, dim_);
+IMPL_SAVE(SparseSoftmaxCrossEntropy, ids_, dim_);
+IMPL_SAVE_0(StopGradient);
+IMPL_SAVE_0(Flatten);
+IMPL_SAVE_0(Positive);
+IMPL_SAVE_0(Negative);
+
+IMPL_SAVE(AddConst, k_);
+IMPL_SAVE(SubtractConstR, k_);
+IMPL_SAVE(SubtractConstL, k_);
+IMPL_SAVE(MultiplyConst, k_);
+IMPL_SAVE(DivideConstR, k_);
+IMPL_SAVE(DivideConstL, k_);
+IMPL_SAVE(PowConstR, k_);
+IMPL_SAVE(PowConstL, k_);
+IMPL_SAVE(PReLU, k_);
+IMPL_SAVE(ELU, k_);
+
+IMPL_SAVE(PowN, k_);
+
+IMPL_SAVE_0(AddScalar);
+IMPL_SAVE_0(SubtractScalarR);
+IMPL_SAVE_0(SubtractScalarL);
+IMPL_SAVE_0(MultiplyScalar);
+IMPL_SAVE_0(DivideScalarR);
+IMPL_SAVE_0(DivideScalarL);
+IMPL_SAVE_0(PowScalarR);
+IMPL_SAVE_0(PowScalarL);
+
+IMPL_SAVE_0(Add);
+IMPL_SAVE_0(Subtract);
+IMPL_SAVE_0(Multiply);
+IMPL_SAVE_0(Divide);
+IMPL_SAVE_0(Pow);
+
+IMPL_SAVE_0(Transpose);
+IMPL_SAVE_0(MatrixMultiply);
+
+IMPL_SAVE_0(Sqrt);
+IMPL_SAVE_0(Exp);
+IMPL_SAVE_0(Log);
+IMPL_SAVE_0(Tanh);
+IMPL_SAVE_0(Sigmoid);
+IMPL_SAVE_0(Softplus);
+IMPL_SAVE_0(Sin);
+IMPL_SAVE_0(Cos);
+IMPL_SAVE_0(Tan);
+IMPL_SAVE_0(ReLU);
+IMPL_SAVE_0(LReLU);
+
+IMPL_SAVE_0(BatchSum);
+
+IMPL_SAVE(
+    Convolution2D,
+    padding0_, padding1_, stride0_, stride1_, dilation0_, dilation1_);
+IMPL_SAVE(
+    MaxPooling2D,
+    window0_, window1_, padding0_, padding1_, stride0_, stride1_);
+
+// The step function of Scan can not be serialized, and fused operators are
+// made only by the graph while capturing plans.
+IMPL_NO_SAVE(Scan);
+IMPL_NO_SAVE(FusedElementwise);
+
+#undef IMPL_NO_SAVE
+#undef IMPL_SAVE_0
+#undef IMPL_SAVE
+
+namespace {
+
+using Loader = std::function<Operator *(msgpack::Reader &, Device &)>;
+
+// Attributes are read into local variables in the same order as `save()`,
+// because the evaluation order of function arguments is unspecified.
+#define LOADER_0(cls) \
+  { #cls, [](msgpack::Reader &, Device &) -> Operator * { return new cls(); } }
+#define LOADER_K(cls, type) \
+  { #cls, [](msgpack::Reader &reader, Device &) -> Operator * { \
+    const type k = read_attribute<type>(reader); \
+    return new cls(k); \
+  } }
+
+const std::unordered_map<std::string, Loader> &get_loaders() {
+  static const std::unordered_map<std::string, Loader> loaders {
+    { "Input", [](msgpack::Reader &reader, Device &device) -> Operator * {
+      const Shape shape = read_attribute<Shape>(reader);
+      const vector<float> data = read_attribute<vector<float>>(reader);
+      return new Input(shape, data, device);
+    } },
+    { "Copy", [](msgpack::Reader &, Device &device) -> Operator * {
+      return new Copy(device);
+    } },
+    { "Constant", [](msgpack::Reader &reader, Device &device) -> Operator * {
+      const Shape shape = read_attribute<Shape>(reader);
+      const float k = read_attribute<float>(reader);
+      return new Constant(shape, k, device);
+    } },
+    { "Identity", [](msgpack::Reader &reader, Device &device) -> Operator * {
+      const std::uint32_t size = read_attribute<std::uint32_t>(reader);
+      return new Identity(size, device);
+    } },
+    { "RandomBernoulli",
+      [](msgpack::Reader &reader, Device &device) -> Operator * {
+      const Shape shape = read_attribute<Shape>(reader);
+      const float p = read_attribute<float>(reader);
+      return new RandomBernoulli(shape, p, device);
+    } },
+    { "RandomUniform",
+      [](msgpack::Reader &reader, Device &device) -> Operator * {
+      const Shape shape = read_attribute<Shape>(reader);
+      const float lower = read_attribute<float>(reader);
+      const float upper = read_attribute<float>(reader);
+      return new RandomUniform(shape, lower, upper, device);
+    } },
+    { "RandomNormal",
+      [](msgpack::Reader &reader, Device &device) -> Operator * {
+      const Shape shape = read_attribute<Shape>(reader);
+      const float mean = read_attribute<float>(reader);
+      const float sd = read_attribute<float>(reader);
+      return new RandomNormal(shape, mean, sd, device);
+    } },
+    { "RandomLogNormal",
+      [](msgpack::Reader &reader, Device &device) -> Operator * {
+      const Shape shape = read_attribute<Shape>(reader);
+      const float mu = read_attribute<float>(reader);
+      const float beta = read_attribute<float>(reader);
+      return new RandomLogNormal(shape, mu, beta, device);
+    } },
+    { "Pick", [](msgpack::Reader &reader, Device &) -> Operator * {
+      const auto ids = read_attribute<vector<std::uint32_t>>(reader);
+      const std::uint32_t dim = read_attribute<std::uint32_t>(reader);
+      return new Pick(ids, dim);
+    } },
+    { "Slice", [](msgpack::Reader &reader, Device &) -> Operator * {
+      const std::uint32_t dim = read_attribute<std::uint32_t>(reader);
+      const std::uint32_t lower = read_attribute<std::uint32_t>(reader);
+      const std::uint32_t upper = read_attribute<std::uint32_t>(reader);
+      return new Slice(dim, lower, upper);
+    } },
+    { "Split", [](msgpack::Reader &reader, Device &) -> Operator * {
+      const std::uint32_t dim = read_attribute<std::uint32_t>(reader);
+      const std::uint32_t n = read_attribute<std::uint32_t>(reader);
+      return new Split(dim, n);
+    } },
+    LOADER_K(Concat, std::uint32_t),
+    LOADER_K(Reshape, Shape),
+    LOADER_K(Sum, std::uint32_t),
+    LOADER_K(LogSumExp, std::uint32_t),
+    { "Broadcast", [](msgpack::Reader &reader, Device &) -> Operator * {
+      const std::uint32_t dim = read_attribute<std::uint32_t>(reader);
+      const std::uint32_t size = read_attribute<std::uint32_t>(reader);
+      return new Broadcast(dim, size);
+    } },
+    LOADER_K(SoftmaxCrossEntropy, std::uint32_t),
+    { "SparseSoftmaxCrossEntropy",
+      [](msgpack::Reader &reader, Device &) -> Operator * {
+      const auto ids = read_attribute<vector<std::uint32_t>>(reader);
+      const std::uint32_t dim = read_attribute<std::uint32_t>(reader);
+      return new SparseSoftmaxCrossEntropy(ids, dim);
+    } },
+    LOADER_0(StopGradient),
+    LOADER_0(Flatten),
+    LOADER_0(Positive),
+    LOADER_0(Negative),
+
+    LOADER_K(AddConst, float),
+    LOADER_K(SubtractConstR, float),
+    LOADER_K(SubtractConstL, float),
+    LOADER_K(MultiplyConst, float),
+    LOADER_K(DivideConstR, float),
+    LOADER_K(DivideConstL, float),
+    LOADER_K(PowConstR, float),
+    LOADER_K(PowConstL, float),
+    LOADER_K(PReLU, float),
+    LOADER_K(ELU, float),
+
+    LOADER_K(PowN, std::int32_t),
+
+    LOADER_0(AddScalar),
+    LOADER_0(SubtractScalarR),
+    LOADER_0(SubtractScalarL),
+    LOADER_0(MultiplyScalar),
+    LOADER_0(DivideScalarR),
+    LOADER_0(DivideScalarL),
+    LOADER_0(PowScalarR),
+    LOADER_0(PowScalarL),
+
+    LOADER_0(Add),
+    LOADER_0(Subtract),
+    LOADER_0(Multiply),
+    LOADER_0(Divide),
+    LOADER_0(Pow),
+
+    LOADER_0(Transpose),
+    LOADER_0(MatrixMultiply),
+
+    LOADER_0(Sqrt),
+    LOADER_0(Exp),
+    LOADER_0(Log),
+    LOADER_0(Tanh),
+    LOADER_0(Sigmoid),
+    LOADER_0(Softplus),
+    LOADER_0(Sin),
+    LOADER_0(Cos),
+    LOADER_0(Tan),
+    LOADER_0(ReLU),
+    LOADER_0(LReLU),
+
+    LOADER_0(BatchSum),
+
+    { "Convolution2D", [](msgpack::Reader &reader, Device &) -> Operator * {
+      std::uint32_t attrs[6];
+      for (std::uint32_t &x : attrs) reader >> x;
+      return new Convolution2D(
+          attrs[0], attrs[1], attrs[2], attrs[3], attrs[4], attrs[5]);
+    } },
+    { "MaxPooling2D", [](msgpack::Reader &reader, Device &) -> Operator * {
+      std::uint32_t attrs[6];
+      for (std::uint32_t &x : attrs) reader >> x;
+      return new MaxPooling2D(
+          attrs[0], attrs[1], attrs[2], attrs[3], attrs[4], attrs[5]);
+    } },
+  };
+  return loaders;
+}
+
+#undef LOADER_0
+#undef LOADER_K
+
+}  // namespace
+
+std::unique_ptr<Operator> load_operator(
+    const std::string &type, msgpack::Reader &reader, Device &device) {
+  const auto &loaders = get_loaders();
+  const auto it = loaders.find(type);
+  if (it == loaders.end()) {
+    PRIMITIV_THROW_ERROR("Unknown operator type: " << type);
+  }
+  return std::unique_ptr<Operator>(it->second(reader, device));
+}
+
+/*
+ * Instructions of fused elementwise operations.
+ */
+
+#define IMPL_INSTRUCTION(cls, opcode, a, b, k) \
+  bool cls::get_elementwise_instruction(ElementwiseInstruction &inst) const { \
+    inst = ElementwiseInstruction { ElementwiseOpcode::opcode, a, b, k }; \
+    return true; \
+  }
+
+IMPL_INSTRUCTION(Negative, NEGATE, 0, 0, 0);
+
+IMPL_INSTRUCTION(AddConst, ADD_CONST, 0, 0, k_);
+IMPL_INSTRUCTION(SubtractConstR, SUBTRACT_CONST_R, 0, 0, k_);
+IMPL_INSTRUCTION(SubtractConstL, SUBTRACT_CONST_L, 0, 0, k_);
+IMPL_INSTRUCTION(MultiplyConst, MULTIPLY_CONST, 0, 0, k_);
+IMPL_INSTRUCTION(DivideConstR, DIVIDE_CONST_R, 0, 0, k_);
+IMPL_INSTRUCTION(DivideConstL, DIVIDE_CONST_L, 0, 0, k_);
+IMPL_INSTRUCTION(PowConstR, POW_CONST_R, 0, 0, k_);
+IMPL_INSTRUCTION(PowConstL, POW_CONST_L, 0, 0, k_);
+IMPL_INSTRUCTION(PReLU, PRELU, 0, 0, k_);
+IMPL_INSTRUCTION(ELU, ELU, 0, 0, k_);
+
+IMPL_INSTRUCTION(PowN, POWN, 0, 0, static_cast<float>(k_));
+
+// Scalar operators take scalars as the second arguments.
+IMPL_INSTRUCTION(AddScalar, ADD, 0, 1, 0);
+IMPL_INSTRUCTION(SubtractScalarR, SUBTRACT, 0, 1, 0);
+IMPL_INSTRUCTION(SubtractScalarL, SUBTRACT, 1, 0, 0);
+IMPL_INSTRUCTION(MultiplyScalar, MULTIPLY, 0, 1, 0);
+IMPL_INSTRUCTION(DivideScalarR, DIVIDE, 0, 1, 0);
+IMPL_INSTRUCTION(DivideScalarL, DIVIDE, 1, 0, 0);
+IMPL_INSTRUCTION(PowScalarR, POW, 0, 1, 0);
+IMPL_INSTRUCTION(PowScalarL, POW, 1, 0, 0);
+
+IMPL_INSTRUCTION(Add, ADD, 0, 1, 0);
+IMPL_INSTRUCTION(Subtract, SUBTRACT, 0, 1, 0);
+IMPL_INSTRUCTION(Multiply, MULTIPLY, 0, 1, 0);
+IMPL_INSTRUCTION(Divide, DIVIDE, 0, 1, 0);
+IMPL_INSTRUCTION(Pow, POW, 0, 1, 0);
+
+IMPL_INSTRUCTION(Sqrt, SQRT, 0, 0, 0);
+IMPL_INSTRUCTION(Exp, EXP, 0, 0, 0);
+IMPL_INSTRUCTION(Log, LOG, 0, 0, 0);
+IMPL_INSTRUCTION(Tanh, TANH, 0, 0, 0);
+IMPL_INSTRUCTION(Sigmoid, SIGMOID, 0, 0, 0);
+IMPL_INSTRUCTION(Softplus, SOFTPLUS, 0, 0, 0);
+IMPL_INSTRUCTION(Sin, SIN, 0, 0, 0);
+IMPL_INSTRUCTION(Cos, COS, 0, 0, 0);
+IMPL_INSTRUCTION(Tan, TAN, 0, 0, 0);
+IMPL_INSTRUCTION(ReLU, PRELU, 0, 0, 0);
+IMPL_INSTRUCTION(LReLU, PRELU, 0, 0, .01);
+
+#undef IMPL_INSTRUCTION
+
 /*
  * Shape forwarding operations.
  */
@@ -172,7 +802,9 @@ std::string MaxPooling2D::name() const {
   FWD_SHAPE(name) { *y[0] = shape_ops::elementwise(*x[0], *x[1]); }
 
 FWD_SHAPE(Input) { UNUSED(x); *y[0] = shape_; }
-FWD_SHAPE(Parameter) { UNUSED(x); *y[0] = param_.shape(); }
+FWD_SHAPE(Parameter) { UNUSED(x); *y[0] = param_->shape(); }
+FWD_SHAPE(Detached) { UNUSED(x); *y[0] = value_.shape(); }
+FWD_SHAPE(Placeholder) { UNUSED(x); *y[0] = shape_; }
 FWD_SHAPE(Copy) { *y[0] = *x[0]; }
 FWD_SHAPE(Constant) { UNUSED(x); *y[0] = shape_; }
 FWD_SHAPE(Identity) { UNUSED(x); *y[0] = Shape({size_, size_}); }
@@ -262,6 +894,26 @@ FWD_SHAPE(SparseSoftmaxCrossEntropy) {
   *y[0] = shape_ops::pick(*x[0], ids_, dim_);
 }
 FWD_SHAPE_UNARY(StopGradient);
+FWD_SHAPE(Scan) {
+  const Shape &sx = *x[num_states_];
+  bool ok = dim_ < Shape::MAX_DEPTH && sx.resize_dim(dim_, 1) == input_shape_;
+  for (std::uint32_t i = 0; i < num_states_; ++i) {
+    ok = ok && *x[i] == state_shapes_[i];
+  }
+  if (!ok) {
+    PRIMITIV_THROW_ERROR(
+        "Shape mismatched at Scan. dim: " << dim_
+        << ", sequence: " << sx.to_string()
+        << ", required step input: " << input_shape_.to_string());
+  }
+  for (std::uint32_t i = 0; i < num_states_; ++i) {
+    *y[i] = state_shapes_[i];
+  }
+  // Results of the first state at all steps are concatenated.
+  const Shape &s0 = state_shapes_[0];
+  *y[num_states_] = s0.resize_dim(dim_, sx[dim_] * s0[dim_]);
+}
+FWD_SHAPE(FusedElementwise) { UNUSED(x); *y[0] = shape_; }
 
 #undef FWD_SHAPE_UNARY
 #undef FWD_SHAPE_SCALAR
@@ -273,7 +925,15 @@ FWD_SHAPE_UNARY(StopGradient);
  */
 
 vector<const Tensor *> Parameter::get_inner_values() const {
-  return std::vector<const Tensor *> { &param_.value() };
+  return std::vector<const Tensor *> { &param_->value() };
+}
+
+vector<const Tensor *> Detached::get_inner_values() const {
+  return std::vector<const Tensor *> { &value_ };
+}
+
+vector<const Tensor *> Placeholder::get_inner_values() const {
+  return std::vector<const Tensor *> { &value_ };
 }
 
 /*
@@ -285,6 +945,14 @@ vector<const Tensor *> Parameter::get_inner_values() const {
       const vector<const Tensor *> &x, \
       const vector<Tensor *> &y) const
 
+// Writes the result into `y[0]` if it is already valid.
+#define FORWARD_BUFFERED(name, fw, ...) \
+  FORWARD(name) { \
+    Device &dev = x[0]->device(); \
+    if (y[0]->valid()) dev.fw(__VA_ARGS__, *y[0]); \
+    else *y[0] = dev.fw(__VA_ARGS__); \
+  }
+
 FORWARD(Input) {
   UNUSED(x);
   *y[0] = functions::input<Tensor>(shape_, data_, device_);
@@ -334,49 +1002,49 @@ FORWARD(Reshape) { *y[0] = functions::reshape(*x[0], shape_); }
 FORWARD(Flatten) { *y[0] = functions::flatten(*x[0]); }
 
 FORWARD(Positive) { *y[0] = *x[0]; }
-FORWARD(Negative) { *y[0] = -(*x[0]); }
-FORWARD(Sqrt) { *y[0] = functions::sqrt(*x[0]); }
-FORWARD(Exp) { *y[0] = functions::exp(*x[0]); }
-FORWARD(Log) { *y[0] = functions::log(*x[0]); }
-FORWARD(Tanh) { *y[0] = functions::tanh(*x[0]); }
-FORWARD(Sigmoid) { *y[0] = functions::sigmoid(*x[0]); }
-FORWARD(Softplus) { *y[0] = functions::softplus(*x[0]); }
-FORWARD(Sin) { *y[0] = functions::sin(*x[0]); }
-FORWARD(Cos) { *y[0] = functions::cos(*x[0]); }
-FORWARD(Tan) { *y[0] = functions::tan(*x[0]); }
-FORWARD(ReLU) { *y[0] = functions::relu(*x[0]); }
-FORWARD(LReLU) { *y[0] = functions::lrelu(*x[0]); }
-
-FORWARD(AddConst) { *y[0] = *x[0] + k_; }
-FORWARD(SubtractConstR) { *y[0] = *x[0] - k_; }
-FORWARD(SubtractConstL) { *y[0] = k_ - *x[0]; }
-FORWARD(MultiplyConst) { *y[0] = *x[0] * k_; }
-FORWARD(DivideConstR) { *y[0] = *x[0] / k_; }
-FORWARD(DivideConstL) { *y[0] = k_ / *x[0]; }
-FORWARD(PowConstR) { *y[0] = functions::pow(*x[0], k_); }
-FORWARD(PowConstL) { *y[0] = functions::pow(k_, *x[0]); }
-FORWARD(PReLU) { *y[0] = functions::prelu(*x[0], k_); }
-FORWARD(ELU) { *y[0] = functions::elu(*x[0], k_); }
-
-FORWARD(PowN) { *y[0] = functions::pown(*x[0], k_); }
-
-FORWARD(AddScalar) { *y[0] = *x[0] + *x[1]; }
-FORWARD(SubtractScalarR) { *y[0] = *x[0] - *x[1]; }
-FORWARD(SubtractScalarL) { *y[0] = *x[1] - *x[0]; }
-FORWARD(MultiplyScalar) { *y[0] = *x[0] * *x[1]; }
-FORWARD(DivideScalarR) { *y[0] = *x[0] / *x[1]; }
-FORWARD(DivideScalarL) { *y[0] = *x[1] / *x[0]; }
-FORWARD(PowScalarR) { *y[0] = functions::pow(*x[0], *x[1]); }
-FORWARD(PowScalarL) { *y[0] = functions::pow(*x[1], *x[0]); }
-
-FORWARD(Add) { *y[0] = *x[0] + *x[1]; }
-FORWARD(Subtract) { *y[0] = *x[0] - *x[1]; }
-FORWARD(Multiply) { *y[0] = *x[0] * *x[1]; }
-FORWARD(Divide) { *y[0] = *x[0] / *x[1]; }
-FORWARD(Pow) { *y[0] = functions::pow(*x[0], *x[1]); }
-
-FORWARD(Transpose) { *y[0] = functions::transpose(*x[0]); }
-FORWARD(MatrixMultiply) { *y[0] = functions::matmul(*x[0], *x[1]); }
+FORWARD_BUFFERED(Negative, negate_fw, *x[0]);
+FORWARD_BUFFERED(Sqrt, sqrt_fw, *x[0]);
+FORWARD_BUFFERED(Exp, exp_fw, *x[0]);
+FORWARD_BUFFERED(Log, log_fw, *x[0]);
+FORWARD_BUFFERED(Tanh, tanh_fw, *x[0]);
+FORWARD_BUFFERED(Sigmoid, sigmoid_fw, *x[0]);
+FORWARD_BUFFERED(Softplus, softplus_fw, *x[0]);
+FORWARD_BUFFERED(Sin, sin_fw, *x[0]);
+FORWARD_BUFFERED(Cos, cos_fw, *x[0]);
+FORWARD_BUFFERED(Tan, tan_fw, *x[0]);
+FORWARD_BUFFERED(ReLU, prelu_fw, *x[0], 0);
+FORWARD_BUFFERED(LReLU, prelu_fw, *x[0], .01);
+
+FORWARD_BUFFERED(AddConst, add_const_fw, *x[0], k_);
+FORWARD_BUFFERED(SubtractConstR, subtract_const_r_fw, *x[0], k_);
+FORWARD_BUFFERED(SubtractConstL, subtract_const_l_fw, *x[0], k_);
+FORWARD_BUFFERED(MultiplyConst, multiply_const_fw, *x[0], k_);
+FORWARD_BUFFERED(DivideConstR, divide_const_r_fw, *x[0], k_);
+FORWARD_BUFFERED(DivideConstL, divide_const_l_fw, *x[0], k_);
+FORWARD_BUFFERED(PowConstR, pow_const_r_fw, *x[0], k_);
+FORWARD_BUFFERED(PowConstL, pow_const_l_fw, *x[0], k_);
+FORWARD_BUFFERED(PReLU, prelu_fw, *x[0], k_);
+FORWARD_BUFFERED(ELU, elu_fw, *x[0], k_);
+
+FORWARD_BUFFERED(PowN, pown_fw, *x[0], k_);
+
+FORWARD_BUFFERED(AddScalar, add_scalar_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(SubtractScalarR, subtract_scalar_r_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(SubtractScalarL, subtract_scalar_l_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(MultiplyScalar, multiply_scalar_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(DivideScalarR, divide_scalar_r_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(DivideScalarL, divide_scalar_l_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(PowScalarR, pow_scalar_r_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(PowScalarL, pow_scalar_l_fw, *x[0], *x[1]);
+
+FORWARD_BUFFERED(Add, add_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(Subtract, subtract_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(Multiply, multiply_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(Divide, divide_fw, *x[0], *x[1]);
+FORWARD_BUFFERED(Pow, pow_fw, *x[0], *x[1]);
+
+FORWARD_BUFFERED(Transpose, transpose_fw, *x[0]);
+FORWARD_BUFFERED(MatrixMultiply, matmul_fw, *x[0], *x[1]);
 
 FORWARD(Sum) { *y[0] = functions::sum(*x[0], dim_); }
 FORWARD(LogSumExp) { *y[0] = functions::logsumexp(*x[0], dim_); }
@@ -409,12 +1077,89 @@ FORWARD(SparseSoftmaxCrossEntropy) {
 
 FORWARD(StopGradient) { *y[0] = *x[0]; }
 
+FORWARD(Scan) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::uint32_t n = x[num_states_]->shape()[dim_];
+  vector<Tensor> cur(num_states_);
+  for (std::uint32_t i = 0; i < num_states_; ++i) cur[i] = *x[i];
+  vector<Tensor> seq;
+  seq.reserve(n);
+
+  // States of all steps are kept for the backward operation.
+  history_.clear();
+  history_.reserve(n);
+  graph_->capture(outputs_);
+  for (std::uint32_t t = 0; t < n; ++t) {
+    for (std::uint32_t i = 0; i < num_states_; ++i) {
+      states_[i]->set_value(cur[i]);
+    }
+    input_->set_value(functions::slice(*x[num_states_], dim_, t, t + 1));
+    // The plan is empty if the step function returns placeholders.
+    if (graph_->plan_size() > 0) graph_->replay();
+    history_.emplace_back(std::move(cur));
+    const vector<const Tensor *> values = graph_->forward(outputs_);
+    cur.resize(num_states_);
+    for (std::uint32_t i = 0; i < num_states_; ++i) cur[i] = *values[i];
+    seq.emplace_back(cur[0]);
+  }
+
+  for (std::uint32_t i = 0; i < num_states_; ++i) *y[i] = std::move(cur[i]);
+  *y[num_states_] = functions::concat(seq, dim_);
+}
+
+FORWARD(FusedElementwise) {
+  Device &dev = x[0]->device();
+  if (y[0]->valid()) dev.fused_elementwise_fw(x, program_, *y[0]);
+  else *y[0] = dev.fused_elementwise_fw(x, program_, shape_);
+}
+
+#undef FORWARD_BUFFERED
 #undef FORWARD
 
 /*
  * Backward operations.
  */
 
+namespace {
+
+// Invalid gradients of arguments represent zeros. These helpers write the
+// first contribution directly instead of accumulating it into zeros.
+
+// gx += a
+void accumulate(const Tensor &x, const Tensor &a, Tensor &gx) {
+  if (gx.valid()) {
+    gx += a;
+  } else if (a.shape() == x.shape() && &a.device() == &x.device()) {
+    // The memory is shared until either of them is updated.
+    gx = a;
+  } else {
+    gx = functions::zeros<Tensor>(x.shape(), x.device());
+    gx += a;
+  }
+}
+
+// gx -= a
+void accumulate_negative(const Tensor &x, const Tensor &a, Tensor &gx) {
+  if (gx.valid()) {
+    gx -= a;
+  } else if (a.shape() == x.shape() && &a.device() == &x.device()) {
+    gx = -a;
+  } else {
+    gx = functions::zeros<Tensor>(x.shape(), x.device());
+    gx -= a;
+  }
+}
+
+// Makes the gradient valid before device functions accumulating values.
+Tensor &prepare(const Tensor &x, Tensor &gx) {
+  if (!gx.valid()) {
+    gx = functions::zeros<Tensor>(x.shape(), x.device());
+  }
+  return gx;
+}
+
+}  // namespace
+
 #define BACKWARD(name) \
   void name::backward( \
       const vector<const Tensor *> &x, \
@@ -426,18 +1171,26 @@ FORWARD(StopGradient) { *y[0] = *x[0]; }
   BACKWARD(name) { UNUSED(x); UNUSED(y); UNUSED(gy); UNUSED(gx); }
 
 BACKWARD_NOP(Input);
+BACKWARD_NOP(Detached);
 
 BACKWARD(Parameter) {
   UNUSED(x);
   UNUSED(y);
   UNUSED(gx);
-  param_.gradient() += *gy[0];
+  param_->gradient() += *gy[0];
 }
 
-BACKWARD(Copy) {
+BACKWARD(Placeholder) {
   UNUSED(x);
   UNUSED(y);
-  *gx[0] += functions::copy(*gy[0], gx[0]->device());
+  UNUSED(gx);
+  if (grad_.valid()) grad_ += *gy[0];
+  else grad_ = *gy[0];
+}
+
+BACKWARD(Copy) {
+  UNUSED(y);
+  accumulate(*x[0], functions::copy(*gy[0], x[0]->device()), *gx[0]);
 }
 
 BACKWARD_NOP(Constant);
@@ -448,264 +1201,283 @@ BACKWARD_NOP(RandomNormal);
 BACKWARD_NOP(RandomLogNormal);
 
 BACKWARD(Pick) {
-  UNUSED(x);
   UNUSED(y);
-  gy[0]->device().pick_bw(*gy[0], ids_, dim_, *gx[0]);
+  gy[0]->device().pick_bw(*gy[0], ids_, dim_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Slice) {
-  UNUSED(x);
   UNUSED(y);
-  gy[0]->device().slice_bw(*gy[0], dim_, lower_, *gx[0]);
+  gy[0]->device().slice_bw(*gy[0], dim_, lower_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Split) {
-  UNUSED(x);
   UNUSED(y);
   Device &dev = gy[0]->device();
   const std::uint32_t span = gy[0]->shape()[dim_];
+  Tensor &gx0 = prepare(*x[0], *gx[0]);
   for (std::uint32_t i = 0; i < n_; ++i) {
-    dev.slice_bw(*gy[i], dim_, i * span, *gx[0]);
+    dev.slice_bw(*gy[i], dim_, i * span, gx0);
   }
 }
 
 BACKWARD(Concat) {
-  UNUSED(x);
   UNUSED(y);
   std::uint32_t offset = 0;
-  for (Tensor *gxi : gx) {
-    const std::uint32_t span = gxi->shape()[dim_];
-    *gxi += functions::slice(*gy[0], dim_, offset, offset + span);
+  for (std::uint32_t i = 0; i < gx.size(); ++i) {
+    const std::uint32_t span = x[i]->shape()[dim_];
+    accumulate(
+        *x[i], functions::slice(*gy[0], dim_, offset, offset + span), *gx[i]);
     offset += span;
   }
 }
 
 BACKWARD(Reshape) {
   UNUSED(y);
-  *gx[0] += gy[0]->reshape(x[0]->shape());
+  accumulate(*x[0], gy[0]->reshape(x[0]->shape()), *gx[0]);
 }
 
 BACKWARD(Flatten) {
   UNUSED(y);
-  *gx[0] += gy[0]->reshape(x[0]->shape());
+  accumulate(*x[0], gy[0]->reshape(x[0]->shape()), *gx[0]);
 }
 
 BACKWARD(Positive) {
-  UNUSED(x);
   UNUSED(y);
-  *gx[0] += *gy[0];
+  accumulate(*x[0], *gy[0], *gx[0]);
 }
 
 BACKWARD(Negative) {
-  UNUSED(x);
   UNUSED(y);
-  *gx[0] -= *gy[0];
+  accumulate_negative(*x[0], *gy[0], *gx[0]);
 }
 
 BACKWARD(Sqrt) {
-  gy[0]->device().sqrt_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().sqrt_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Exp) {
-  gy[0]->device().exp_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().exp_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Log) {
-  gy[0]->device().log_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().log_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Tanh) {
-  gy[0]->device().tanh_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().tanh_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Sigmoid) {
-  gy[0]->device().sigmoid_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().sigmoid_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Softplus) {
-  gy[0]->device().softplus_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().softplus_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Sin) {
-  gy[0]->device().sin_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().sin_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Cos) {
-  gy[0]->device().cos_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().cos_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Tan) {
-  gy[0]->device().tan_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().tan_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(ReLU) {
-  gy[0]->device().prelu_bw(*x[0], *y[0], *gy[0], 0, *gx[0]);
+  gy[0]->device().prelu_bw(*x[0], *y[0], *gy[0], 0, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(LReLU) {
-  gy[0]->device().prelu_bw(*x[0], *y[0], *gy[0], .01, *gx[0]);
+  gy[0]->device().prelu_bw(*x[0], *y[0], *gy[0], .01, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(Transpose) {
-  gy[0]->device().transpose_bw(*x[0], *y[0], *gy[0], *gx[0]);
+  gy[0]->device().transpose_bw(*x[0], *y[0], *gy[0], prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(AddConst) {
-  gy[0]->device().add_const_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device(
+      ).add_const_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(SubtractConstR) {
-  gy[0]->device().subtract_const_r_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device(
+      ).subtract_const_r_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(SubtractConstL) {
-  gy[0]->device().subtract_const_l_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device(
+      ).subtract_const_l_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(MultiplyConst) {
-  gy[0]->device().multiply_const_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device(
+      ).multiply_const_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(DivideConstR) {
-  gy[0]->device().divide_const_r_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device(
+      ).divide_const_r_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(DivideConstL) {
-  gy[0]->device().divide_const_l_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device(
+      ).divide_const_l_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(PowConstR) {
-  gy[0]->device().pow_const_r_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device(
+      ).pow_const_r_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(PowConstL) {
-  gy[0]->device().pow_const_l_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device(
+      ).pow_const_l_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(PReLU) {
-  gy[0]->device().prelu_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device().prelu_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(ELU) {
-  gy[0]->device().elu_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device().elu_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(PowN) {
-  gy[0]->device().pown_bw(*x[0], *y[0], *gy[0], k_, *gx[0]);
+  gy[0]->device().pown_bw(*x[0], *y[0], *gy[0], k_, prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(AddScalar) {
-  UNUSED(x);
   UNUSED(y);
-  *gx[0] += *gy[0];
-  *gx[1] += functions::sum(gy[0]->flatten(), 0);
+  accumulate(*x[0], *gy[0], *gx[0]);
+  accumulate(*x[1], functions::sum(gy[0]->flatten(), 0), *gx[1]);
 }
 
 BACKWARD(SubtractScalarR) {
-  UNUSED(x);
   UNUSED(y);
-  *gx[0] += *gy[0];
-  *gx[1] -= functions::sum(gy[0]->flatten(), 0);
+  accumulate(*x[0], *gy[0], *gx[0]);
+  accumulate_negative(*x[1], functions::sum(gy[0]->flatten(), 0), *gx[1]);
 }
 
 BACKWARD(SubtractScalarL) {
-  UNUSED(x);
   UNUSED(y);
-  *gx[0] -= *gy[0];
-  *gx[1] += functions::sum(gy[0]->flatten(), 0);
+  accumulate_negative(*x[0], *gy[0], *gx[0]);
+  accumulate(*x[1], functions::sum(gy[0]->flatten(), 0), *gx[1]);
 }
 
 BACKWARD(MultiplyScalar) {
   UNUSED(y);
-  *gx[0] += *x[1] * *gy[0];
-  *gx[1] += functions::sum((*x[0] * *gy[0]).flatten(), 0);
+  accumulate(*x[0], *x[1] * *gy[0], *gx[0]);
+  accumulate(*x[1], functions::sum((*x[0] * *gy[0]).flatten(), 0), *gx[1]);
 }
 
 BACKWARD(DivideScalarR) {
   const Tensor a = *gy[0] / *x[1];
-  *gx[0] += a;
-  *gx[1] -= functions::sum((a * *y[0]).flatten(), 0);
+  accumulate(*x[0], a, *gx[0]);
+  accumulate_negative(*x[1], functions::sum((a * *y[0]).flatten(), 0), *gx[1]);
 }
 
 BACKWARD(DivideScalarL) {
   const Tensor a = *gy[0] / *x[0];
-  *gx[0] -= a * *y[0];
-  *gx[1] += functions::sum(a.flatten(), 0);
+  accumulate_negative(*x[0], a * *y[0], *gx[0]);
+  accumulate(*x[1], functions::sum(a.flatten(), 0), *gx[1]);
 }
 
 BACKWARD(PowScalarR) {
   const Tensor a = *gy[0] * *y[0];
-  *gx[0] += a * *x[1] / *x[0];
-  *gx[1] += functions::sum((a * functions::log(*x[0])).flatten(), 0);
+  accumulate(*x[0], a * *x[1] / *x[0], *gx[0]);
+  accumulate(
+      *x[1],
+      functions::sum((a * functions::log(*x[0])).flatten(), 0),
+      *gx[1]);
 }
 
 BACKWARD(PowScalarL) {
   const Tensor a = *gy[0] * *y[0];
-  *gx[0] += a * functions::log(*x[1]);
-  *gx[1] += functions::sum((a * *x[0] / *x[1]).flatten(), 0);
+  accumulate(*x[0], a * functions::log(*x[1]), *gx[0]);
+  accumulate(*x[1], functions::sum((a * *x[0] / *x[1]).flatten(), 0), *gx[1]);
 }
 
 BACKWARD(Add) {
-  gy[0]->device().add_bw(*x[0], *x[1], *y[0], *gy[0], *gx[0], *gx[1]);
+  UNUSED(y);
+  accumulate(*x[0], *gy[0], *gx[0]);
+  accumulate(*x[1], *gy[0], *gx[1]);
 }
 
 BACKWARD(Subtract) {
-  gy[0]->device().subtract_bw(*x[0], *x[1], *y[0], *gy[0], *gx[0], *gx[1]);
+  UNUSED(y);
+  accumulate(*x[0], *gy[0], *gx[0]);
+  accumulate_negative(*x[1], *gy[0], *gx[1]);
 }
 
 BACKWARD(Multiply) {
-  gy[0]->device().multiply_bw(*x[0], *x[1], *y[0], *gy[0], *gx[0], *gx[1]);
+  gy[0]->device().multiply_bw(
+      *x[0], *x[1], *y[0], *gy[0],
+      prepare(*x[0], *gx[0]), prepare(*x[1], *gx[1]));
 }
 
 BACKWARD(Divide) {
-  gy[0]->device().divide_bw(*x[0], *x[1], *y[0], *gy[0], *gx[0], *gx[1]);
+  gy[0]->device().divide_bw(
+      *x[0], *x[1], *y[0], *gy[0],
+      prepare(*x[0], *gx[0]), prepare(*x[1], *gx[1]));
 }
 
 BACKWARD(Pow) {
-  gy[0]->device().pow_bw(*x[0], *x[1], *y[0], *gy[0], *gx[0], *gx[1]);
+  gy[0]->device().pow_bw(
+      *x[0], *x[1], *y[0], *gy[0],
+      prepare(*x[0], *gx[0]), prepare(*x[1], *gx[1]));
 }
 
 BACKWARD(MatrixMultiply) {
-  gy[0]->device().matmul_bw(*x[0], *x[1], *y[0], *gy[0], *gx[0], *gx[1]);
+  gy[0]->device().matmul_bw(
+      *x[0], *x[1], *y[0], *gy[0],
+      prepare(*x[0], *gx[0]), prepare(*x[1], *gx[1]));
 }
 
 BACKWARD(Sum) {
   UNUSED(y);
-  *gx[0] += functions::broadcast(*gy[0], dim_, x[0]->shape()[dim_]);
+  accumulate(
+      *x[0],
+      functions::broadcast(*gy[0], dim_, x[0]->shape()[dim_]),
+      *gx[0]);
 }
 
 BACKWARD(LogSumExp) {
   // NOTE(odashi): dy/dx = softmax(x) = exp(x - y)
   const std::uint32_t n = x[0]->shape()[dim_];
-  *gx[0]
-    += functions::exp(*x[0] - functions::broadcast(*y[0], dim_, n))
-    * functions::broadcast(*gy[0], dim_, n);
+  accumulate(
+      *x[0],
+      functions::exp(*x[0] - functions::broadcast(*y[0], dim_, n))
+      * functions::broadcast(*gy[0], dim_, n),
+      *gx[0]);
 }
 
 BACKWARD(Broadcast) {
-  UNUSED(x);
   UNUSED(y);
-  *gx[0] += functions::sum(*gy[0], dim_);
+  accumulate(*x[0], functions::sum(*gy[0], dim_), *gx[0]);
 }
 
 BACKWARD(BatchSum) {
-  UNUSED(x);
   UNUSED(y);
-  *gx[0] += *gy[0];
+  accumulate(*x[0], *gy[0], *gx[0]);
 }
 
 BACKWARD(Convolution2D) {
   gy[0]->device().conv2d_bw(
       *x[0], *x[1], *y[0], *gy[0],
       padding0_, padding1_, stride0_, stride1_, dilation0_, dilation1_,
-      *gx[0], *gx[1]);
+      prepare(*x[0], *gx[0]), prepare(*x[1], *gx[1]));
 }
 
 BACKWARD(MaxPooling2D) {
   gy[0]->device().max_pool2d_bw(
       *x[0], *y[0], *gy[0],
       window0_, window1_, padding0_, padding1_, stride0_, stride1_,
-      *gx[0]);
+      prepare(*x[0], *gx[0]));
 }
 
 BACKWARD(SoftmaxCrossEntropy) {
@@ -713,8 +1485,8 @@ BACKWARD(SoftmaxCrossEntropy) {
   const Tensor log_softmax_x = functions::log_softmax(*x[0], dim_);
   const Tensor bcast_gy = functions::broadcast(
       *gy[0], dim_, x[0]->shape()[dim_]);
-  *gx[0] += (functions::exp(log_softmax_x) - *x[1]) * bcast_gy;
-  *gx[1] -= log_softmax_x * bcast_gy;
+  accumulate(*x[0], (functions::exp(log_softmax_x) - *x[1]) * bcast_gy, *gx[0]);
+  accumulate_negative(*x[1], log_softmax_x * bcast_gy, *gx[1]);
 }
 
 BACKWARD(SparseSoftmaxCrossEntropy) {
@@ -722,19 +1494,79 @@ BACKWARD(SparseSoftmaxCrossEntropy) {
   //       = gy * softmax(x) - gy * delta(x, i)
   UNUSED(y);
 #ifdef PRIMITIV_USE_CACHE
-  *gx[0]
-    += functions::exp(log_softmax_x_)
-    * functions::broadcast(*gy[0], dim_, x[0]->shape()[dim_]);
+  accumulate(
+      *x[0],
+      functions::exp(log_softmax_x_)
+      * functions::broadcast(*gy[0], dim_, x[0]->shape()[dim_]),
+      *gx[0]);
 #else
-  *gx[0]
-    += functions::softmax(*x[0], dim_)
-    * functions::broadcast(*gy[0], dim_, x[0]->shape()[dim_]);
+  accumulate(
+      *x[0],
+      functions::softmax(*x[0], dim_)
+      * functions::broadcast(*gy[0], dim_, x[0]->shape()[dim_]),
+      *gx[0]);
 #endif  // PRIMITIV_USE_CACHE
   gy[0]->device().pick_bw(-*gy[0], ids_, dim_, *gx[0]);
 }
 
 BACKWARD_NOP(StopGradient);
 
+BACKWARD(Scan) {
+  // Backpropagation through time: each step is recalculated from the kept
+  // state, and gradients of states are carried to the previous step.
+  UNUSED(y);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::uint32_t n = history_.size();
+  const std::uint32_t span = state_shapes_[0][dim_];
+  vector<Tensor> carry(num_states_);
+  for (std::uint32_t i = 0; i < num_states_; ++i) carry[i] = *gy[i];
+  vector<Tensor> input_grads(n);
+
+  graph_->capture({ loss_ });
+  for (std::uint32_t t = n; t-- > 0; ) {
+    for (std::uint32_t i = 0; i < num_states_; ++i) {
+      states_[i]->set_value(history_[t][i]);
+      states_[i]->reset_gradient();
+    }
+    input_->set_value(functions::slice(*x[num_states_], dim_, t, t + 1));
+    input_->reset_gradient();
+    // The first state is also the output of this step.
+    seeds_[0]->set_value(
+        carry[0] + functions::slice(
+          *gy[num_states_], dim_, t * span, (t + 1) * span));
+    for (std::uint32_t i = 1; i < num_states_; ++i) {
+      seeds_[i]->set_value(carry[i]);
+    }
+    if (graph_->plan_size() > 0) graph_->replay();
+    graph_->backward(loss_);
+
+    // Invalid gradients represent zeros.
+    for (std::uint32_t i = 0; i < num_states_; ++i) {
+      const Tensor &g = states_[i]->gradient();
+      carry[i] = g.valid()
+        ? g
+        : functions::zeros<Tensor>(state_shapes_[i], x[i]->device());
+    }
+    const Tensor &g = input_->gradient();
+    input_grads[t] = g.valid()
+      ? g
+      : functions::zeros<Tensor>(input_shape_, x[num_states_]->device());
+  }
+
+  for (std::uint32_t i = 0; i < num_states_; ++i) {
+    accumulate(*x[i], carry[i], *gx[i]);
+  }
+  accumulate(
+      *x[num_states_], functions::concat(input_grads, dim_),
+      *gx[num_states_]);
+}
+
+BACKWARD(FusedElementwise) {
+  // The graph performs the backward operation using original operators.
+  UNUSED(x); UNUSED(y); UNUSED(gy); UNUSED(gx);
+  PRIMITIV_THROW_NOT_IMPLEMENTED;
+}
+
 #undef BACKWARD_NOP
 #undef BACKWARD
 
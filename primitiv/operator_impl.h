@@ -2,9 +2,17 @@
 #define PRIMITIV_OPERATOR_IMPL_H_
 
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <primitiv/graph.h>
+#include <primitiv/msgpack/reader.h>
+#include <primitiv/msgpack/writer.h>
 #include <primitiv/operator.h>
 #include <primitiv/parameter.h>
 #include <primitiv/shape.h>
+#include <primitiv/tensor.h>
 
 namespace primitiv {
 
@@ -15,9 +23,12 @@ namespace operators {
 #define PRIMITIV_DECL_DEFAULTS(argn, retn, inval) \
 public: \
   std::string name() const override; \
+  std::string signature() const override; \
   std::uint32_t num_arguments() const override { return argn; }; \
   std::uint32_t num_returns() const override { return retn; }; \
   bool has_inner_values() const override { return inval; }; \
+  bool accepts_invalid_gradients() const override { return true; } \
+  void save(msgpack::Writer &writer) const override; \
   void forward_shape( \
       const std::vector<const Shape *> &args, \
       const std::vector<Shape *> &rets) const override; \
@@ -34,11 +45,27 @@ public: \
       const std::vector<const Tensor *> &args, \
       const std::vector<Tensor *> &rets) const override;
 
+#define PRIMITIV_DECL_BUFFERED \
+public: \
+  bool accepts_return_buffers() const override { return true; }
+
+#define PRIMITIV_DECL_BATCHABLE \
+public: \
+  bool is_batchable() const override { return true; }
+
+#define PRIMITIV_DECL_ELEMENTWISE \
+  PRIMITIV_DECL_BUFFERED; \
+  PRIMITIV_DECL_BATCHABLE; \
+  bool is_elementwise() const override { return true; } \
+  bool get_elementwise_instruction( \
+      ElementwiseInstruction &inst) const override
+
 class Input : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(0, 1);
 public:
   Input(const Shape &shape, const std::vector<float> &data, Device &device);
   Device *get_device() const override { return &device_; }
+  void reset_data(const std::vector<float> &data);
 private:
   Shape shape_;
   std::vector<float> data_;
@@ -48,11 +75,43 @@ private:
 class Parameter : public Operator {
   PRIMITIV_DECL_DEFAULTS(0, 1, true);
 public:
-  explicit Parameter(primitiv::Parameter &param) : param_(param) {}
-  Device *get_device() const override { return &param_.device(); }
+  explicit Parameter(primitiv::Parameter &param) : param_(&param) {}
+  bool has_trainable_values() const override { return true; }
+  Device *get_device() const override { return &param_->device(); }
+  std::vector<const Tensor *> get_inner_values() const override;
+  void reset_parameter(primitiv::Parameter &param) { param_ = &param; }
+  primitiv::Parameter &parameter() const { return *param_; }
+private:
+  primitiv::Parameter *param_;
+};
+
+class Detached : public Operator {
+  PRIMITIV_DECL_DEFAULTS(0, 1, true);
+public:
+  explicit Detached(const Tensor &value) : value_(value) {}
+  Device *get_device() const override { return &value_.device(); }
   std::vector<const Tensor *> get_inner_values() const override;
 private:
-  primitiv::Parameter &param_;
+  Tensor value_;
+};
+
+class Placeholder : public Operator {
+  PRIMITIV_DECL_DEFAULTS(0, 1, true);
+public:
+  Placeholder(const Shape &shape, Device &device, bool trainable)
+  : shape_(shape), device_(device), trainable_(trainable) {}
+  bool has_trainable_values() const override { return trainable_; }
+  Device *get_device() const override { return &device_; }
+  std::vector<const Tensor *> get_inner_values() const override;
+  void set_value(const Tensor &value);
+  const Tensor &gradient() const { return grad_; }
+  void reset_gradient() { grad_.invalidate(); }
+private:
+  Shape shape_;
+  Device &device_;
+  bool trainable_;
+  Tensor value_;
+  mutable Tensor grad_;
 };
 
 class Copy : public Operator {
@@ -149,6 +208,7 @@ private:
 
 class Slice : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1);
+  PRIMITIV_DECL_BATCHABLE;
 public:
   Slice(std::uint32_t dim, std::uint32_t lower, std::uint32_t upper)
     : dim_(dim), lower_(lower), upper_(upper) {}
@@ -169,6 +229,7 @@ private:
 
 class Concat : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(Operator::NONZERO, 1);
+  PRIMITIV_DECL_BATCHABLE;
 public:
   explicit Concat(std::uint32_t dim) : dim_(dim) {}
 private:
@@ -185,6 +246,7 @@ private:
 
 class Sum : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1);
+  PRIMITIV_DECL_BATCHABLE;
 public:
   explicit Sum(std::uint32_t dim) : dim_(dim) {}
 private:
@@ -193,6 +255,7 @@ private:
 
 class LogSumExp : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1);
+  PRIMITIV_DECL_BATCHABLE;
 public:
   explicit LogSumExp(std::uint32_t dim) : dim_(dim) {}
 private:
@@ -201,6 +264,7 @@ private:
 
 class Broadcast : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1);
+  PRIMITIV_DECL_BATCHABLE;
 public:
   Broadcast(std::uint32_t dim, std::uint32_t size) : dim_(dim), size_(size) {}
 private:
@@ -210,6 +274,7 @@ private:
 
 class SoftmaxCrossEntropy : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1);
+  PRIMITIV_DECL_BATCHABLE;
 public:
   explicit SoftmaxCrossEntropy(std::uint32_t dim) : dim_(dim) {}
 private:
@@ -234,27 +299,36 @@ private:
     PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1); \
   }
 
-// Unary operator with a constant.
+// Elementwise unary operator with no parameter.
+#define PRIMITIV_DECL_UNARY_ELEMENTWISE(name_) \
+  class name_ : public Operator { \
+    PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1); \
+    PRIMITIV_DECL_ELEMENTWISE; \
+  }
+
+// Elementwise unary operator with a constant.
 #define PRIMITIV_DECL_UNARY_K(name_, type) \
   class name_ : public Operator { \
     PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1); \
+    PRIMITIV_DECL_ELEMENTWISE; \
   public: \
     explicit name_(type k) : k_(k) {} \
   private: \
     type k_; \
   }
 
-// Binary operator with no parameter.
+// Elementwise binary operator with no parameter.
 #define PRIMITIV_DECL_BINARY(name_) \
   class name_ : public Operator { \
     PRIMITIV_DECL_DEFAULTS_AND_FORWARD(2, 1); \
+    PRIMITIV_DECL_ELEMENTWISE; \
   }
 
 PRIMITIV_DECL_UNARY(StopGradient);
 PRIMITIV_DECL_UNARY(Flatten);
 
 PRIMITIV_DECL_UNARY(Positive);
-PRIMITIV_DECL_UNARY(Negative);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Negative);
 
 PRIMITIV_DECL_UNARY_K(AddConst, float);
 PRIMITIV_DECL_UNARY_K(SubtractConstR, float);
@@ -284,25 +358,35 @@ PRIMITIV_DECL_BINARY(Multiply);
 PRIMITIV_DECL_BINARY(Divide);
 PRIMITIV_DECL_BINARY(Pow);
 
-PRIMITIV_DECL_UNARY(Transpose);
-PRIMITIV_DECL_BINARY(MatrixMultiply);
-
-PRIMITIV_DECL_UNARY(Sqrt);
-PRIMITIV_DECL_UNARY(Exp);
-PRIMITIV_DECL_UNARY(Log);
-PRIMITIV_DECL_UNARY(Tanh);
-PRIMITIV_DECL_UNARY(Sigmoid);
-PRIMITIV_DECL_UNARY(Softplus);
-PRIMITIV_DECL_UNARY(Sin);
-PRIMITIV_DECL_UNARY(Cos);
-PRIMITIV_DECL_UNARY(Tan);
-PRIMITIV_DECL_UNARY(ReLU);
-PRIMITIV_DECL_UNARY(LReLU);
+class Transpose : public Operator {
+  PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1);
+  PRIMITIV_DECL_BATCHABLE;
+  PRIMITIV_DECL_BUFFERED;
+};
+
+class MatrixMultiply : public Operator {
+  PRIMITIV_DECL_DEFAULTS_AND_FORWARD(2, 1);
+  PRIMITIV_DECL_BATCHABLE;
+  PRIMITIV_DECL_BUFFERED;
+};
+
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Sqrt);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Exp);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Log);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Tanh);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Sigmoid);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Softplus);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Sin);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Cos);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(Tan);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(ReLU);
+PRIMITIV_DECL_UNARY_ELEMENTWISE(LReLU);
 
 PRIMITIV_DECL_UNARY(BatchSum);
 
 class Convolution2D : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(2, 1);
+  PRIMITIV_DECL_BATCHABLE;
 public:
   Convolution2D(
       std::uint32_t padding0, std::uint32_t padding1,
@@ -319,6 +403,7 @@ private:
 
 class MaxPooling2D : public Operator {
   PRIMITIV_DECL_DEFAULTS_AND_FORWARD(1, 1);
+  PRIMITIV_DECL_BATCHABLE;
 public:
   MaxPooling2D(
       std::uint32_t window0, std::uint32_t window1,
@@ -333,10 +418,67 @@ private:
   std::uint32_t stride0_, stride1_;
 };
 
+class Scan : public Operator {
+  PRIMITIV_DECL_DEFAULTS_AND_FORWARD(num_states_ + 1, num_states_ + 1);
+public:
+  using StepFunction = std::function<
+    std::vector<Node>(const std::vector<Node> &, const Node &)>;
+  Scan(
+      const StepFunction &step,
+      const std::vector<Node> &init, const Node &xs, std::uint32_t dim);
+  bool has_trainable_values() const override { return trainable_; }
+private:
+  std::uint32_t num_states_;
+  std::uint32_t dim_;
+  std::vector<Shape> state_shapes_;
+  Shape input_shape_;
+  std::unique_ptr<Graph> graph_;
+  std::vector<Placeholder *> states_;
+  Placeholder *input_;
+  std::vector<Placeholder *> seeds_;
+  std::vector<Node> outputs_;
+  Node loss_;
+  bool trainable_;
+  // The inner graph and the history are shared by all calls, and the mutex
+  // serializes forward/backward operations executed by multiple threads.
+  mutable std::vector<std::vector<Tensor>> history_;
+  mutable std::mutex mutex_;
+};
+
+class FusedElementwise : public Operator {
+  PRIMITIV_DECL_DEFAULTS_AND_FORWARD(Operator::NONZERO, 1);
+  PRIMITIV_DECL_BUFFERED;
+public:
+  FusedElementwise(
+      const std::vector<ElementwiseInstruction> &program, const Shape &shape)
+  : program_(program), shape_(shape) {}
+  bool is_elementwise() const override { return true; }
+private:
+  std::vector<ElementwiseInstruction> program_;
+  Shape shape_;
+};
+
+/**
+ * Restores the operator written by `Operator::save()`.
+ * @param type Type name of the operator, which is written at first by
+ *             `Operator::save()`.
+ * @param reader Reader object of the input stream.
+ * @param device Device object used by the new operator.
+ * @return New operator object.
+ * @throw primitiv::Error `type` is unknown or can not be restored by this
+ *                        function.
+ */
+std::unique_ptr<Operator> load_operator(
+    const std::string &type, msgpack::Reader &reader, Device &device);
+
 #undef PRIMITIV_DECL_UNARY
+#undef PRIMITIV_DECL_UNARY_ELEMENTWISE
 #undef PRIMITIV_DECL_UNARY_K
 #undef PRIMITIV_DECL_BINARY
 
+#undef PRIMITIV_DECL_ELEMENTWISE
+#undef PRIMITIV_DECL_BATCHABLE
+#undef PRIMITIV_DECL_BUFFERED
 #undef PRIMITIV_DECL_DEFAULTS_AND_FORWARD
 #undef PRIMITIV_DECL_DEFAULTS
 
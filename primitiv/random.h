@@ -1,29 +1,134 @@
 #ifndef PRIMITIV_RANDOM_H_
 #define PRIMITIV_RANDOM_H_
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <random>
+#include <thread>
+#include <unordered_map>
 #include <primitiv/mixins.h>
 
 namespace primitiv {
 
 /**
  * Default randomizer for any devices.
+ * @remarks This class is thread-safe. Each thread draws numbers from its own
+ *          random number stream, and the thread which created the randomizer
+ *          uses the stream initialized by the seed itself. Streams of other
+ *          threads are initialized by the seed and the index specified by
+ *          `set_thread_stream_index()`. If the index is not specified, the
+ *          order of the first use of each thread is used instead, which is
+ *          not reproducible when multiple threads start at the same time.
  */
 class DefaultRandomizer : mixins::Nonmovable<DefaultRandomizer> {
+  /**
+   * Random number stream used by one thread.
+   */
+  struct Stream {
+    std::weak_ptr<void> owner;
+    std::mt19937 rng;
+  };
+
+  const bool seeded_;
+  const std::uint32_t seed_;
+  const std::thread::id owner_;
+  const std::uint64_t id_;
+  const std::shared_ptr<void> alive_;
   std::mt19937 rng_;
+  std::atomic<std::uint32_t> num_streams_;
+
+  /**
+   * Issues a new randomizer ID which is never reused.
+   * @return New ID.
+   */
+  static std::uint64_t issue_id() {
+    static std::atomic<std::uint64_t> next_id(0);
+    return next_id++;
+  }
+
+  /**
+   * Retrieves streams of the current thread.
+   * @return Map from randomizer IDs to streams. Streams are deleted when the
+   *         thread exits.
+   */
+  static std::unordered_map<std::uint64_t, Stream> &thread_streams() {
+    static thread_local std::unordered_map<std::uint64_t, Stream> streams;
+    return streams;
+  }
+
+  /**
+   * Retrieves the stream index of the current thread.
+   * @return Reference of the index plus one, or 0 if not specified.
+   */
+  static std::uint64_t &thread_stream_index() {
+    static thread_local std::uint64_t index = 0;
+    return index;
+  }
+
+  /**
+   * Retrieves the random number stream of the current thread.
+   * @return Reference of the generator, which is used only by the current
+   *         thread.
+   */
+  std::mt19937 &stream() {
+    if (std::this_thread::get_id() == owner_) return rng_;
+    std::unordered_map<std::uint64_t, Stream> &streams = thread_streams();
+    const auto it = streams.find(id_);
+    if (it != streams.end()) return it->second.rng;
+
+    // Streams of destroyed randomizers are removed when a new stream is
+    // added.
+    for (auto it = streams.begin(); it != streams.end(); ) {
+      if (it->second.owner.expired()) it = streams.erase(it);
+      else ++it;
+    }
+    Stream &s = streams[id_];
+    s.owner = alive_;
+    if (seeded_) {
+      const std::uint64_t index = thread_stream_index();
+      const std::uint32_t values[] {
+        seed_,
+        index > 0,
+        index > 0 ? static_cast<std::uint32_t>(index - 1) : ++num_streams_,
+      };
+      std::seed_seq seq(std::begin(values), std::end(values));
+      s.rng.seed(seq);
+    } else {
+      s.rng.seed(std::random_device()());
+    }
+    return s.rng;
+  }
 
 public:
   /**
    * Creates a randomizer object using environment seeds.
    */
-  DefaultRandomizer() : rng_(std::random_device()()) {}
+  DefaultRandomizer()
+    : seeded_(false), seed_(0), owner_(std::this_thread::get_id())
+    , id_(issue_id()), alive_(std::make_shared<char>())
+    , rng_(std::random_device()()), num_streams_(0) {}
 
   /**
    * Creates a randomizer object using a user seed.
    * @param seed Seed value of the randomizer.
    */
-  explicit DefaultRandomizer(std::uint32_t seed) : rng_(seed) {}
+  explicit DefaultRandomizer(std::uint32_t seed)
+    : seeded_(true), seed_(seed), owner_(std::this_thread::get_id())
+    , id_(issue_id()), alive_(std::make_shared<char>())
+    , rng_(seed), num_streams_(0) {}
+
+  /**
+   * Specifies the index of random number streams of the current thread.
+   * @param index Stream index. Threads with the same index draw the same
+   *              sequence from randomizers with the same seed.
+   * @remarks The index is used by streams initialized after this call.
+   */
+  static void set_thread_stream_index(std::uint32_t index) {
+    thread_stream_index() = static_cast<std::uint64_t>(index) + 1;
+  }
 
   /**
    * Fill an array using a Bernoulli distribution.
@@ -33,8 +138,9 @@ public:
    */
   void fill_bernoulli(float p, std::size_t size, float *data) {
     std::bernoulli_distribution dist(p);
+    std::mt19937 &rng = stream();
     for (std::size_t i = 0; i < size; ++i) {
-      data[i] = dist(rng_);
+      data[i] = dist(rng);
     }
   }
 
@@ -48,8 +154,9 @@ public:
    */
   void fill_uniform(float lower, float upper, std::size_t size, float *data) {
     std::uniform_real_distribution<float> dist(lower, upper);
+    std::mt19937 &rng = stream();
     for (std::size_t i = 0; i < size; ++i) {
-      const float x = dist(rng_);
+      const float x = dist(rng);
       data[i] = x == lower ? upper : x;
     }
   }
@@ -63,8 +170,9 @@ public:
    */
   void fill_normal(float mean, float sd, std::size_t size, float *data) {
     std::normal_distribution<float> dist(mean, sd);
+    std::mt19937 &rng = stream();
     for (std::size_t i = 0; i < size; ++i) {
-      data[i] = dist(rng_);
+      data[i] = dist(rng);
     }
   }
 
@@ -77,8 +185,9 @@ public:
    */
   void fill_log_normal(float mean, float sd, std::size_t size, float *data) {
     std::lognormal_distribution<float> dist(mean, sd);
+    std::mt19937 &rng = stream();
     for (std::size_t i = 0; i < size; ++i) {
-      data[i] = dist(rng_);
+      data[i] = dist(rng);
     }
   }
 };
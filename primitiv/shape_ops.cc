@@ -83,6 +83,47 @@ Shape concat(const std::vector<const Shape *> &xs, std::uint32_t dim) {
   return s0;
 }
 
+Shape batch_slice(const Shape &x, std::uint32_t lower, std::uint32_t upper) {
+  if (lower >= upper || upper > x.batch()) {
+    PRIMITIV_THROW_ERROR(
+        "Invalid batch slice operation. shape: " << x.to_string()
+        << ", lower: " << lower << ", upper: " << upper);
+  }
+
+  return x.resize_batch(upper - lower);
+}
+
+Shape batch_concat(const std::vector<Shape> &xs) {
+  std::vector<const Shape *> ptrs;
+  ptrs.reserve(xs.size());
+  for (const Shape &x : xs) ptrs.emplace_back(&x);
+  return batch_concat(ptrs);
+}
+
+Shape batch_concat(const std::vector<const Shape *> &xs) {
+  if (xs.empty()) {
+    PRIMITIV_THROW_ERROR("No tensors to be concatenated.");
+  }
+
+  const Shape &s0 = *xs[0];
+  std::uint32_t sum = s0.batch();
+
+  for (std::uint32_t i = 1; i < xs.size(); ++i) {
+    const Shape &s = *xs[i];
+    if (!s0.has_same_dims(s)) {
+      std::string dims_str = xs[0]->to_string();
+      for (std::uint32_t i = 1; i < xs.size(); ++i) {
+        dims_str += ", " + xs[i]->to_string();
+      }
+      PRIMITIV_THROW_ERROR(
+          "Invalid shapes to concatenate along the minibatch: " << dims_str);
+    }
+    sum += s.batch();
+  }
+
+  return s0.resize_batch(sum);
+}
+
 Shape broadcast(const Shape &x, std::uint32_t dim, std::uint32_t size) {
   if (x[dim] != 1 || size == 0) {
     PRIMITIV_THROW_ERROR(
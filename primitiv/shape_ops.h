@@ -66,6 +66,31 @@ Shape concat(const std::vector<Shape> &xs, std::uint32_t dim);
  */
 Shape concat(const std::vector<const Shape *> &xs, std::uint32_t dim);
 
+/**
+ * Calculates a shape of the slice along the minibatch.
+ * @param x A shape.
+ * @param lower Lower bound of the minibatch.
+ * @param upper Upper bound of the minibatch.
+ * @return Calculated shape.
+ */
+Shape batch_slice(const Shape &x, std::uint32_t lower, std::uint32_t upper);
+
+/**
+ * Calculates a shape concatenated along the minibatch.
+ * @param xs A list of shapes.
+ * @return Calculated shape.
+ * @remarks All shapes should have the same dimensions.
+ */
+Shape batch_concat(const std::vector<Shape> &xs);
+
+/**
+ * Calculates a shape concatenated along the minibatch.
+ * @param xs A list of shapes.
+ * @return Calculated shape.
+ * @remarks All shapes should have the same dimensions.
+ */
+Shape batch_concat(const std::vector<const Shape *> &xs);
+
 /**
  * Calculates a broadcasted shape.
  * @param x A shape.
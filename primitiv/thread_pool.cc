@@ -0,0 +1,55 @@
+#include <primitiv/config.h>
+
+#include <utility>
+#include <primitiv/error.h>
+#include <primitiv/thread_pool.h>
+
+namespace primitiv {
+
+ThreadPool::ThreadPool(std::uint32_t num_threads) : stopped_(false) {
+  if (num_threads == 0) {
+    PRIMITIV_THROW_ERROR("Invalid number of threads: " << num_threads);
+  }
+  threads_.reserve(num_threads);
+  for (std::uint32_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cond_.notify_all();
+  for (std::thread &th : threads_) {
+    th.join();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.emplace(std::move(task));
+  }
+  cond_.notify_one();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this] { return stopped_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        // `stopped_` is true and there is no remaining task.
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+}  // namespace primitiv
@@ -0,0 +1,61 @@
+#ifndef PRIMITIV_THREAD_POOL_H_
+#define PRIMITIV_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <primitiv/mixins.h>
+
+namespace primitiv {
+
+/**
+ * Fixed-size pool of worker threads.
+ */
+class ThreadPool : mixins::Nonmovable<ThreadPool> {
+public:
+  /**
+   * Creates a new thread pool.
+   * @param num_threads Number of worker threads.
+   * @throw primitiv::Error `num_threads` is 0.
+   */
+  explicit ThreadPool(std::uint32_t num_threads);
+
+  /**
+   * Waits for all remaining tasks and stops all worker threads.
+   */
+  ~ThreadPool();
+
+  /**
+   * Returns the number of worker threads.
+   * @return Number of worker threads.
+   */
+  std::uint32_t num_threads() const { return threads_.size(); }
+
+  /**
+   * Adds a new task to the queue.
+   * @param task Task to be executed by one of the worker threads.
+   * @remarks Tasks should not throw any exceptions. Exceptions thrown by tasks
+   *          terminate the program.
+   */
+  void submit(std::function<void()> task);
+
+private:
+  /**
+   * Main loop of each worker thread.
+   */
+  void work();
+
+  std::vector<std::thread> threads_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stopped_;
+};
+
+}  // namespace primitiv
+
+#endif  // PRIMITIV_THREAD_POOL_H_
@@ -0,0 +1,91 @@
+#include <primitiv/config.h>
+
+#include <cstdint>
+#include <vector>
+#include <gtest/gtest.h>
+#include <primitiv/arena.h>
+#include <primitiv/error.h>
+
+namespace primitiv {
+
+class ArenaTest : public testing::Test {};
+
+TEST_F(ArenaTest, CheckNew) {
+  Arena arena(1024);
+  EXPECT_EQ(0u, arena.used());
+  EXPECT_EQ(0u, arena.capacity());
+}
+
+TEST_F(ArenaTest, CheckInvalidNew) {
+  EXPECT_THROW(Arena(0), Error);
+}
+
+TEST_F(ArenaTest, CheckAllocate) {
+  Arena arena(1024);
+  char *p1 = static_cast<char *>(arena.allocate(10, 1));
+  char *p2 = static_cast<char *>(arena.allocate(10, 1));
+  EXPECT_EQ(p1 + 10, p2);
+  EXPECT_EQ(20u, arena.used());
+  EXPECT_EQ(1024u, arena.capacity());
+}
+
+TEST_F(ArenaTest, CheckAlignment) {
+  Arena arena(1024);
+  arena.allocate(1, 1);
+  for (const std::size_t align : {2u, 4u, 8u, 16u, 64u}) {
+    const void *p = arena.allocate(1, align);
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(p) % align);
+  }
+}
+
+TEST_F(ArenaTest, CheckInvalidAlignment) {
+  Arena arena(1024);
+  for (const std::size_t align : {0u, 3u, 6u, 12u}) {
+    EXPECT_THROW(arena.allocate(1, align), Error);
+  }
+}
+
+TEST_F(ArenaTest, CheckNewChunk) {
+  Arena arena(1024);
+  arena.allocate(1000, 1);
+  arena.allocate(100, 1);
+  EXPECT_EQ(2048u, arena.capacity());
+
+  // Blocks larger than the chunk size obtain dedicated chunks.
+  arena.allocate(4096, 8);
+  EXPECT_EQ(2048u + 4096u + 8u, arena.capacity());
+}
+
+TEST_F(ArenaTest, CheckReset) {
+  Arena arena(1024);
+  std::vector<void *> ptrs;
+  for (std::uint32_t i = 0; i < 100; ++i) {
+    ptrs.emplace_back(arena.allocate(32, 8));
+  }
+  const std::size_t capacity = arena.capacity();
+
+  arena.reset();
+  EXPECT_EQ(0u, arena.used());
+  EXPECT_EQ(capacity, arena.capacity());
+
+  // Same blocks are provided again without obtaining new chunks.
+  for (std::uint32_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(ptrs[i], arena.allocate(32, 8));
+  }
+  EXPECT_EQ(capacity, arena.capacity());
+}
+
+TEST_F(ArenaTest, CheckAllocator) {
+  Arena arena(1024);
+  std::vector<std::uint32_t, ArenaAllocator<std::uint32_t>> xs{
+    ArenaAllocator<std::uint32_t>(arena) };
+  for (std::uint32_t i = 0; i < 100; ++i) {
+    xs.emplace_back(i);
+  }
+  for (std::uint32_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, xs[i]);
+  }
+  EXPECT_LE(100 * sizeof(std::uint32_t), arena.used());
+}
+
+}  // namespace primitiv
@@ -43,5 +43,23 @@ TEST_F(CDeviceTest, CheckDefault) {
             ::primitivGetDefaultDevice(&device));
 }
 
+TEST_F(CDeviceTest, CheckThreadDefault) {
+  ::primitivDevice_t *device;
+  ::primitivDevice_t *dev1;
+  ASSERT_EQ(PRIMITIV_C_OK, ::primitivCreateNaiveDevice(&dev1));
+  ::primitivDevice_t *dev2;
+  ASSERT_EQ(PRIMITIV_C_OK, ::primitivCreateNaiveDevice(&dev2));
+  ::primitivSetDefaultDevice(dev1);
+  ASSERT_EQ(PRIMITIV_C_OK, ::primitivSetThreadDefaultDevice(dev2));
+  ::primitivGetDefaultDevice(&device);
+  EXPECT_EQ(dev2, device);
+  ASSERT_EQ(PRIMITIV_C_OK, ::primitivResetThreadDefaultDevice());
+  ::primitivGetDefaultDevice(&device);
+  EXPECT_EQ(dev1, device);
+  EXPECT_EQ(PRIMITIV_C_ERROR, ::primitivSetThreadDefaultDevice(nullptr));
+  ::primitivDeleteDevice(dev1);
+  ::primitivDeleteDevice(dev2);
+}
+
 }  // namespace c
 }  // namespace primitiv
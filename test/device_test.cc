@@ -1,7 +1,14 @@
 #include <primitiv/config.h>
 
+#include <vector>
 #include <gtest/gtest.h>
+#include <primitiv/error.h>
 #include <primitiv/naive_device.h>
+#include <primitiv/tensor.h>
+#include <test_utils.h>
+
+using std::vector;
+using test_utils::vector_match;
 
 namespace primitiv {
 
@@ -26,4 +33,64 @@ TEST_F(DeviceTest, CheckDefault) {
   EXPECT_THROW(Device::get_default(), Error);
 }
 
+TEST_F(DeviceTest, CheckTensorView) {
+  devices::Naive dev;
+  Tensor x = dev.new_tensor_by_vector({2, 2}, {1, 2, 3, 4});
+  Tensor v = dev.new_tensor_view(x, 1, {2});
+  EXPECT_EQ(Shape({2}), v.shape());
+  EXPECT_TRUE(vector_match(vector<float> {2, 3}, v.to_vector()));
+
+  // Writing into the view updates the original tensor.
+  v.reset_by_vector({5, 6});
+  EXPECT_TRUE(vector_match(vector<float> {1, 5, 6, 4}, x.to_vector()));
+
+  EXPECT_THROW(dev.new_tensor_view(x, 3, {2}), Error);
+}
+
+TEST_F(DeviceTest, CheckWriteIntoBuffer) {
+  devices::Naive dev;
+  Tensor x = dev.new_tensor_by_vector({2}, {1, 2});
+  Tensor y = dev.new_tensor_by_vector({2}, {3, 4});
+  Tensor buf = dev.new_tensor_by_constant({4}, 0);
+  Tensor z = dev.new_tensor_view(buf, 2, {2});
+  dev.add_fw(x, y, z);
+  EXPECT_TRUE(vector_match(vector<float> {0, 0, 4, 6}, buf.to_vector()));
+
+  // Elementwise operations can overwrite their arguments.
+  dev.multiply_const_fw(z, 2, z);
+  EXPECT_TRUE(vector_match(vector<float> {0, 0, 8, 12}, buf.to_vector()));
+
+  Tensor w = dev.new_tensor_by_constant({3}, 0);
+  EXPECT_THROW(dev.add_fw(x, y, w), Error);
+}
+
+TEST_F(DeviceTest, CheckBatchSlice) {
+  devices::Naive dev;
+  const Tensor x = dev.new_tensor_by_vector(
+      Shape({2, 2}, 3), {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12});
+  const Tensor y1 = dev.batch_slice_fw(x, 1, 3);
+  EXPECT_EQ(Shape({2, 2}, 2), y1.shape());
+  EXPECT_TRUE(vector_match(
+        vector<float> {5, 6, 7, 8, 9, 10, 11, 12}, y1.to_vector()));
+  const Tensor y2 = dev.batch_slice_fw(x, 0, 1);
+  EXPECT_EQ(Shape({2, 2}), y2.shape());
+  EXPECT_TRUE(vector_match(vector<float> {1, 2, 3, 4}, y2.to_vector()));
+  EXPECT_THROW(dev.batch_slice_fw(x, 2, 4), Error);
+}
+
+TEST_F(DeviceTest, CheckBatchConcat) {
+  devices::Naive dev;
+  const Tensor a = dev.new_tensor_by_vector({2, 2}, {1, 2, 3, 4});
+  const Tensor b = dev.new_tensor_by_vector(
+      Shape({2, 2}, 2), {5, 6, 7, 8, 9, 10, 11, 12});
+  const Tensor y = dev.batch_concat_fw({&b, &a});
+  EXPECT_EQ(Shape({2, 2}, 3), y.shape());
+  EXPECT_TRUE(vector_match(
+        vector<float> {5, 6, 7, 8, 9, 10, 11, 12, 1, 2, 3, 4},
+        y.to_vector()));
+  const Tensor c = dev.new_tensor_by_vector({4}, {1, 2, 3, 4});
+  EXPECT_THROW(dev.batch_concat_fw({&a, &c}), Error);
+  EXPECT_THROW(dev.batch_concat_fw({}), Error);
+}
+
 }  // namespace primitiv
@@ -1,23 +1,87 @@
 #include <primitiv/config.h>
 
+#include <cmath>
+#include <cstdio>
 #include <sstream>
+#include <string>
 #include <vector>
 #include <gtest/gtest.h>
 #include <primitiv/error.h>
 #include <primitiv/functions.h>
 #include <primitiv/graph.h>
 #include <primitiv/initializer_impl.h>
+#include <primitiv/model.h>
 #include <primitiv/naive_device.h>
 #include <primitiv/operator_impl.h>
 #include <primitiv/parameter.h>
 #include <test_utils.h>
 
+using std::string;
 using std::vector;
 using test_utils::vector_match;
 using test_utils::vector_near;
 
 namespace primitiv {
 
+namespace {
+
+// Identity operator which counts the number of forward/backward calls.
+class Counter : public Operator {
+public:
+  Counter(std::uint32_t *num_forward, std::uint32_t *num_backward)
+    : num_forward_(num_forward), num_backward_(num_backward) {}
+  std::string name() const override { return "Counter"; }
+  std::string signature() const override { return "Counter"; }
+  std::uint32_t num_arguments() const override { return 1; }
+  std::uint32_t num_returns() const override { return 1; }
+  bool has_inner_values() const override { return false; }
+  void forward_shape(
+      const vector<const Shape *> &args,
+      const vector<Shape *> &rets) const override {
+    *rets[0] = *args[0];
+  }
+  void forward(
+      const vector<const Tensor *> &args,
+      const vector<Tensor *> &rets) const override {
+    if (num_forward_) ++*num_forward_;
+    *rets[0] = *args[0];
+  }
+  void backward(
+      const vector<const Tensor *> &,
+      const vector<const Tensor *> &,
+      const vector<const Tensor *> &rets_g,
+      const vector<Tensor *> &args_g) const override {
+    if (num_backward_) ++*num_backward_;
+    *args_g[0] += *rets_g[0];
+  }
+private:
+  std::uint32_t *num_forward_;
+  std::uint32_t *num_backward_;
+};
+
+// Counter which can be merged by the automatic batching.
+class BatchableCounter : public Counter {
+public:
+  using Counter::Counter;
+  bool is_batchable() const override { return true; }
+};
+
+Node batchable_counter(const Node &x, std::uint32_t *num_forward) {
+  return x.graph().add_operator(
+      std::unique_ptr<Operator>(new BatchableCounter(num_forward, nullptr)),
+      {x})[0];
+}
+
+Node counter(
+    const Node &x,
+    std::uint32_t *num_backward, std::uint32_t *num_forward = nullptr) {
+  return x.graph().add_operator(
+      std::unique_ptr<Operator>(new Counter(num_forward, num_backward)),
+      {x})[0];
+}
+
+}  // namespace
+
 class GraphTest : public testing::Test {
 protected:
   devices::Naive dev;
@@ -160,6 +224,1095 @@ TEST_F(GraphTest, CheckClear) {
   EXPECT_EQ(0u, g.num_operators());
 }
 
+TEST_F(GraphTest, CheckOperatorArena) {
+  Device::set_default(dev);
+
+  Graph g;
+  Graph::set_default(g);
+
+  // The memory of the arena is reused after `clear()`.
+  void *ptr = g.allocate_operator(64);
+  g.clear();
+  EXPECT_EQ(ptr, g.allocate_operator(64));
+
+  for (std::uint32_t trial = 0; trial < 3; ++trial) {
+    g.clear();
+    const Node a = functions::input<Node>({2}, {1, 2});
+    const Node b = functions::input<Node>({2}, {3, 4});
+    // Argument lists longer than the inline storage.
+    Node x = functions::concat({a, b, a}, 0);
+    for (std::uint32_t i = 0; i < 1000; ++i) {
+      x = x + 1;
+    }
+    EXPECT_EQ(1003u, g.num_operators());
+    EXPECT_TRUE(vector_match(
+          vector<float> {1001, 1002, 1003, 1004, 1001, 1002}, x.to_vector()));
+  }
+}
+
+TEST_F(GraphTest, CheckDeepForward) {
+  Device::set_default(dev);
+
+  Graph g;
+  Graph::set_default(g);
+
+  // The number of operators in this graph is much larger than the depth of
+  // the call stack which can be used by the recursive implementation.
+  const std::uint32_t N = 200000;
+  Parameter px({}, {0});
+  Node x = functions::parameter<Node>(px);
+  for (std::uint32_t i = 0; i < N; ++i) {
+    x = x + 1;
+  }
+  EXPECT_EQ(N + 1, g.num_operators());
+  EXPECT_FLOAT_EQ(N, x.to_float());
+
+  px.reset_gradient();
+  EXPECT_NO_THROW(x.backward());
+  EXPECT_TRUE(vector_match(vector<float> {1}, px.gradient().to_vector()));
+}
+
+TEST_F(GraphTest, CheckPartialForward) {
+  Device::set_default(dev);
+
+  Graph g;
+  Graph::set_default(g);
+
+  const Node a = functions::input<Node>({}, {1});
+  const Node b = a + 1;
+  const Node c = a * 2;
+  const Node d = b + c;
+
+  // Calculates only the subgraph required by `b`.
+  EXPECT_FLOAT_EQ(2, b.to_float());
+  EXPECT_FLOAT_EQ(4, d.to_float());
+  EXPECT_FLOAT_EQ(2, c.to_float());
+  EXPECT_FLOAT_EQ(1, a.to_float());
+}
+
+TEST_F(GraphTest, CheckInferenceMode) {
+  Device::set_default(dev);
+
+  Graph g;
+  Graph::set_default(g);
+  EXPECT_FALSE(g.is_inference_mode());
+  g.set_inference_mode(true);
+  EXPECT_TRUE(g.is_inference_mode());
+
+  Parameter pw({2}, {1, 2});
+  const Node w = functions::parameter<Node>(pw);
+  const Node r = functions::random::uniform<Node>({2}, 0, 1);
+  const Node x = r * 0 + 3;
+  const Node y = w * x;
+
+  EXPECT_TRUE(vector_match(vector<float> {3, 6}, y.to_vector()));
+  // `x` should be kept because it is directly requested.
+  const vector<float> x_val = x.to_vector();
+  EXPECT_TRUE(vector_match(vector<float> {3, 3}, x_val));
+
+  // `r` was released after calculating `r * 0` and is recalculated here.
+  const Tensor &r1 = g.forward(r);
+  const vector<float> r_val = r1.to_vector();
+  const Node z = r + 0;
+  EXPECT_TRUE(vector_match(r_val, z.to_vector()));
+  // `r` was consumed by `r + 0` and has been released again.
+  EXPECT_FALSE(vector_match(r_val, r.to_vector()));
+
+  // Parameters are never released.
+  EXPECT_TRUE(vector_match(vector<float> {1, 2}, w.to_vector()));
+
+  pw.reset_gradient();
+  EXPECT_THROW(y.backward(), Error);
+
+  g.set_inference_mode(false);
+  EXPECT_FALSE(g.is_inference_mode());
+}
+
+TEST_F(GraphTest, CheckForwardMultipleNodes) {
+  Device::set_default(dev);
+
+  Graph g;
+  Graph::set_default(g);
+  g.set_inference_mode(true);
+
+  std::uint32_t num_forward = 0;
+  const Node x = functions::input<Node>({2}, {1, 2});
+  const Node h = counter(x * 2, nullptr, &num_forward);
+  const Node y1 = h + 1;
+  const Node y2 = h * 3;
+  const Node y3 = functions::sum(h, 0);
+
+  const vector<const Tensor *> values = g.forward({y1, y2, y3, h, y1});
+  ASSERT_EQ(5u, values.size());
+  EXPECT_EQ(1u, num_forward);
+  EXPECT_TRUE(vector_match(vector<float> {3, 5}, values[0]->to_vector()));
+  EXPECT_TRUE(vector_match(vector<float> {6, 12}, values[1]->to_vector()));
+  EXPECT_TRUE(vector_match(vector<float> {6}, values[2]->to_vector()));
+  EXPECT_TRUE(vector_match(vector<float> {2, 4}, values[3]->to_vector()));
+  EXPECT_EQ(values[0], values[4]);
+
+  // Calculated values are reused.
+  const vector<vector<float>> results = g.fetch({y3, y1, y2});
+  ASSERT_EQ(3u, results.size());
+  EXPECT_EQ(1u, num_forward);
+  EXPECT_TRUE(vector_match(vector<float> {6}, results[0]));
+  EXPECT_TRUE(vector_match(vector<float> {3, 5}, results[1]));
+  EXPECT_TRUE(vector_match(vector<float> {6, 12}, results[2]));
+
+  EXPECT_TRUE(g.forward(vector<Node>()).empty());
+  EXPECT_TRUE(g.fetch({}).empty());
+}
+
+TEST_F(GraphTest, CheckAutobatching) {
+  Device::set_default(dev);
+
+  Parameter pw({2, 2}, {1, 2, 3, 4});
+  Parameter pb({2}, {1, -1});
+  const vector<vector<float>> inputs {
+    {1, 0}, {0, 1}, {1, 1}, {2, -1}, {-1, -2},
+  };
+  // Each sample is calculated separately, and some of them have extra
+  // operators to make different depths.
+  const auto build = [&](Graph &g, std::uint32_t *num_forward) {
+    Graph::set_default(g);
+    const Node w = functions::parameter<Node>(pw);
+    const Node b = functions::parameter<Node>(pb);
+    vector<Node> ys;
+    for (std::uint32_t i = 0; i < inputs.size(); ++i) {
+      Node x = functions::input<Node>({2}, inputs[i]);
+      if (i % 2 == 1) x = 2 * x;
+      const Node h = functions::tanh(functions::matmul(w, x) + b);
+      ys.emplace_back(batchable_counter(h, num_forward));
+    }
+    ys.emplace_back(
+        functions::sum(functions::concat({ys[0], ys[2], ys[4]}, 0), 0));
+    return ys;
+  };
+
+  Graph g1;
+  std::uint32_t num_forward1 = 0;
+  const vector<Node> ys1 = build(g1, &num_forward1);
+  const vector<vector<float>> expected = g1.fetch(ys1);
+  EXPECT_EQ(5u, num_forward1);
+
+  Graph g2;
+  EXPECT_FALSE(g2.is_autobatching());
+  g2.set_autobatching(true);
+  EXPECT_TRUE(g2.is_autobatching());
+  std::uint32_t num_forward2 = 0;
+  const vector<Node> ys2 = build(g2, &num_forward2);
+  const vector<vector<float>> observed = g2.fetch(ys2);
+  // Samples with and without the extra operator make two groups.
+  EXPECT_EQ(2u, num_forward2);
+  ASSERT_EQ(expected.size(), observed.size());
+  for (std::uint32_t i = 0; i < expected.size(); ++i) {
+    EXPECT_TRUE(vector_near(expected[i], observed[i], 1e-6));
+    EXPECT_EQ(ys1[i].shape(), ys2[i].shape());
+  }
+
+  // The backward operation is not affected by the batching.
+  pw.reset_gradient();
+  g1.backward(ys1.back());
+  const vector<float> expected_gw = pw.gradient().to_vector();
+  pw.reset_gradient();
+  g2.backward(ys2.back());
+  EXPECT_TRUE(vector_near(expected_gw, pw.gradient().to_vector(), 1e-6));
+}
+
+TEST_F(GraphTest, CheckCaptureReplay) {
+  Device::set_default(dev);
+
+  Graph g;
+  Graph::set_default(g);
+
+  Parameter pw({2, 2}, {1, 2, 3, 4});
+  Parameter pw2({2, 2}, {0, 1, 1, 0});
+  const Node x = functions::input<Node>({2}, {1, 1});
+  const Node w = functions::parameter<Node>(pw);
+  const Node y = functions::matmul(w, x) + 1;
+  const Node z = functions::sum(y, 0);
+  const std::uint32_t num_ops = g.num_operators();
+
+  EXPECT_THROW(g.replay(), Error);
+  g.capture({z});
+  EXPECT_FLOAT_EQ(12, z.to_float());
+
+  g.bind_input(x, {1, 0});
+  g.replay();
+  EXPECT_TRUE(vector_match(vector<float> {2, 3}, y.to_vector()));
+  EXPECT_FLOAT_EQ(5, z.to_float());
+  EXPECT_EQ(num_ops, g.num_operators());
+
+  // Parameters are read at every replay.
+  pw.value().reset(2);
+  g.replay();
+  EXPECT_FLOAT_EQ(6, z.to_float());
+
+  g.bind_parameter(w, pw2);
+  g.replay();
+  EXPECT_FLOAT_EQ(3, z.to_float());
+
+  pw2.reset_gradient();
+  z.backward();
+  EXPECT_TRUE(vector_match(
+        vector<float> {1, 1, 0, 0}, pw2.gradient().to_vector()));
+
+  Parameter pv({3}, {1, 2, 3});
+  EXPECT_THROW(g.bind_input(x, {1, 2, 3}), Error);
+  EXPECT_THROW(g.bind_input(w, {1, 2}), Error);
+  EXPECT_THROW(g.bind_parameter(x, pw), Error);
+  EXPECT_THROW(g.bind_parameter(w, pv), Error);
+
+  g.clear();
+  EXPECT_THROW(g.replay(), Error);
+}
+
+TEST_F(GraphTest, CheckSaveLoadPlan) {
+  Device::set_default(dev);
+  const string path = "/tmp/primitiv_GraphTest_CheckSaveLoadPlan.data";
+
+  Parameter pw({2, 2}, {1, 2, 3, 4});
+  Model m;
+  m.add("w", pw);
+
+  Graph g1;
+  Graph::set_default(g1);
+  const Node x = functions::input<Node>({2}, {1, 1});
+  const Node w = functions::parameter<Node>(pw);
+  const Node y = functions::tanh(functions::matmul(w, x) * .1f) + 1;
+  const Node z = functions::sum(functions::slice(y, 0, 1, 2), 0);
+
+  EXPECT_THROW(g1.save_plan(path, m), Error);
+  g1.capture({y, z});
+  ASSERT_NO_THROW(g1.save_plan(path, m));
+  const vector<float> y1 = y.to_vector();
+  const float z1 = z.to_float();
+
+  {
+    Graph g2;
+    vector<Node> inputs;
+    const vector<Node> targets = g2.load_plan(path, m, inputs);
+    ASSERT_EQ(2u, targets.size());
+    ASSERT_EQ(1u, inputs.size());
+    EXPECT_EQ(Shape({2}), targets[0].shape());
+    EXPECT_EQ(Shape(), targets[1].shape());
+    EXPECT_EQ(g1.plan_size(), g2.plan_size());
+
+    g2.replay();
+    EXPECT_TRUE(vector_match(y1, targets[0].to_vector()));
+    EXPECT_FLOAT_EQ(z1, targets[1].to_float());
+
+    g1.bind_input(x, {1, 0});
+    g1.replay();
+    g2.bind_input(inputs[0], {1, 0});
+    g2.replay();
+    EXPECT_TRUE(vector_match(y.to_vector(), targets[0].to_vector()));
+    EXPECT_FLOAT_EQ(z.to_float(), targets[1].to_float());
+
+    // Parameters are referred by their keys in the model.
+    Parameter pw2({2, 2}, {0, 0, 0, 0});
+    Model m2;
+    m2.add("w", pw2);
+    const vector<Node> targets2 = g2.load_plan(path, m2, inputs);
+    g2.replay();
+    EXPECT_TRUE(vector_match(vector<float> {1, 1}, targets2[0].to_vector()));
+
+    Parameter pv({3}, {1, 2, 3});
+    Model m3;
+    m3.add("w", pv);
+    EXPECT_THROW(g2.load_plan(path, m3, inputs), Error);
+    Model m4;
+    EXPECT_THROW(g2.load_plan(path, m4, inputs), Error);
+  }
+
+  // Parameters should be registered in the model.
+  Model m5;
+  EXPECT_THROW(g1.save_plan(path, m5), Error);
+
+  // Some operators can not be serialized.
+  const Node d = g1.detach({y})[0];
+  g1.capture({functions::exp(d)});
+  EXPECT_THROW(g1.save_plan(path, m), Error);
+
+  std::remove(path.c_str());
+}
+
+TEST_F(GraphTest, CheckOperatorFusion) {
+  Device::set_default(dev);
+
+  Parameter pw({2, 2}, {1, -2, 3, -4});
+  Parameter pb({2}, {.5, -.5});
+  const auto build = [&](Graph &g, Node &x) {
+    Graph::set_default(g);
+    x = functions::input<Node>(Shape({2}, 2), {1, 2, -1, .5});
+    const Node w = functions::parameter<Node>(pw);
+    const Node b = functions::parameter<Node>(pb);
+    const Node h = functions::tanh(functions::matmul(w, x) + b);
+    const Node c = functions::sigmoid(h) * functions::exp(-h) / 2;
+    return functions::batch::sum(functions::sum(c * h + 1, 0));
+  };
+
+  Graph g1;
+  Node x1;
+  const Node y1 = build(g1, x1);
+  g1.capture({y1});
+  EXPECT_FALSE(g1.is_operator_fusion());
+  EXPECT_EQ(13u, g1.plan_size());
+
+  // `h` is used by multiple operators and is not fused into its users.
+  // input, matmul, [add, tanh], [sigmoid, ..., add_const], sum, batch_sum
+  Graph g2;
+  g2.set_operator_fusion(true);
+  EXPECT_TRUE(g2.is_operator_fusion());
+  Node x2;
+  const Node y2 = build(g2, x2);
+  g2.capture({y2});
+  EXPECT_EQ(6u, g2.plan_size());
+
+  Graph g3;
+  g3.set_operator_fusion(true);
+  g3.set_memory_planning(true);
+  Node x3;
+  const Node y3 = build(g3, x3);
+  g3.capture({y3});
+  EXPECT_EQ(6u, g3.plan_size());
+
+  for (const vector<float> &data : {
+      vector<float> {1, 2, -1, .5}, vector<float> {0, -3, 2, 1}}) {
+    g1.bind_input(x1, data);
+    g2.bind_input(x2, data);
+    g3.bind_input(x3, data);
+    g1.replay();
+    g2.replay();
+    g3.replay();
+    EXPECT_NEAR(y1.to_float(), y2.to_float(), 1e-5);
+    EXPECT_NEAR(y1.to_float(), y3.to_float(), 1e-5);
+  }
+
+  // Intermediate values are recalculated by original operators.
+  pw.reset_gradient();
+  y1.backward();
+  const vector<float> expected = pw.gradient().to_vector();
+  pw.reset_gradient();
+  y2.backward();
+  EXPECT_TRUE(vector_near(expected, pw.gradient().to_vector(), 1e-5));
+
+  // Values of fused operators calculated before capturing are recalculated
+  // after replaying.
+  const auto build2 = [&](Graph &g, Node &x, Node &a) {
+    Graph::set_default(g);
+    x = functions::input<Node>({2}, {1, 2});
+    const Node w = functions::parameter<Node>(pw);
+    a = functions::tanh(functions::matmul(w, x));
+    return functions::sum(functions::exp(a) * 2 + 1, 0);
+  };
+  Graph g4, g5;
+  g5.set_operator_fusion(true);
+  Node x4, a4, x5, a5;
+  const Node y4 = build2(g4, x4, a4);
+  const Node y5 = build2(g5, x5, a5);
+  g5.forward(y5);
+  g4.capture({y4});
+  g5.capture({y5});
+  g4.bind_input(x4, {3, -1});
+  g5.bind_input(x5, {3, -1});
+  g4.replay();
+  g5.replay();
+  EXPECT_NEAR(y4.to_float(), y5.to_float(), 1e-5);
+  EXPECT_TRUE(vector_near(a4.to_vector(), a5.to_vector(), 1e-5));
+  pw.reset_gradient();
+  y4.backward();
+  const vector<float> expected2 = pw.gradient().to_vector();
+  pw.reset_gradient();
+  y5.backward();
+  EXPECT_TRUE(vector_near(expected2, pw.gradient().to_vector(), 1e-5));
+}
+
+TEST_F(GraphTest, CheckMemoryPlanning) {
+  Device::set_default(dev);
+
+  Parameter pw({4, 4}, {
+      .1, -.2, .3, -.4, .5, -.6, .7, -.8,
+      -.1, .2, -.3, .4, -.5, .6, -.7, .8});
+  const auto build = [&](Graph &g, Node &x) {
+    Graph::set_default(g);
+    x = functions::input<Node>({4}, {1, 2, 3, 4});
+    const Node w = functions::parameter<Node>(pw);
+    Node h = x;
+    for (std::uint32_t i = 0; i < 8; ++i) {
+      h = functions::tanh(functions::matmul(w, h) + 1) * .5;
+    }
+    return functions::sum(h, 0);
+  };
+
+  Graph g1;
+  Node x1;
+  const Node y1 = build(g1, x1);
+  g1.capture({y1});
+  EXPECT_FALSE(g1.is_memory_planning());
+  EXPECT_EQ(0u, g1.planned_memory_size());
+
+  Graph g2;
+  g2.set_memory_planning(true);
+  EXPECT_TRUE(g2.is_memory_planning());
+  Node x2;
+  const Node y2 = build(g2, x2);
+  g2.capture({y2});
+  // Each chain requires only two blocks of 64 bytes: the result of matmul()
+  // and its argument. Other elementwise operators work in-place.
+  EXPECT_EQ(2u * 16 * sizeof(float), g2.planned_memory_size());
+
+  for (const vector<float> &data : {
+      vector<float> {1, 2, 3, 4}, vector<float> {-1, 0, 2, -3}}) {
+    g1.bind_input(x1, data);
+    g2.bind_input(x2, data);
+    g1.replay();
+    g2.replay();
+    EXPECT_FLOAT_EQ(y1.to_float(), y2.to_float());
+  }
+
+  // Planned values are recalculated by the backpropagation.
+  pw.reset_gradient();
+  y1.backward();
+  const vector<float> expected = pw.gradient().to_vector();
+  pw.reset_gradient();
+  y2.backward();
+  EXPECT_TRUE(vector_match(expected, pw.gradient().to_vector()));
+}
+
+TEST_F(GraphTest, CheckProfiling) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+  EXPECT_FALSE(g.is_profiling());
+
+  Parameter pw({2}, {1, 2});
+  pw.reset_gradient();
+  const Node x = functions::input<Node>({2}, {3, 4});
+  const Node w = functions::parameter<Node>(pw);
+  const Node y = functions::sum(functions::tanh(w * x), 0);
+
+  // Nothing is recorded while the profiler is disabled.
+  y.to_float();
+  EXPECT_EQ(string::npos, g.dump("profile").find("Tanh"));
+
+  g.set_profiling(true);
+  EXPECT_TRUE(g.is_profiling());
+  g.capture({y});
+  g.replay();
+  y.backward();
+
+  const std::string profile = g.dump("profile");
+  EXPECT_NE(string::npos, profile.find("Tanh"));
+  EXPECT_NE(string::npos, profile.find("Multiply"));
+  EXPECT_NE(string::npos, profile.find("backward"));
+  EXPECT_NE(string::npos, profile.find("(total)"));
+
+  const std::string trace = g.dump("trace");
+  EXPECT_EQ(0u, trace.find("{\"traceEvents\":["));
+  EXPECT_NE(string::npos, trace.find("\"name\":\"Sum(0)\""));
+  EXPECT_NE(string::npos, trace.find("\"cat\":\"forward\""));
+  EXPECT_NE(string::npos, trace.find("\"cat\":\"backward\""));
+  EXPECT_NE(string::npos, trace.find("\"device\":\"Naive@"));
+  // `w * x` writes 2 floats and allocates one tensor.
+  EXPECT_NE(
+      string::npos, trace.find("\"bytes\":8,\"allocations\":1}"));
+
+  g.set_profiling(false);
+  g.clear_profile();
+  g.replay();
+  EXPECT_EQ(string::npos, g.dump("trace").find("\"name\""));
+  EXPECT_THROW(g.dump("unknown"), Error);
+}
+
+TEST_F(GraphTest, CheckMemoryTracking) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+  EXPECT_FALSE(g.is_memory_tracking());
+
+  g.set_memory_tracking(true);
+  EXPECT_TRUE(g.is_memory_tracking());
+
+  Parameter pw({2}, {1, 2});
+  pw.reset_gradient();
+  const Node x = functions::input<Node>({2}, {3, 4});
+  const Node w = functions::parameter<Node>(pw);
+  const Node y = functions::sum(w * x, 0);
+  y.to_float();
+
+  // `x` and `w * x` hold 2 floats, and `y` holds 1 float.
+  const Graph::MemoryUsage fw = g.memory_usage();
+  EXPECT_EQ(20u, fw.forward_bytes);
+  EXPECT_EQ(0u, fw.backward_bytes);
+  EXPECT_EQ(20u, fw.live_bytes);
+  EXPECT_EQ(20u, fw.peak_bytes);
+
+  y.backward();
+  const Graph::MemoryUsage bw = g.memory_usage();
+  EXPECT_EQ(20u, bw.forward_bytes);
+  EXPECT_LT(0u, bw.backward_bytes);
+  EXPECT_LE(fw.peak_bytes, bw.peak_bytes);
+
+  const std::string memory = g.dump("memory");
+  EXPECT_NE(string::npos, memory.find("peak bytes: "));
+  EXPECT_NE(string::npos, memory.find("Multiply"));
+  EXPECT_NE(string::npos, memory.find("Sum(0)"));
+  EXPECT_NE(string::npos, memory.find("backward"));
+
+  // `clear()` resets the statistics.
+  g.clear();
+  const Graph::MemoryUsage cleared = g.memory_usage();
+  EXPECT_EQ(0u, cleared.live_bytes);
+  EXPECT_EQ(0u, cleared.peak_bytes);
+  EXPECT_EQ(0u, cleared.forward_bytes);
+  EXPECT_EQ(0u, cleared.backward_bytes);
+
+  g.set_memory_tracking(false);
+  EXPECT_FALSE(g.is_memory_tracking());
+  EXPECT_EQ(0u, g.memory_usage().peak_bytes);
+}
+
+TEST_F(GraphTest, CheckLazyGradients) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+  g.set_memory_tracking(true);
+
+  Parameter pw({2}, {1, 2});
+  pw.reset_gradient();
+  const Node w = functions::parameter<Node>(pw);
+  const Node y = functions::sum(-w, 0) + functions::sum(w, 0);
+  y.backward();
+
+  // Gradients of arguments are not initialized by zeros. Only the gradient of
+  // `y` (4 bytes), the reduced gradient for the scalar argument of `+`
+  // (4 bytes), broadcasted gradients of both `sum` (8 * 2 bytes) and the
+  // negated gradient of `-w` (8 bytes) are allocated.
+  EXPECT_EQ(32u, g.memory_usage().backward_bytes);
+  EXPECT_TRUE(vector_match(vector<float> {0, 0}, pw.gradient().to_vector()));
+}
+
+TEST_F(GraphTest, CheckScan) {
+  struct Result {
+    std::uint32_t num_operators;
+    vector<float> h, hs, gw, gh0, gxs;
+  };
+
+  // h[t + 1] = tanh(W . h[t] + c * x[t])
+  const auto run = [](bool use_scan) {
+    devices::Naive dev;
+    Device::set_default(dev);
+    Graph g;
+    Graph::set_default(g);
+    Parameter pw({2, 2}, {.1, -.2, .3, .4});
+    Parameter ph0({2}, {.5, -.5});
+    Parameter pxs({1, 4}, {1, 2, -1, -2});
+    Parameter pc({2}, {1, -1});
+    for (Parameter *p : {&pw, &ph0, &pxs, &pc}) p->reset_gradient();
+
+    const auto step = [&](const vector<Node> &states, const Node &x) {
+      const Node w = functions::parameter<Node>(pw);
+      const Node c = functions::parameter<Node>(pc);
+      return vector<Node> {
+        functions::tanh(functions::matmul(w, states[0]) + c * x) };
+    };
+    const Node h0 = functions::parameter<Node>(ph0);
+    const Node xs = functions::parameter<Node>(pxs);
+    Node h, hs;
+    if (use_scan) {
+      const vector<Node> ret = functions::scan(step, {h0}, xs, 1);
+      EXPECT_EQ(2u, ret.size());
+      h = ret[0];
+      hs = ret[1];
+    } else {
+      vector<Node> seq;
+      h = h0;
+      for (std::uint32_t t = 0; t < 4; ++t) {
+        h = step({h}, functions::slice(xs, 1, t, t + 1))[0];
+        seq.emplace_back(h);
+      }
+      hs = functions::concat(seq, 1);
+    }
+    // Uses both results.
+    const Node y = functions::sum(functions::flatten(hs), 0)
+      + 2 * functions::sum(h, 0);
+    g.backward(y);
+
+    return Result {
+      g.num_operators(), h.to_vector(), hs.to_vector(),
+      pw.gradient().to_vector(), ph0.gradient().to_vector(),
+      pxs.gradient().to_vector() };
+  };
+
+  const Result expected = run(false);
+  const Result actual = run(true);
+  EXPECT_GT(expected.num_operators, actual.num_operators);
+  EXPECT_EQ(Shape({2, 4}).size(), actual.hs.size());
+  EXPECT_TRUE(vector_near(expected.h, actual.h, 1e-5));
+  EXPECT_TRUE(vector_near(expected.hs, actual.hs, 1e-5));
+  EXPECT_TRUE(vector_near(expected.gw, actual.gw, 1e-5));
+  EXPECT_TRUE(vector_near(expected.gh0, actual.gh0, 1e-5));
+  EXPECT_TRUE(vector_near(expected.gxs, actual.gxs, 1e-5));
+}
+
+TEST_F(GraphTest, CheckInvalidScan) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+  const Node h0 = functions::input<Node>({2}, {1, 2});
+  const Node xs = functions::input<Node>({2, 3}, {1, 2, 3, 4, 5, 6});
+  const auto identity = [](const vector<Node> &states, const Node &) {
+    return states;
+  };
+  const auto wrong_shape = [](const vector<Node> &, const Node &x) {
+    return vector<Node> { x };
+  };
+  const auto wrong_size = [](const vector<Node> &states, const Node &) {
+    return vector<Node> { states[0], states[0] };
+  };
+  EXPECT_THROW(functions::scan(identity, {}, xs, 1), Error);
+  EXPECT_THROW(functions::scan(wrong_size, {h0}, xs, 1), Error);
+  EXPECT_THROW(functions::scan(identity, {h0}, xs, Shape::MAX_DEPTH), Error);
+  // Steps of `xs` along the dimension 0 have the shape [1, 3].
+  EXPECT_THROW(functions::scan(wrong_shape, {h0}, xs, 0), Error);
+
+  // Nodes created by the step function do not belong to `g`.
+  const std::uint32_t num_operators = g.num_operators();
+  const vector<Node> ret = functions::scan(identity, {h0}, xs, 1);
+  EXPECT_EQ(num_operators + 1, g.num_operators());
+  EXPECT_TRUE(vector_match(vector<float> {1, 2}, ret[0].to_vector()));
+  EXPECT_TRUE(vector_match(
+        vector<float> {1, 2, 1, 2, 1, 2}, ret[1].to_vector()));
+  EXPECT_EQ(&g, &Graph::get_default());
+}
+
+TEST_F(GraphTest, CheckScanRequiresGrad) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+  Parameter pw({2}, {1, 2});
+  pw.reset_gradient();
+  const Node h0 = functions::input<Node>({2}, {1, 2});
+  const Node xs = functions::input<Node>({2, 3}, {1, 2, 3, 4, 5, 6});
+  const auto plain = [](const vector<Node> &states, const Node &x) {
+    return vector<Node> { states[0] + x };
+  };
+  const auto weighted = [&](const vector<Node> &states, const Node &x) {
+    return vector<Node> { functions::parameter<Node>(pw) * states[0] + x };
+  };
+
+  // The backward operation skips steps without trainable values.
+  std::uint32_t num_backward1 = 0, num_backward2 = 0;
+  const Node h1 = counter(
+      functions::scan(plain, {h0}, xs, 1)[0], &num_backward1);
+  const Node h2 = counter(
+      functions::scan(weighted, {h0}, xs, 1)[0], &num_backward2);
+  const Node w = functions::parameter<Node>(pw);
+  g.backward(functions::sum(w * h1 + h2, 0));
+  EXPECT_EQ(0u, num_backward1);
+  EXPECT_EQ(1u, num_backward2);
+}
+
+TEST_F(GraphTest, CheckParallelScan) {
+  struct Result {
+    vector<float> y, gw;
+  };
+
+  // Independent scans are executed by multiple threads.
+  const auto run = [](std::uint32_t num_threads) {
+    devices::Naive dev;
+    Device::set_default(dev);
+    Parameter pw({2, 2}, {.1, -.2, .3, .4});
+    pw.reset_gradient();
+    Graph g;
+    g.set_num_threads(num_threads);
+    Graph::set_default(g);
+
+    const auto step = [&](const vector<Node> &states, const Node &x) {
+      const Node w = functions::parameter<Node>(pw);
+      return vector<Node> {
+        functions::tanh(functions::matmul(w, states[0]) + x) };
+    };
+    vector<Node> hs;
+    for (std::uint32_t i = 0; i < 8; ++i) {
+      const float k = .1 * i;
+      const Node h0 = functions::input<Node>({2}, {k, -k});
+      const Node xs = functions::input<Node>({1, 4}, {k, 1, -k, -1});
+      hs.emplace_back(functions::scan(step, {h0}, xs, 1)[0]);
+    }
+    const Node y = functions::sum(functions::sum(hs), 0);
+
+    Result ret;
+    ret.y = y.to_vector();
+    g.backward(y);
+    ret.gw = pw.gradient().to_vector();
+    return ret;
+  };
+
+  const Result expected = run(0);
+  for (const std::uint32_t n : {2u, 4u}) {
+    const Result actual = run(n);
+    EXPECT_TRUE(vector_near(expected.y, actual.y, 1e-5));
+    EXPECT_TRUE(vector_near(expected.gw, actual.gw, 1e-5));
+  }
+}
+
+TEST_F(GraphTest, CheckBackwardPruning) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+
+  std::uint32_t count_x = 0, count_w = 0, count_other = 0;
+  Parameter pw({2}, {1, 2});
+  pw.reset_gradient();
+  const Node x = counter(functions::input<Node>({2}, {3, 4}), &count_x);
+  const Node w = counter(functions::parameter<Node>(pw), &count_w);
+  const Node other = counter(w * 2, &count_other);
+  const Node y = functions::sum(w * x + x * x, 0);
+  EXPECT_FLOAT_EQ(36, y.to_float());
+  EXPECT_FLOAT_EQ(6, functions::sum(other, 0).to_float());
+
+  g.backward(y);
+  EXPECT_EQ(0u, count_x);
+  EXPECT_EQ(1u, count_w);
+  EXPECT_EQ(0u, count_other);
+  EXPECT_TRUE(vector_match(vector<float> {3, 4}, pw.gradient().to_vector()));
+
+  // The output which does not depend on any parameters.
+  g.backward(functions::sum(x, 0));
+  EXPECT_EQ(0u, count_x);
+  EXPECT_EQ(1u, count_w);
+  EXPECT_TRUE(vector_match(vector<float> {3, 4}, pw.gradient().to_vector()));
+}
+
+TEST_F(GraphTest, CheckDetach) {
+  Device::set_default(dev);
+
+  Graph g;
+  Graph::set_default(g);
+
+  Parameter pw({}, {2});
+  Node h = functions::input<Node>({2}, {1, 2});
+  float expected = 1;
+  for (std::uint32_t step = 0; step < 10; ++step) {
+    const Node w = functions::parameter<Node>(pw);
+    h = functions::tanh(h) * w + 1;
+    const vector<Node> detached = g.detach({h, h});
+    ASSERT_EQ(2u, detached.size());
+    EXPECT_EQ(1u, g.num_operators());
+    EXPECT_EQ(detached[0].operator_id(), detached[1].operator_id());
+    h = detached[0];
+    expected = std::tanh(expected) * 2 + 1;
+    EXPECT_FLOAT_EQ(expected, h.to_vector()[0]);
+    EXPECT_EQ(Shape({2}), h.shape());
+    EXPECT_EQ(&dev, &h.device());
+  }
+
+  // Gradients are not propagated beyond detached nodes.
+  const Node w = functions::parameter<Node>(pw);
+  const Node y = functions::sum(h * w, 0);
+  pw.reset_gradient();
+  EXPECT_NO_THROW(y.backward());
+  EXPECT_EQ(4u, g.num_operators());
+  EXPECT_FLOAT_EQ(
+      h.to_vector()[0] + h.to_vector()[1], pw.gradient().to_float());
+}
+
+TEST_F(GraphTest, CheckCheckpointing) {
+  Device::set_default(dev);
+
+  struct Result {
+    vector<float> y, gw;
+  };
+
+  // Makes an RNN-like chain whose each step is a checkpointing segment.
+  const auto run = [&](bool checkpointing, std::uint32_t *num_forward) {
+    Parameter pw({2, 2}, {.1, .2, .3, .4});
+    pw.reset_gradient();
+    Graph g;
+    Graph::set_default(g);
+    EXPECT_FALSE(g.is_checkpointing());
+
+    const Node w = functions::parameter<Node>(pw);
+    Node h = functions::input<Node>({2}, {1, -1});
+    for (std::uint32_t i = 0; i < 10; ++i) {
+      g.set_checkpointing(checkpointing);
+      EXPECT_EQ(checkpointing, g.is_checkpointing());
+      const Node x = functions::input<Node>({2}, {.1f * i, .2f * i});
+      const Node a = counter(functions::matmul(w, h) + x, nullptr, num_forward);
+      g.set_checkpointing(false);
+      h = functions::tanh(a);
+    }
+    const Node y = functions::sum(h, 0);
+
+    Result ret;
+    ret.y = y.to_vector();
+    g.backward(y);
+    ret.gw = pw.gradient().to_vector();
+    return ret;
+  };
+
+  std::uint32_t num_forward1 = 0, num_forward2 = 0;
+  const Result expected = run(false, &num_forward1);
+  const Result actual = run(true, &num_forward2);
+  EXPECT_TRUE(vector_match(expected.y, actual.y));
+  EXPECT_TRUE(vector_match(expected.gw, actual.gw));
+
+  // Each value in the checkpointing segments is calculated twice.
+  EXPECT_EQ(10u, num_forward1);
+  EXPECT_EQ(20u, num_forward2);
+}
+
+TEST_F(GraphTest, CheckSubexpressionSharing) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+  EXPECT_FALSE(g.is_subexpression_sharing());
+
+  Parameter pw({2}, {1, 2});
+  pw.reset_gradient();
+  const Node w1 = functions::parameter<Node>(pw);
+  const Node w2 = functions::parameter<Node>(pw);
+  EXPECT_NE(w1.operator_id(), w2.operator_id());
+
+  g.set_subexpression_sharing(true);
+  EXPECT_TRUE(g.is_subexpression_sharing());
+  const Node w3 = functions::parameter<Node>(pw);
+  const Node w4 = functions::parameter<Node>(pw);
+  EXPECT_NE(w2.operator_id(), w3.operator_id());
+  EXPECT_EQ(w3.operator_id(), w4.operator_id());
+
+  // Inputs and random numbers are never shared.
+  const Node x1 = functions::input<Node>({2}, {3, 4});
+  const Node x2 = functions::input<Node>({2}, {3, 4});
+  EXPECT_NE(x1.operator_id(), x2.operator_id());
+  const Node r1 = functions::random::uniform<Node>({2}, 0, 1);
+  const Node r2 = functions::random::uniform<Node>({2}, 0, 1);
+  EXPECT_NE(r1.operator_id(), r2.operator_id());
+
+  const Node y1 = w3 * x1;
+  const Node y2 = w4 * x1;
+  const Node y3 = w3 * x2;
+  EXPECT_EQ(y1.operator_id(), y2.operator_id());
+  EXPECT_NE(y1.operator_id(), y3.operator_id());
+
+  const Node z1 = y1 + 1;
+  const Node z2 = y2 + 1;
+  const Node z3 = y1 + 2;
+  EXPECT_EQ(z1.operator_id(), z2.operator_id());
+  EXPECT_NE(z1.operator_id(), z3.operator_id());
+  EXPECT_EQ(11u, g.num_operators());
+
+  g.backward(functions::sum(y1 + y2, 0));
+  EXPECT_TRUE(vector_match(vector<float> {6, 8}, pw.gradient().to_vector()));
+
+  g.clear();
+  const Node w5 = functions::parameter<Node>(pw);
+  EXPECT_EQ(0u, w5.operator_id());
+}
+
+TEST_F(GraphTest, CheckSubexpressionSharingAfterBindParameter) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+  g.set_subexpression_sharing(true);
+
+  Parameter pw1({2}, {1, 2});
+  Parameter pw2({2}, {3, 4});
+  const Node w1 = functions::parameter<Node>(pw1);
+  g.bind_parameter(w1, pw2);
+  EXPECT_TRUE(vector_match(vector<float> {3, 4}, w1.to_vector()));
+
+  // The rebound node is not returned for either parameter.
+  const Node w2 = functions::parameter<Node>(pw1);
+  EXPECT_NE(w1.operator_id(), w2.operator_id());
+  EXPECT_TRUE(vector_match(vector<float> {1, 2}, w2.to_vector()));
+  const Node w3 = functions::parameter<Node>(pw2);
+  EXPECT_NE(w1.operator_id(), w3.operator_id());
+  EXPECT_TRUE(vector_match(vector<float> {3, 4}, w3.to_vector()));
+
+  // New nodes are shared again.
+  const Node w4 = functions::parameter<Node>(pw1);
+  EXPECT_EQ(w2.operator_id(), w4.operator_id());
+}
+
+TEST_F(GraphTest, CheckConstantFolding) {
+  Device::set_default(dev);
+  Graph g;
+  Graph::set_default(g);
+  EXPECT_FALSE(g.is_constant_folding());
+  g.set_constant_folding(true);
+  EXPECT_TRUE(g.is_constant_folding());
+
+  std::uint32_t num_forward1 = 0, num_forward2 = 0;
+  const Node a = functions::ones<Node>({2});
+  const Node b = counter(a * 2 + a, nullptr, &num_forward1);
+  EXPECT_EQ(1u, num_forward1);
+
+  const Node x = functions::input<Node>({2}, {1, 2});
+  const Node c = counter(x + b, nullptr, &num_forward2);
+  EXPECT_EQ(0u, num_forward2);
+
+  Parameter pw({2}, {3, 4});
+  pw.reset_gradient();
+  const Node y = functions::sum(functions::parameter<Node>(pw) * b + c, 0);
+  EXPECT_FLOAT_EQ(30, y.to_float());
+  EXPECT_EQ(1u, num_forward1);
+  EXPECT_EQ(1u, num_forward2);
+
+  // `b` is released after forwarding `y`, and recalculated by `backward()`.
+  g.backward(y);
+  EXPECT_EQ(2u, num_forward1);
+  EXPECT_TRUE(vector_match(vector<float> {3, 3}, pw.gradient().to_vector()));
+}
+
+TEST_F(GraphTest, CheckNumThreads) {
+  Graph g;
+  EXPECT_EQ(0u, g.num_threads());
+  EXPECT_FALSE(g.is_deterministic());
+  g.set_num_threads(4);
+  EXPECT_EQ(4u, g.num_threads());
+  g.set_deterministic(true);
+  EXPECT_TRUE(g.is_deterministic());
+  g.set_num_threads(0);
+  EXPECT_EQ(0u, g.num_threads());
+}
+
+TEST_F(GraphTest, CheckParallelForwardBackward) {
+  struct Result {
+    vector<float> y, gw, gb;
+  };
+
+  // Makes a graph with many independent branches sharing some values.
+  const auto run = [](std::uint32_t num_threads, bool deterministic) {
+    devices::Naive dev(12345);
+    Device::set_default(dev);
+    Parameter pw({4, 4}, initializers::Uniform(-1, 1));
+    Parameter pb({4}, initializers::Uniform(-1, 1));
+    pw.reset_gradient();
+    pb.reset_gradient();
+    Graph g;
+    g.set_num_threads(num_threads);
+    g.set_deterministic(deterministic);
+    Graph::set_default(g);
+
+    const Node x = functions::input<Node>(
+        Shape({4}, 2), {1, 2, 3, 4, -1, -2, -3, -4});
+    const Node w = functions::parameter<Node>(pw);
+    const Node b = functions::parameter<Node>(pb);
+    vector<Node> hs;
+    for (std::uint32_t i = 0; i < 16; ++i) {
+      Node h = x;
+      for (std::uint32_t j = 0; j <= i % 4; ++j) {
+        h = functions::tanh(functions::matmul(w, h) + b);
+      }
+      hs.emplace_back(h * static_cast<float>(i + 1));
+    }
+    const Node y = functions::batch::sum(functions::sum(hs));
+    const Node z = functions::sum(y, 0);
+
+    Result ret;
+    ret.y = y.to_vector();
+    g.backward(z);
+    ret.gw = pw.gradient().to_vector();
+    ret.gb = pb.gradient().to_vector();
+    return ret;
+  };
+
+  const Result expected = run(0, false);
+  for (const std::uint32_t n : {1u, 2u, 4u}) {
+    for (const bool deterministic : {false, true}) {
+      const Result actual = run(n, deterministic);
+      EXPECT_TRUE(vector_near(expected.y, actual.y, 1e-3));
+      EXPECT_TRUE(vector_near(expected.gw, actual.gw, 1e-3));
+      EXPECT_TRUE(vector_near(expected.gb, actual.gb, 1e-3));
+      if (deterministic) {
+        EXPECT_TRUE(vector_match(expected.gw, actual.gw));
+        EXPECT_TRUE(vector_match(expected.gb, actual.gb));
+      }
+    }
+  }
+}
+
+TEST_F(GraphTest, CheckParallelBackwardSharedGradient) {
+  // Makes many operators writing the gradient of the same node.
+  const auto run = [](std::uint32_t num_threads) {
+    devices::Naive dev(12345);
+    Device::set_default(dev);
+    Parameter pw({4}, {1, 2, 3, 4});
+    pw.reset_gradient();
+    Graph g;
+    g.set_num_threads(num_threads);
+    Graph::set_default(g);
+
+    std::uint32_t num_backward = 0;
+    const Node x = functions::input<Node>({4}, {1, -1, 2, -2});
+    const Node h = functions::tanh(functions::parameter<Node>(pw) * x);
+    vector<Node> ys;
+    for (std::uint32_t i = 0; i < 256; ++i) {
+      // Includes operators which do not accept invalid gradients.
+      const Node hi = i % 2 ? h : counter(h, &num_backward);
+      ys.emplace_back(functions::sum(hi * static_cast<float>(i % 8), 0));
+    }
+    g.backward(functions::sum(ys));
+    EXPECT_EQ(128u, num_backward);
+    return pw.gradient().to_vector();
+  };
+
+  const vector<float> expected = run(0);
+  for (const std::uint32_t n : {2u, 4u, 8u}) {
+    EXPECT_TRUE(vector_near(expected, run(n), 1e-3));
+  }
+}
+
+TEST_F(GraphTest, CheckParallelBackwardCheckpointing) {
+  for (const std::uint32_t num_threads : {0u, 4u}) {
+    Device::set_default(dev);
+    Parameter pw({2}, {1, 2});
+    pw.reset_gradient();
+    Graph g;
+    g.set_num_threads(num_threads);
+    Graph::set_default(g);
+
+    // `a` does not require gradients, but is recalculated for the backward
+    // operation of the multiplication.
+    std::uint32_t num_forward = 0;
+    const Node x = functions::input<Node>({2}, {3, 4});
+    g.set_checkpointing(true);
+    const Node a = counter(x * 2, nullptr, &num_forward);
+    g.set_checkpointing(false);
+    const Node y = functions::sum(functions::parameter<Node>(pw) * a, 0);
+    EXPECT_FLOAT_EQ(22, y.to_float());
+    EXPECT_EQ(1u, num_forward);
+
+    g.backward(y);
+    EXPECT_EQ(2u, num_forward);
+    EXPECT_TRUE(vector_match(vector<float> {6, 8}, pw.gradient().to_vector()));
+
+    // The recalculated value is released again.
+    EXPECT_TRUE(vector_match(vector<float> {6, 8}, a.to_vector()));
+    EXPECT_EQ(3u, num_forward);
+  }
+}
+
+TEST_F(GraphTest, CheckParallelInferenceMode) {
+  Device::set_default(dev);
+  Graph g;
+  g.set_num_threads(4);
+  g.set_inference_mode(true);
+  Graph::set_default(g);
+
+  const Node x = functions::input<Node>({2}, {1, 2});
+  vector<Node> ys;
+  for (std::uint32_t i = 0; i < 8; ++i) {
+    ys.emplace_back(x + static_cast<float>(i));
+  }
+  const Node y = functions::sum(ys);
+  EXPECT_TRUE(vector_match(vector<float> {36, 44}, y.to_vector()));
+  EXPECT_TRUE(vector_match(vector<float> {36, 44}, y.to_vector()));
+}
+
 TEST_F(GraphTest, CheckForwardBackward) {
   Device::set_default(dev);
 
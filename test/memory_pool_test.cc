@@ -0,0 +1,369 @@
+#include <primitiv/config.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <future>
+#include <vector>
+#include <gtest/gtest.h>
+#include <primitiv/error.h>
+#include <primitiv/memory_pool.h>
+
+using std::vector;
+
+namespace primitiv {
+
+class MemoryPoolTest : public testing::Test {
+protected:
+  vector<std::size_t> allocated;
+
+  // Functors that record sizes of allocated memories.
+  std::function<void *(std::size_t)> allocator = [this](std::size_t size) {
+    allocated.emplace_back(size);
+    return std::malloc(size);
+  };
+  std::function<void(void *)> deleter = [](void *ptr) { std::free(ptr); };
+};
+
+TEST_F(MemoryPoolTest, CheckEmptyAllocation) {
+  MemoryPool pool;
+  const auto sp1 = pool.allocate(0u);
+  const auto sp2 = pool.allocate(0u);
+  EXPECT_EQ(nullptr, sp1.get());
+  EXPECT_EQ(nullptr, sp2.get());
+}
+
+TEST_F(MemoryPoolTest, CheckAllocate) {
+  MemoryPool pool;
+  void *p1, *p2, *p3;
+  {
+    // Allocates new pointers.
+    const auto sp1 = pool.allocate(1llu);
+    const auto sp2 = pool.allocate(1llu << 8);
+    const auto sp3 = pool.allocate(1llu << 16);
+    p1 = sp1.get();
+    p2 = sp2.get();
+    p3 = sp3.get();
+  }
+  // sp1-3 are released at the end of above scope, but the raw pointer is kept
+  // in the pool object.
+  {
+    // Allocates existing pointers.
+    const auto sp1 = pool.allocate(1llu);
+    const auto sp2 = pool.allocate(1llu << 8);
+    const auto sp3 = pool.allocate(1llu << 16);
+    EXPECT_EQ(p1, sp1.get());
+    EXPECT_EQ(p2, sp2.get());
+    EXPECT_EQ(p3, sp3.get());
+    // Allocates other pointers.
+    const auto sp11 = pool.allocate(1llu);
+    const auto sp22 = pool.allocate(1llu << 8);
+    const auto sp33 = pool.allocate(1llu << 16);
+    EXPECT_NE(p1, sp11.get());
+    EXPECT_NE(p2, sp22.get());
+    EXPECT_NE(p3, sp33.get());
+  }
+}
+
+TEST_F(MemoryPoolTest, CheckAlignment) {
+  MemoryPool pool;
+  vector<std::shared_ptr<void>> sps;
+  for (std::size_t size = 1; size < (1 << 12); size = size * 3 + 1) {
+    sps.emplace_back(pool.allocate(size));
+    const auto addr = reinterpret_cast<std::uintptr_t>(sps.back().get());
+    EXPECT_EQ(0u, addr % MemoryPool::ALIGNMENT);
+  }
+}
+
+TEST_F(MemoryPoolTest, CheckInvalidAllocate) {
+  MemoryPool pool;
+  // Available maximum size of the memory: 2^63 bytes.
+  EXPECT_THROW(pool.allocate((1llu << 63) + 1), Error);
+}
+
+TEST_F(MemoryPoolTest, CheckSizeClasses) {
+  MemoryPool pool(allocator, deleter);
+  const vector<std::size_t> sizes {
+    1, 2, 3, 4, 5, 8, 9, 12, 13, 100, 1 << 16, (1 << 16) + 1, 1100000,
+  };
+  // 3 and 4 bytes share the same size class.
+  const vector<std::size_t> expected {
+    1, 2, 4, 5, 8, 10, 12, 14, 112, 1 << 16, 80 << 10, 1280 << 10,
+  };
+  for (const std::size_t size : sizes) pool.allocate(size);
+  EXPECT_EQ(expected, allocated);
+
+  // Memories in the same size class are shared.
+  allocated.clear();
+  pool.allocate(1200000);
+  pool.allocate(11);
+  EXPECT_EQ(vector<std::size_t> {}, allocated);
+}
+
+TEST_F(MemoryPoolTest, CheckSplitAndMerge) {
+  MemoryPool pool(allocator, deleter, true);
+  const std::size_t mib = 1 << 20;
+  void *p1 = pool.allocate(4 * mib).get();
+  char *head = static_cast<char *>(p1);
+  ASSERT_EQ(1u, allocated.size());
+  {
+    // Divides the free memory.
+    const auto sp1 = pool.allocate(mib + 1);
+    const auto sp2 = pool.allocate(2 * mib);
+    EXPECT_EQ(head, sp1.get());
+    EXPECT_EQ(head + 5 * mib / 4, sp2.get());
+    EXPECT_EQ(1u, allocated.size());
+    // The remainder (3/4 MiB) is too small.
+    const auto sp3 = pool.allocate(mib + 1);
+    EXPECT_EQ(2u, allocated.size());
+  }
+  // All divisions are merged again.
+  EXPECT_EQ(p1, pool.allocate(4 * mib).get());
+  EXPECT_EQ(2u, allocated.size());
+}
+
+TEST_F(MemoryPoolTest, CheckNotSplittable) {
+  MemoryPool pool(allocator, deleter);
+  const std::size_t mib = 1 << 20;
+  pool.allocate(4 * mib);
+  pool.allocate(2 * mib);
+  EXPECT_EQ(vector<std::size_t> ({4 * mib, 2 * mib}), allocated);
+}
+
+TEST_F(MemoryPoolTest, CheckReleaseSplitMemoryAfterPoolDestroyed) {
+  const std::size_t mib = 1 << 20;
+  std::shared_ptr<void> sp1, sp2;
+  {
+    MemoryPool pool(allocator, deleter, true);
+    pool.allocate(4 * mib);
+    sp1 = pool.allocate(2 * mib);
+    sp2 = pool.allocate(2 * mib);
+    EXPECT_EQ(1u, allocated.size());
+  }
+  // The whole memory is deleted when all divisions are released.
+  *static_cast<std::uint32_t *>(sp1.get()) = 42;
+  sp1.reset();
+  *static_cast<std::uint32_t *>(sp2.get()) = 42;
+  sp2.reset();
+  SUCCEED();
+}
+
+TEST_F(MemoryPoolTest, CheckStatistics) {
+  MemoryPool pool(allocator, deleter);
+  {
+    const auto sp1 = pool.allocate(100);
+    const auto sp2 = pool.allocate(100);
+  }
+  auto sp3 = pool.allocate(100);
+  const auto sp4 = pool.allocate(1 << 10);
+  const MemoryPool::Statistics stats = pool.get_statistics();
+  EXPECT_EQ(2 * 112u + 1024u, stats.allocated_bytes);
+  EXPECT_EQ(112u + 1024u, stats.in_use_bytes);
+  EXPECT_EQ(112u, stats.reserved_bytes);
+  EXPECT_EQ(2 * 112u + 1024u, stats.peak_allocated_bytes);
+  EXPECT_EQ(112u + 1024u, stats.peak_in_use_bytes);
+  ASSERT_EQ(2u, stats.classes.size());
+  const MemoryPool::ClassStatistics &c1 = stats.classes[0];
+  EXPECT_EQ(112u, c1.size);
+  EXPECT_EQ(1u, c1.in_use);
+  EXPECT_EQ(1u, c1.reserved);
+  EXPECT_EQ(1u, c1.hits);
+  EXPECT_EQ(2u, c1.misses);
+  EXPECT_EQ(2u, c1.peak);
+  const MemoryPool::ClassStatistics &c2 = stats.classes[1];
+  EXPECT_EQ(1024u, c2.size);
+  EXPECT_EQ(1u, c2.in_use);
+  EXPECT_EQ(0u, c2.reserved);
+  EXPECT_EQ(0u, c2.hits);
+  EXPECT_EQ(1u, c2.misses);
+  EXPECT_EQ(1u, c2.peak);
+
+  sp3.reset();
+  pool.reset_peaks();
+  EXPECT_EQ(1024u, pool.get_statistics().peak_in_use_bytes);
+  EXPECT_EQ(0u, pool.get_statistics().classes[0].peak);
+}
+
+TEST_F(MemoryPoolTest, CheckTrim) {
+  MemoryPool pool(allocator, deleter, true);
+  const std::size_t mib = 1 << 20;
+  {
+    const auto sp1 = pool.allocate(1 << 10);
+    const auto sp2 = pool.allocate(2 * mib);
+    const auto sp3 = pool.allocate(4 * mib);
+  }
+  EXPECT_EQ(6 * mib + 1024, pool.get_statistics().reserved_bytes);
+
+  // Larger memories are deleted first.
+  EXPECT_EQ(4 * mib, pool.trim(3 * mib));
+  EXPECT_EQ(2 * mib + 1024, pool.get_statistics().reserved_bytes);
+  EXPECT_EQ(0u, pool.trim(3 * mib));
+  EXPECT_EQ(2 * mib + 1024, pool.trim(0));
+  EXPECT_EQ(0u, pool.get_statistics().allocated_bytes);
+
+  // Divided chunks are not deleted while any divisions are in use.
+  pool.allocate(4 * mib);
+  const auto sp4 = pool.allocate(2 * mib);
+  EXPECT_EQ(0u, pool.trim(0));
+  EXPECT_EQ(4 * mib, pool.get_statistics().allocated_bytes);
+}
+
+TEST_F(MemoryPoolTest, CheckTrimOtherThreads) {
+  MemoryPool pool(allocator, deleter);
+  std::promise<void> cached, trimmed;
+  std::thread th([&] {
+    pool.allocate(1 << 10);
+    cached.set_value();
+    trimmed.get_future().wait();
+    // The cache of this thread was drained.
+    pool.allocate(1 << 10);
+  });
+  cached.get_future().wait();
+  // Memories cached by idle threads are also deleted.
+  EXPECT_EQ(1024u, pool.trim(0));
+  EXPECT_EQ(0u, pool.get_statistics().allocated_bytes);
+  trimmed.set_value();
+  th.join();
+  EXPECT_EQ(vector<std::size_t> ({1024, 1024}), allocated);
+}
+
+TEST_F(MemoryPoolTest, CheckConcurrentTrim) {
+  MemoryPool pool(allocator, deleter);
+  std::atomic<bool> stop(false);
+  std::thread trimmer([&] {
+    while (!stop) pool.trim(0);
+  });
+  vector<std::thread> threads;
+  for (std::uint32_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&pool, i] {
+      vector<std::shared_ptr<void>> sps;
+      for (std::uint32_t j = 0; j < 1000; ++j) {
+        sps.emplace_back(pool.allocate(((i + j) % 16 + 1) * 64));
+        *static_cast<std::uint32_t *>(sps.back().get()) = i;
+        if (j % 2 == 0) sps.erase(sps.begin());
+      }
+      for (const auto &sp : sps) {
+        EXPECT_EQ(i, *static_cast<const std::uint32_t *>(sp.get()));
+      }
+    });
+  }
+  for (std::thread &th : threads) th.join();
+  stop = true;
+  trimmer.join();
+  pool.trim(0);
+  EXPECT_EQ(0u, pool.get_statistics().allocated_bytes);
+}
+
+TEST_F(MemoryPoolTest, CheckTrimPolicy) {
+  MemoryPool pool(allocator, deleter);
+  EXPECT_THROW(pool.set_trim_policy(0, 0), Error);
+  pool.set_trim_policy(0, 1);
+  std::thread([&] { pool.allocate(1 << 24); }).join();
+  for (std::uint32_t i = 0; i < 1000; ++i) {
+    if (pool.get_statistics().allocated_bytes == 0) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(0u, pool.get_statistics().allocated_bytes);
+
+  // Memories cached by idle threads are also deleted.
+  std::promise<void> cached, trimmed;
+  std::thread th([&] {
+    pool.allocate(1 << 10);
+    cached.set_value();
+    trimmed.get_future().wait();
+  });
+  cached.get_future().wait();
+  for (std::uint32_t i = 0; i < 1000; ++i) {
+    if (pool.get_statistics().allocated_bytes == 0) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(0u, pool.get_statistics().allocated_bytes);
+  trimmed.set_value();
+  th.join();
+
+  // Policies can be replaced concurrently.
+  vector<std::thread> setters;
+  for (std::uint32_t i = 0; i < 4; ++i) {
+    setters.emplace_back([&pool] {
+      for (std::uint32_t j = 0; j < 10; ++j) pool.set_trim_policy(0, 1);
+    });
+  }
+  for (std::thread &setter : setters) setter.join();
+  pool.reset_trim_policy();
+  pool.allocate(1 << 24);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(1u << 24, pool.get_statistics().allocated_bytes);
+}
+
+TEST_F(MemoryPoolTest, CheckDanglingPointer) {
+  std::shared_ptr<void> sp;
+  {
+    MemoryPool pool;
+    sp = pool.allocate(16);
+  }
+  // The memory is still available, and is deleted when the pointer is
+  // released.
+  *static_cast<std::uint32_t *>(sp.get()) = 42;
+  sp.reset();
+  SUCCEED();
+}
+
+TEST_F(MemoryPoolTest, CheckThreadCache) {
+  MemoryPool pool;
+  void *p1 = nullptr;
+  std::thread th([&] {
+    {
+      const auto sp = pool.allocate(64);
+      p1 = sp.get();
+    }
+    // The memory is cached by this thread.
+    EXPECT_EQ(p1, pool.allocate(64).get());
+  });
+  th.join();
+
+  // Memories cached by the exited thread are returned to the pool.
+  EXPECT_EQ(p1, pool.allocate(64).get());
+}
+
+TEST_F(MemoryPoolTest, CheckReleaseOnAnotherThread) {
+  MemoryPool pool;
+  std::shared_ptr<void> sp = pool.allocate(1 << 10);
+  void *p1 = sp.get();
+  std::thread th([&] { sp.reset(); });
+  th.join();
+  EXPECT_EQ(p1, pool.allocate(1 << 10).get());
+
+  // Memories larger than the thread cache are returned to the pool directly.
+  const std::size_t large = 1 << 24;
+  void *p2 = pool.allocate(large).get();
+  std::thread([&] {
+    EXPECT_EQ(p2, pool.allocate(large).get());
+  }).join();
+}
+
+TEST_F(MemoryPoolTest, CheckConcurrentAllocate) {
+  MemoryPool pool;
+  const std::uint32_t num_threads = 8;
+  const std::uint32_t num_loops = 1000;
+  vector<std::thread> threads;
+  for (std::uint32_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&pool, i] {
+      vector<std::shared_ptr<void>> sps;
+      for (std::uint32_t j = 0; j < num_loops; ++j) {
+        sps.emplace_back(pool.allocate(((i + j) % 64 + 1) * 16));
+        *static_cast<std::uint32_t *>(sps.back().get()) = i;
+        if (j % 3 == 0) sps.erase(sps.begin());
+      }
+      for (const auto &sp : sps) {
+        EXPECT_EQ(i, *static_cast<const std::uint32_t *>(sp.get()));
+      }
+    });
+  }
+  for (std::thread &th : threads) th.join();
+}
+
+}  // namespace primitiv
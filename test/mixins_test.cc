@@ -1,5 +1,7 @@
 #include <primitiv/config.h>
 
+#include <thread>
+
 #include <gtest/gtest.h>
 #include <primitiv/mixins.h>
 
@@ -76,5 +78,67 @@ TEST_F(MixinsTest, CheckDefaultSettable) {
   EXPECT_EQ(&obj0, &TestClass::get_reference_or_default(&obj0));
 }
 
+TEST_F(MixinsTest, CheckThreadDefault) {
+  class TestClass : public DefaultSettable<TestClass> {};
+
+  TestClass obj0;
+  TestClass::set_default(obj0);
+  EXPECT_EQ(nullptr, TestClass::get_thread_default());
+
+  {
+    TestClass obj1;
+    TestClass::set_thread_default(obj1);
+    EXPECT_EQ(&obj1, TestClass::get_thread_default());
+    EXPECT_EQ(&obj1, &TestClass::get_default());
+    EXPECT_EQ(&obj1, &TestClass::get_reference_or_default(nullptr));
+
+    const TestClass *other_default = nullptr;
+    const TestClass *other_thread_default = &obj1;
+    std::thread th([&] {
+      other_default = &TestClass::get_default();
+      other_thread_default = TestClass::get_thread_default();
+    });
+    th.join();
+    EXPECT_EQ(&obj0, other_default);
+    EXPECT_EQ(nullptr, other_thread_default);
+
+    TestClass::reset_thread_default();
+    EXPECT_EQ(nullptr, TestClass::get_thread_default());
+    EXPECT_EQ(&obj0, &TestClass::get_default());
+
+    TestClass::set_thread_default(obj1);
+  }
+  EXPECT_EQ(nullptr, TestClass::get_thread_default());
+  EXPECT_EQ(&obj0, &TestClass::get_default());
+
+  std::thread th([] {
+    TestClass obj2;
+    TestClass::set_thread_default(obj2);
+    EXPECT_EQ(&obj2, &TestClass::get_default());
+  });
+  th.join();
+  EXPECT_EQ(&obj0, &TestClass::get_default());
+}
+
+namespace {
+
+class GlobalClass : public DefaultSettable<GlobalClass> {};
+
+// Destroyed at exit after the first use of thread slots in the test below.
+GlobalClass global_obj;
+
+}  // namespace
+
+TEST_F(MixinsTest, CheckGlobalDefaultSettable) {
+  GlobalClass::set_default(global_obj);
+  std::thread th([] {
+    GlobalClass::set_thread_default(global_obj);
+    EXPECT_EQ(&global_obj, GlobalClass::get_thread_default());
+  });
+  th.join();
+  GlobalClass::set_thread_default(global_obj);
+  EXPECT_EQ(&global_obj, &GlobalClass::get_default());
+}
+
 }  // namespace mixins
 }  // namespace primitiv
@@ -38,6 +38,43 @@ TEST_F(NaiveDeviceTest, CheckNewDelete) {
   SUCCEED();
 }
 
+TEST_F(NaiveDeviceTest, CheckMemoryPoolStatistics) {
+  devices::Naive dev;
+  MemoryPool *pool = dev.memory_pool();
+  ASSERT_NE(nullptr, pool);
+  {
+    const Tensor x = dev.new_tensor_by_constant(Shape({16, 16}), 1);
+    EXPECT_EQ(1024u, pool->get_statistics().in_use_bytes);
+  }
+  EXPECT_EQ(0u, pool->get_statistics().in_use_bytes);
+  EXPECT_EQ(1024u, pool->get_statistics().reserved_bytes);
+  EXPECT_EQ(1024u, pool->trim(0));
+  EXPECT_EQ(0u, pool->get_statistics().allocated_bytes);
+}
+
+TEST_F(NaiveDeviceTest, CheckNewDeleteWithoutMemoryPool) {
+  devices::Naive dev(12345, false);
+  EXPECT_EQ(nullptr, dev.memory_pool());
+  const Tensor x1 = dev.new_tensor_by_constant(Shape({16, 16}), 1);
+  const Tensor x2 = dev.new_tensor_by_constant(Shape({16, 16}), 2);
+  EXPECT_TRUE(vector_match(vector<float>(256, 1), x1.to_vector()));
+  EXPECT_TRUE(vector_match(vector<float>(256, 2), x2.to_vector()));
+}
+
+TEST_F(NaiveDeviceTest, CheckSetMemoryPoolEnabled) {
+  devices::Naive dev;
+  const Tensor x1 = dev.new_tensor_by_constant(Shape({16, 16}), 1);
+  dev.set_memory_pool_enabled(false);
+  EXPECT_EQ(nullptr, dev.memory_pool());
+  const Tensor x2 = dev.new_tensor_by_constant(Shape({16, 16}), 2);
+  dev.set_memory_pool_enabled(true);
+  EXPECT_NE(nullptr, dev.memory_pool());
+  const Tensor x3 = dev.new_tensor_by_constant(Shape({16, 16}), 3);
+  EXPECT_TRUE(vector_match(vector<float>(256, 1), x1.to_vector()));
+  EXPECT_TRUE(vector_match(vector<float>(256, 2), x2.to_vector()));
+  EXPECT_TRUE(vector_match(vector<float>(256, 3), x3.to_vector()));
+}
+
 TEST_F(NaiveDeviceTest, CheckDanglingTensor) {
   {
     Tensor x1;
@@ -2,10 +2,14 @@
 
 #include <algorithm>
 #include <cmath>
+#include <sstream>
+#include <string>
 #include <vector>
 #include <gtest/gtest.h>
 #include <primitiv/functions.h>
 #include <primitiv/initializer_impl.h>
+#include <primitiv/msgpack/reader.h>
+#include <primitiv/msgpack/writer.h>
 #include <primitiv/naive_device.h>
 #include <primitiv/operator_impl.h>
 #include <primitiv/parameter.h>
@@ -126,6 +130,41 @@ public:
     for (Tensor *x : arg_grads) x->reset(0);
   }
 
+  // Checks that invalid gradients are treated as 0 by `backward()`.
+  // This function assumes that `arg_grads` hold gradients accumulated into 0.
+  void check_lazy_gradients(
+      const Operator &node, const Tensor &cur_value, const Tensor &cur_grad) {
+    vector<Tensor> lazy_grads(arg_grads.size());
+    vector<Tensor *> lazy_grad_ptrs;
+    for (Tensor &g : lazy_grads) lazy_grad_ptrs.emplace_back(&g);
+    node.backward(arg_values, { &cur_value }, { &cur_grad }, lazy_grad_ptrs);
+    for (std::uint32_t i = 0; i < arg_grads.size(); ++i) {
+      if (lazy_grads[i].valid()) {
+        EXPECT_EQ(*arg_shapes[i], lazy_grads[i].shape());
+        EXPECT_TRUE(vector_match(
+              arg_grads[i]->to_vector(), lazy_grads[i].to_vector()));
+      } else {
+        EXPECT_TRUE(vector_match(
+              vector<float>(arg_shapes[i]->size(), 0),
+              arg_grads[i]->to_vector()));
+      }
+    }
+  }
+
+  // Checks that the operator is restored by `load_operator()`.
+  void check_serialization(const Operator &node) {
+    std::stringstream ss;
+    msgpack::Writer writer(ss);
+    ASSERT_NO_THROW(node.save(writer));
+    msgpack::Reader reader(ss);
+    std::string type;
+    reader >> type;
+    const std::unique_ptr<Operator> restored =
+      load_operator(type, reader, *dev);
+    EXPECT_EQ(node.name(), restored->name());
+    EXPECT_EQ(node.signature(), restored->signature());
+  }
+
 protected:
   void SetUp() override {
     dev = new devices::Naive(12345);
@@ -150,7 +189,9 @@ protected:
   node.forward_shape(arg_shapes, { &cur_shape }); \
   node.forward(arg_values, { &cur_value }); \
   const Tensor cur_grad = functions::ones<Tensor>(ret_shape, *dev); \
-  node.backward(arg_values, { &cur_value } , { &cur_grad }, arg_grads);
+  node.backward(arg_values, { &cur_value } , { &cur_grad }, arg_grads); \
+  check_lazy_gradients(node, cur_value, cur_grad); \
+  check_serialization(node);
 
 #define COMMON_CHECK \
   EXPECT_EQ(ret_shape, cur_shape); \
@@ -1827,5 +1868,34 @@ TEST_F(OperatorImplTest, CheckStopGradient) {
   TEST_1ARG(StopGradient);
 }
 
+TEST_F(OperatorImplTest, CheckSignature) {
+  primitiv::Parameter param1({2}, {1, 2}, *dev);
+  primitiv::Parameter param2({2}, {1, 2}, *dev);
+
+  // Operators without signatures.
+  EXPECT_EQ("", Input({2}, {1, 2}, *dev).signature());
+  EXPECT_EQ("", RandomUniform({2}, 0, 1, *dev).signature());
+  EXPECT_EQ("", RandomNormal({2}, 0, 1, *dev).signature());
+
+  // Operators with signatures.
+  EXPECT_NE("", Parameter(param1).signature());
+  EXPECT_EQ(Parameter(param1).signature(), Parameter(param1).signature());
+  EXPECT_NE(Parameter(param1).signature(), Parameter(param2).signature());
+  EXPECT_EQ(
+      Constant({2}, 1, *dev).signature(), Constant({2}, 1, *dev).signature());
+  EXPECT_NE(
+      Constant({2}, 1, *dev).signature(), Constant({3}, 1, *dev).signature());
+  EXPECT_NE(
+      Constant({2}, 1, *dev).signature(), Constant({2}, 2, *dev).signature());
+  EXPECT_EQ(Pick({0, 1}, 0).signature(), Pick({0, 1}, 0).signature());
+  EXPECT_NE(Pick({0, 1}, 0).signature(), Pick({1, 0}, 0).signature());
+  EXPECT_NE(Pick({0, 1}, 0).signature(), Pick({0, 1}, 1).signature());
+  EXPECT_EQ(AddConst(.1).signature(), AddConst(.1).signature());
+  EXPECT_NE(AddConst(.1).signature(), AddConst(.1000001).signature());
+  EXPECT_NE(AddConst(1).signature(), MultiplyConst(1).signature());
+  EXPECT_EQ(Add().signature(), Add().signature());
+  EXPECT_NE(Add().signature(), Subtract().signature());
+}
+
 }  // namespace operators
 }  // namespace primitiv
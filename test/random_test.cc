@@ -1,5 +1,7 @@
 #include <primitiv/config.h>
 
+#include <memory>
+#include <thread>
 #include <vector>
 #include <gtest/gtest.h>
 #include <primitiv/random.h>
@@ -87,4 +89,89 @@ TEST_F(DefaultRandomizerTest, CheckFillLogNormal) {
   EXPECT_TRUE(vector_match(expected, observed));
 }
 
+TEST_F(DefaultRandomizerTest, CheckThreadStreams) {
+  const std::size_t size = 64;
+  vector<float> owner(size), other1(size), other2(size);
+  randomizer_.fill_uniform(-9, 9, size, owner.data());
+
+  DefaultRandomizer randomizer2(12345);
+  std::thread th1([&] {
+    randomizer_.fill_uniform(-9, 9, size, other1.data());
+  });
+  std::thread th2([&] {
+    randomizer2.fill_uniform(-9, 9, size, other2.data());
+  });
+  th1.join();
+  th2.join();
+
+  // Streams of other threads are reproducible, and differ from the stream of
+  // the owner thread.
+  EXPECT_TRUE(vector_match(other1, other2));
+  EXPECT_FALSE(vector_match(owner, other1));
+
+  // The stream of the owner thread is not affected by other threads.
+  DefaultRandomizer randomizer3(12345);
+  vector<float> expected(size), observed(size);
+  randomizer3.fill_uniform(-9, 9, size, expected.data());
+  randomizer3.fill_uniform(-9, 9, size, expected.data());
+  randomizer_.fill_uniform(-9, 9, size, observed.data());
+  EXPECT_TRUE(vector_match(expected, observed));
+}
+
+TEST_F(DefaultRandomizerTest, CheckThreadStreamIndex) {
+  const std::size_t size = 64;
+  vector<float> result1(size), result2(size), result3(size);
+  DefaultRandomizer randomizer2(12345);
+  std::thread th1([&] {
+    DefaultRandomizer::set_thread_stream_index(3);
+    randomizer_.fill_uniform(-9, 9, size, result1.data());
+  });
+  std::thread th2([&] {
+    DefaultRandomizer::set_thread_stream_index(3);
+    randomizer2.fill_uniform(-9, 9, size, result2.data());
+  });
+  std::thread th3([&] {
+    DefaultRandomizer::set_thread_stream_index(4);
+    randomizer2.fill_uniform(-9, 9, size, result3.data());
+  });
+  th1.join();
+  th2.join();
+  th3.join();
+
+  // Streams with the same index are reproducible regardless of the order of
+  // their first use.
+  EXPECT_TRUE(vector_match(result1, result2));
+  EXPECT_FALSE(vector_match(result1, result3));
+}
+
+TEST_F(DefaultRandomizerTest, CheckStreamOfDestroyedRandomizer) {
+  const std::size_t size = 64;
+  vector<float> expected(size), observed(size);
+  std::unique_ptr<DefaultRandomizer> randomizer;
+  std::thread([&] { randomizer.reset(new DefaultRandomizer(12345)); }).join();
+  randomizer->fill_uniform(-9, 9, size, expected.data());
+
+  // The new randomizer may have the same address, but does not reuse the
+  // stream of the destroyed one.
+  std::thread([&] { randomizer.reset(new DefaultRandomizer(12345)); }).join();
+  randomizer->fill_uniform(-9, 9, size, observed.data());
+  EXPECT_TRUE(vector_match(expected, observed));
+}
+
+TEST_F(DefaultRandomizerTest, CheckConcurrentFill) {
+  const std::size_t size = 1 << 12;
+  const std::uint32_t num_threads = 8;
+  vector<vector<float>> results(num_threads, vector<float>(size, -1e10));
+  vector<std::thread> threads;
+  for (std::uint32_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&, i] {
+      randomizer_.fill_bernoulli(0.5, size, results[i].data());
+    });
+  }
+  for (std::thread &th : threads) th.join();
+  for (const vector<float> &result : results) {
+    for (const float x : result) EXPECT_TRUE(x == 0 || x == 1);
+  }
+}
+
 }  // namespace primitiv
@@ -239,6 +239,77 @@ TEST_F(ShapeOpsTest, CheckInvalidConcat) {
   }
 }
 
+TEST_F(ShapeOpsTest, CheckBatchSlice) {
+  struct TestCase {
+    std::uint32_t lower, upper;
+    Shape input, expected;
+  };
+  const vector<TestCase> test_cases {
+    {0, 1, {}, {}}, {0, 1, {3, 4}, {3, 4}},
+    {0, 1, Shape({3}, 3), {3}}, {2, 3, Shape({3}, 3), {3}},
+    {0, 2, Shape({3}, 3), Shape({3}, 2)}, {1, 3, Shape({3}, 3), Shape({3}, 2)},
+    {0, 3, Shape({3, 4}, 3), Shape({3, 4}, 3)},
+  };
+  for (const TestCase &tc : test_cases) {
+    const Shape observed = batch_slice(tc.input, tc.lower, tc.upper);
+    EXPECT_EQ(tc.expected, observed);
+  }
+}
+
+TEST_F(ShapeOpsTest, CheckInvalidBatchSlice) {
+  struct TestCase {
+    std::uint32_t lower, upper;
+    Shape input;
+  };
+  const vector<TestCase> test_cases {
+    {0, 0, {}}, {1, 0, {}}, {0, 2, {}},
+    {0, 0, Shape({2}, 3)}, {2, 1, Shape({2}, 3)}, {0, 4, Shape({2}, 3)},
+    {3, 4, Shape({2}, 3)},
+  };
+  for (const TestCase &tc : test_cases) {
+    EXPECT_THROW(batch_slice(tc.input, tc.lower, tc.upper), Error);
+  }
+}
+
+TEST_F(ShapeOpsTest, CheckBatchConcat) {
+  struct TestCase {
+    vector<Shape> inputs;
+    Shape expected;
+  };
+  const vector<TestCase> test_cases {
+    {{{}}, {}},
+    {{{}, {}, {}}, Shape({}, 3)},
+    {{{2, 3}, Shape({2, 3}, 2)}, Shape({2, 3}, 3)},
+    {{Shape({2}, 3), Shape({2}, 3), Shape({2}, 3)}, Shape({2}, 9)},
+  };
+  for (const TestCase &tc : test_cases) {
+    {
+      // Using objects
+      const Shape observed = batch_concat(tc.inputs);
+      EXPECT_EQ(tc.expected, observed);
+    }
+    {
+      // Using pointers
+      vector<const Shape *> xs;
+      for (const Shape &x : tc.inputs) xs.emplace_back(&x);
+      const Shape observed = batch_concat(xs);
+      EXPECT_EQ(tc.expected, observed);
+    }
+  }
+}
+
+TEST_F(ShapeOpsTest, CheckInvalidBatchConcat) {
+  const vector<vector<Shape>> test_cases {
+    {},
+    {{1}, {2}},
+    {{2, 3}, {3, 2}},
+    {Shape({2}, 2), Shape({2, 2}, 2)},
+  };
+  for (const vector<Shape> &tc : test_cases) {
+    EXPECT_THROW(batch_concat(tc), Error);
+  }
+}
+
 TEST_F(ShapeOpsTest, CheckPick) {
   struct TestCase {
     Shape input;
@@ -2069,6 +2069,50 @@ TEST_F(TensorForwardTest, CheckELU) {
   }
 }
 
+TEST_F(TensorForwardTest, CheckFusedElementwise) {
+  using Op = ElementwiseOpcode;
+  const vector<float> x_data {1, -2, .5, 0, -1, 3, 2, -.5};
+  const vector<float> k_data {2, -1};
+  // pown(tanh(x) * k + 1, 2) - x
+  const vector<ElementwiseInstruction> program {
+    {Op::TANH, 0, 0, 0},
+    {Op::MULTIPLY, 2, 1, 0},
+    {Op::ADD_CONST, 3, 0, 1},
+    {Op::POWN, 4, 0, 2},
+    {Op::SUBTRACT, 5, 0, 0},
+  };
+  for (Device *dev : devices) {
+    const Tensor x = dev->new_tensor_by_vector(Shape({2, 2}, 2), x_data);
+    const Tensor k = dev->new_tensor_by_vector(Shape({}, 2), k_data);
+    const vector<float> y_data = (pown(tanh(x) * k + 1, 2) - x).to_vector();
+    try {
+      const Tensor y = dev->fused_elementwise_fw({&x, &k}, program, x.shape());
+      EXPECT_EQ(x.shape(), y.shape());
+      EXPECT_TRUE(vector_near(y_data, y.to_vector(), 1e-5));
+
+      // The result can be written into the tensor used as the argument.
+      Tensor z = x;
+      dev->fused_elementwise_fw({&z, &k}, program, z);
+      EXPECT_TRUE(vector_near(y_data, z.to_vector(), 1e-5));
+    } IGNORE_NOT_IMPLEMENTED
+  }
+}
+
+TEST_F(TensorForwardTest, CheckInvalidFusedElementwise) {
+  using Op = ElementwiseOpcode;
+  for (Device *dev : devices) {
+    const Tensor x = dev->new_tensor_by_constant(Shape({2}, 2), 0);
+    const Tensor y = dev->new_tensor_by_constant(Shape({3}, 3), 0);
+    EXPECT_THROW(dev->fused_elementwise_fw({&x}, {}, x.shape()), Error);
+    EXPECT_THROW(
+        dev->fused_elementwise_fw(
+          {&x}, {{Op::ADD, 0, 1, 0}}, x.shape()), Error);
+    EXPECT_THROW(
+        dev->fused_elementwise_fw(
+          {&x, &y}, {{Op::ADD, 0, 1, 0}}, x.shape()), Error);
+  }
+}
+
 TEST_F(TensorForwardTest, CheckSum) {
   const vector<float> x_data {
     1, 2, 3, 4, 5, 6, 7, 8, -1, -2, -3, -4, -5, -6, -7, -8,
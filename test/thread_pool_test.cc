@@ -0,0 +1,35 @@
+#include <primitiv/config.h>
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <primitiv/error.h>
+#include <primitiv/thread_pool.h>
+
+namespace primitiv {
+
+class ThreadPoolTest : public testing::Test {};
+
+TEST_F(ThreadPoolTest, CheckNew) {
+  for (const std::uint32_t n : {1u, 2u, 4u}) {
+    ThreadPool pool(n);
+    EXPECT_EQ(n, pool.num_threads());
+  }
+}
+
+TEST_F(ThreadPoolTest, CheckInvalidNew) {
+  EXPECT_THROW(ThreadPool(0), Error);
+}
+
+TEST_F(ThreadPoolTest, CheckSubmit) {
+  std::atomic<std::uint32_t> sum(0);
+  {
+    ThreadPool pool(4);
+    for (std::uint32_t i = 1; i <= 1000; ++i) {
+      pool.submit([&sum, i] { sum += i; });
+    }
+    // The destructor waits for all remaining tasks.
+  }
+  EXPECT_EQ(500500u, sum);
+}
+
+}  // namespace primitiv